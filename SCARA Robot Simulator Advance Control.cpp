@@ -1,1915 +1,7824 @@
-/**********************************************************************************************************************
-Course: ROBT1270
-
-Program: SCARA Robot Simulator Advanced Control
-
-Purpose: To demonstrate advanced control over the SCARA Robot Simulator by using process abstraction.
-Programming methods: formatted I/O, conditional statements, functions, loops, arrays, data parsing.
-
-Author: Alejandro Fajardo
-
-Date Created: May 18, 2021.
-
-**********************************************************************************************************************/
-
-//-------------------------- Standard library prototypes --------------------------------------------------------------
-#include <stdio.h>  // formatted i/o
-#include <math.h>   // math functions
-#include <stdlib.h> // system function
-#include "robot.h"  // robot functions
-
-CRobot robot;       // the global robot Class
-
-
-//---------------------------- Program Constants ----------------------------------------------------------------------
-const double PI = 3.14159265358979323846;
-const int MAX_POINTS = 81;                	// global constant for max available points between 2 points
-const int MAX_ARGS = 7;                         // maximum number of command arguments
-const size_t MAX_ARG_STRING_LENGTH = 20;        // for sting arguments, i.e., "HIGH", "DOWN", "ON"
-const size_t MAX_COMMAND_LENGTH = 256;          // maximum number of characters in command string
-const size_t MAX_MESSAGE_LENGTH = 256;          // maximum number of characters in error message string
-const size_t MAX_FILENAME_LENGTH = 256;         // maximum number of characters in a filename (includes path)
-
-
-const int NO_FILE_LINE = 0;  			// for parseCommand to differentiate between file and keyboard input
-
-const double L1 = 350.0;                  	// length of inner arm
-const double L2 = 250.0;                  	// length of outer arm
-const double MAX_ABS_THETA1_DEG = 150.0;  	// maximum shoulder angle (CW or CCW)
-const double MAX_ABS_THETA2_DEG = 170.0;  	// maximum elbow bend angle (CW or CCW)
-
-// max/min reach of the robot
-const double LMAX = L1 + L2;
-const double LMIN = sqrt(L1 * L1 + L2 * L2 - 2.0 * L1 * L2 * cos(PI - MAX_ABS_THETA2_DEG * PI / 180.0));
-
-// motor speed constants
-const char *STR_MOTOR_SPEED_LOW = "LOW";
-const char *STR_MOTOR_SPEED_MEDIUM = "MEDIUM";
-const char *STR_MOTOR_SPEED_HIGH = "HIGH";
-enum MOTOR_SPEED { MOTOR_SPEED_LOW, MOTOR_SPEED_MEDIUM, MOTOR_SPEED_HIGH };  // enum sets 1st value to 0, 2nd to 1, ..
-
-// object drawing resolution constants (for rectangle, triangle, arc, line) 
-const char *STR_RESOLUTION_LOW = "LOW";
-const char *STR_RESOLUTION_MEDIUM = "MEDIUM";
-const char *STR_RESOLUTION_HIGH = "HIGH";
-enum RESOLUTION { RESOLUTION_LOW, RESOLUTION_MEDIUM, RESOLUTION_HIGH };
-
-// pen position constants
-const char *STR_PEN_UP = "UP";
-const char *STR_PEN_DOWN = "DOWN";
-enum PEN_POSITION { PEN_UP, PEN_DOWN };
-
-// cycle pen colors constants
-const char *STR_CYCLE_PEN_COLORS_ON = "ON";
-const char *STR_CYCLE_PEN_COLORS_OFF = "OFF";
-enum CYCLE_PEN_COLORS { CYCLE_PEN_COLORS_ON, CYCLE_PEN_COLORS_OFF };
-
-// limits for colors
-int COLOR_MIN = 0;
-int COLOR_MAX = 255;
-
-// arm position constants
-enum ARM_POSITION { LEFT_ARM, RIGHT_ARM, NO_ARM }; // no arm means can't reach a point.  Used in checkPath.
-
-// index of each SCARA command
-
-enum COMMAND_LIST_INDEX
-{
-   INDEX_MOTOR_SPEED, INDEX_PEN_POS, INDEX_PEN_COLOR, INDEX_CYCLE_PEN_COLORS, INDEX_CLEAR_TRACE,
-   INDEX_CLEAR_REMOTE_COMMAND_LOG, INDEX_CLEAR_POSITION_LOG, INDEX_SHUTDOWN_SIMULATION,
-   INDEX_END_REMOTE_CONNECTION, INDEX_HOME, INDEX_MOVE_TO, INDEX_DRAW_LINE, INDEX_DRAW_ARC,
-   INDEX_DRAW_RECTANGLE, INDEX_DRAW_TRIANGLE, INDEX_ADD_ROTATION, INDEX_ADD_TRANSLATION, INDEX_ADD_SCALING,
-   INDEX_RESET_TRANSFORMATION_MATRIX, INDEX_QUERY_STATE, NUM_COMMANDS
-};
-const int NUM_SCARA_COMMANDS = NUM_COMMANDS; 	// number of abstracted SCARA commands. 
-
-enum INPUT_MODE { KEYBOARD_INPUT, FILE_INPUT }; // for users choice
-
-
-
-//----------------------------- Program Structures --------------------------------------------------------------------
-
-typedef struct RGB_COLOR // for describing pen RGB color
-{
-   int r, g, b;   		// red, green, blue components (0-255 each)
-}
-RGB_COLOR;
-
-
-
-typedef struct SCARA_POSITION  	// to store the current position of the pen.  Note that armPos is redundant.
-{
-   double x, y, theta1Deg, theta2Deg;
-   int armPos;
-}
-SCARA_POSITION;
-
-
-
-typedef struct SCARA_STATE  	// used to store the current state of the robot.
-{
-   SCARA_POSITION currentPos;
-   int motorSpeed, penPos, cyclePenColors;
-   RGB_COLOR penColor;
-}
-SCARA_STATE;
-
-				
-// forward solution is NEVER TRANSFORMED!!
-typedef struct FORWARD_SOLUTION	// encapsulates both x and y for forward solution 
-{
-   double x, y;
-   bool bHasSolution;
-}
-FORWARD_SOLUTION;
-
-
-
-typedef struct INVERSE_SOLUTION	// encapsulates both right/left arm angles for inverse solution
-{
-   double theta1DegLeft, theta1DegRight;  // right arm solution
-   double theta2DegLeft, theta2DegRight;  // left arm solution
-   bool bLeft, bRight;                    // true if has solution
-}
-INVERSE_SOLUTION;
-
-
-// a union is used to save space. ONLY ONE PARAMETER CAN BE USED AT A TIME BECAUSE THE MEMORY IS SHARED
-typedef union COMMAND_ARGUMENT
-{
-   char strValue[MAX_ARG_STRING_LENGTH];  // to store values for string parameters (like "HIGH", "MEDIUM", "LOW")
-   double dValue; // to store floating point values
-   int iValue;    // to store integer values
-}
-COMMAND_ARGUMENT;
-
-
-// struct to hold data for abstracted commands like drawRectangle
-typedef struct SCARA_COMMAND
-{
-   const char *cmdName;       // name of the command.  Pointer points at hardcoded string constant.
-   const char *strArgs;       // names of all arguments.  Pointer points at hardcoded string constant.
-   int nArgs;                 // number of input arguments for the command
-   COMMAND_ARGUMENT *args;    // dynamic array used to store all the argument values.  Note: must use malloc 
-}
-SCARA_COMMAND;
-
-
-// struct to hold info related for drawing an arc
-typedef struct ARC_INFO
-{
-   double thetaARad, thetaBRad, Xc, Yc, R;
-   RGB_COLOR rgb;
-}ARC_INFO;
-
-
-//structure that holds the line information of a straightline
-typedef struct LINE_INFO
-{
-   double X0, Y0, X1, Y1;
-   RGB_COLOR rgb;
-   int N;
-
-}LINE_INFO;
-
-
-//----------------------------- Local Function Prototypes -------------------------------------------------------------
-bool flushInputBuffer();            		// flushes any characters left in the standard input buffer
-void waitForEnterKey();             		// waits for the Enter key to be pressed
-double degToRad(double);            		// returns angle in radians from input angle in degrees
-double radToDeg(double);            		// returns angle in degrees from input angle in radians
-void closeAndExit(const char *);    		// prints a message and closes program
-int nint(double d);                 		// find int nearest to double
-char *makeUpper(char *);            		// changes a string to all upper case
-bool isBlankLine(const char *);     		// checks if a string is composed entiredly of whitespace characters
-bool isCommentLine(const char *);   		// check if a string is considered a comment string
-void pauseAndClearRobotAndConsole();      	// asks the user to press ENTER and then clears the robot interface
-void resetTransformMatrix(double TM[][3]);      // resets the transform matrix to the identity matrix
-void transformMatrixMultiply(double TM[][3], double M[][3]);    // premultiplies the transform matrix TM by matrix M
-FORWARD_SOLUTION forwardKinematics(double, double);  // implements forward kinematics
-int getN(double len, int resolution);  		// number of points to use for a line for drawLine or arc for drawArc.
-bool initSCARAcommands(SCARA_COMMAND *cmdList); //initiate all the commands for the robot assigning values, names...
-int getDataInputMode();                		// get an input from the user so the program know where is it gonna get the data
-int parseCommand(char *strCommand, SCARA_COMMAND *cmdList, char *strErrorMsg, int lineNumber); //Compare the input com
-void freeDynamicMemory(SCARA_COMMAND *);   	// will free all the dynamic memery before closing the pogram
-void help(SCARA_COMMAND *);      		// function that will print all SCARA COMMANDS, arguments, and any needed info
-void runKeyboardCommands(SCARA_COMMAND *cmdList, SCARA_STATE *state, double transformMatrix[3][3]);      //fun keyboard
-void runFileCommands(SCARA_COMMAND *cmdList, SCARA_STATE *state, double transformMatrix[3][3]); //runcommands from a file
-void executeCommand(SCARA_COMMAND *cmdList, SCARA_STATE *state, int index, double transformMatrix[3][3]);  //commds exe
-void drawArc(SCARA_COMMAND *cmdList, int index, double transformMatrix[3][3], SCARA_STATE *state);//calc starting/end
-void drawStraightLine(SCARA_COMMAND *cmdList, int index, double transformMatrix[3][3], SCARA_STATE *state);//for line
-INVERSE_SOLUTION inverseKinematics(double, double, double transformMatrix[3][3]);          // funtion for inverseKinem
-bool checkPad(double, double);     		//will check that a full pad can be draw prior to the drawing. 
-
-//---------------------------------------------------------------------------------------------------------------------
-//---------------------------------------------------------------------------------------------------------------------
-// demonstrates advanced control of the robot simulator using all facets of C learned in the course
-// INPUTS: none
-// RETURN: an integer - signals to the O/S how the program terminated.
-int main()
-{
-   // open connection with robot
-   if(!robot.Initialize()) return 0;
-
-   int dataInputMode; // stores the input mode (keyboard or file)
-
-   SCARA_COMMAND cmdList[NUM_SCARA_COMMANDS] = {}; // holds the list of all abstracted SCARA command
-
-   // current state of the robot (position, pen, and motor states).
-   SCARA_STATE state = {600.0, 0.0, 0.0, 0.0, LEFT_ARM, CYCLE_PEN_COLORS_OFF, MOTOR_SPEED_MEDIUM, 255, 0, 0, PEN_DOWN};
-
-   // all points sent to inverseKinematics will be transformed using transformMatrix BEFORE 
-   // the motor angle values are calculated
-   double transformMatrix[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
-
-   // initialize the list of commands and associated data
-   if(!initSCARAcommands(cmdList)) closeAndExit("Can't initialize the SCARA command list!");
-   dataInputMode = getDataInputMode(); // ask the user if they want to get commands from the keyboard or a file
-
-   if(dataInputMode == KEYBOARD_INPUT)
-
-      runKeyboardCommands(cmdList, &state, transformMatrix); // get/run commands interactively from the keyboard
-   else
-      runFileCommands(cmdList, &state, transformMatrix); // get/run commands from a specified file
-
-   freeDynamicMemory(cmdList); // free memory allocated inside the cmdList array.
-   closeAndExit("Thanks for playing!"); // that's all folks!
-}
-
-
-
-
-//---------------------------------------------------------------------------------------------------------------------
-// This function processes a user-inputted or file-read command string, i.e., "moveTo 300.0 400.0\n". then is tokenized 
-// to extract the command name (i.e., "moveTo") and the command arguments (i.e.,"300.0"  "400.0"). If name isnt found
-// in the cmdList array or all arguments are not valid, the function formats an error message and returns -1. The error 
-// message must contain the file line number if the command was read from a file.  If all arguments are valid, their
-//  values are stored in the appropriate element of the cmdList array.
-// INPUTS: strCommand - The user-inputted or file-read command string
-//         cmdList - The array of SCARA_COMMAND structures.
-//         strError - a pointer to a string used to store an error message
-//         lineNumber - the line number of the command string if read from a file or -1 if user-inputted
-// RETURN: the index of the command in cmdList, or -1 if the command and/or arguments was not valid
-int parseCommand(char *strCommand, SCARA_COMMAND *cmdList, char *strErrorMsg, int lineNumber)
-{
-   int index = -1;  // stores the index of the command from cmdList if found and has valid argument data
-   char *tok = NULL, *nextTok = NULL;  // for tokenizing strCommand
-   const char *seps = " \t\n\r,;:\\/_"; // for tokenzing strCommand.  Possibly delimeters (can be altered if desired)
-   RGB_COLOR RGBcol = {}; // structure that will store the color of the tok.
-   char *pGarbage = NULL;  //  will store if there is any trailing garbage
-
-
-   // tokenizing the first command and compare it with the Scara Commands
-   tok = strtok_s(strCommand, seps, &nextTok); // tokenize the command name (i.e., "moveTo")
-   if(tok != NULL)  // if got something, search for matching command in cmdList (case-insenstive match!)
-   {
-      for(index = 0; index < NUM_COMMANDS; index++)
-      {
-         if(_stricmp(tok, cmdList[index].cmdName) == 0) break;
-      }
-   }
-
-   if(tok == NULL || index == NUM_COMMANDS)  // command not found, format error message and return
-   {
-      if(lineNumber == -1) // user-inputted command
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "%s is not a valid command", tok);
-      else // file-read command
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "%s is not a valid command (line %d)", tok, lineNumber);
-
-      return -1;
-   }
-
-   // command name ok.  Process argument values using a swtich based on the index.   
-   // Must be done individually because number of arguments, argument types, and argument limits are
-   // generally different for each argument (some can be grouped, i.e., those with no arguments)
-
-   char storeArg1[MAX_ARG_STRING_LENGTH];    //store the value of arg 1
-   int i;   // variable for a counter
-
-   switch(index)
-   {
-
-      // first case motor speed
-   case INDEX_MOTOR_SPEED:
-
-      tok = strtok_s(NULL, seps, &nextTok);  // get the one and only argument
-      // if argument not found or doesn't match the required text, format error message and return
-      if(tok == NULL ||
-         _stricmp(tok, STR_MOTOR_SPEED_LOW) != 0 &&   // use exisiting global constants!!!
-         _stricmp(tok, STR_MOTOR_SPEED_MEDIUM) != 0 &&
-         _stricmp(tok, STR_MOTOR_SPEED_HIGH) != 0)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting %d parameter(s).  Should be: %s",
-            cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-         return -1;
-      }
-
-      strcpy_s(storeArg1, MAX_ARG_STRING_LENGTH, tok);
-      // checking for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting %d parameter(s), you have entered more",
-            cmdList[index].nArgs);
-         return -1;
-      }
-
-      //if everything okay, we can send to main the commands
-      strcpy_s(cmdList[index].args[0].strValue, MAX_ARG_STRING_LENGTH, storeArg1);
-      break;
-
-      // argument is valid, so store it's value in the approriate element of cmdList.  Note that args is 
-      // an array of COMMAND_ARGUMENT unions, so you need to store the argument value in the appropriate 
-      // spot in that array and in the appropriate element of args.  Here the single argument is a string
-      // therefore it is stored in the strValue union member.  If it was an int, you would need to convert
-      // the token to an int (i.e., using strtol) and store the resulting int in the iValue union member.
-      // In the cases of ints and doubles, they must be garbage-free and in the valid range (i.e., pen color 
-      // components must be in the range 0-255.
-      // check for pen pos it should have just one parameter
-   case INDEX_PEN_POS:
-      tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-
-   // if argument not found or doesn't match the required text, format error message and return
-      if(tok == NULL ||
-         _stricmp(tok, STR_PEN_DOWN) != 0 &&   // use exisiting global constants!!!
-         _stricmp(tok, STR_PEN_UP) != 0)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting %d parameter(s).  Should be: %s",
-            cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-         return -1;
-      }
-      strcpy_s(storeArg1, MAX_ARG_STRING_LENGTH, tok);
-      // checking for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting %d parameter(s), you have entered more",
-            cmdList[index].nArgs);
-         return -1;
-      }
-      //if everything okay, we can send to main the commands
-      strcpy_s(cmdList[index].args[0].strValue, MAX_ARG_STRING_LENGTH, storeArg1);
-      break;
-
-   case INDEX_PEN_COLOR:
-      // create a loop that will tokenize each remaining argument and will check its free of garbage and its complete
-      for(i = 0; i < 3; i++)
-      {
-         tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-         if(tok == NULL)
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "expecting %d parameter(s).  Should be: %s",
-               cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-            return -1;
-         }
-
-         cmdList[index].args[i].iValue = (int)strtol(tok, &pGarbage, 10);
-         if(*pGarbage != '\0')
-         {
-
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "You have entered trailing garbage, try again with no garbage this time");
-            return -1;
-         }
-         if(cmdList[index].args[i].iValue < COLOR_MIN || cmdList[index].args[i].iValue > COLOR_MAX)   //glob const
-         {
-            printf("Sorry values most be between %d and %d, try again", COLOR_MIN, COLOR_MAX);
-            return -1;
-         }
-      }
-
-      // check for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered extra parameters, try again");
-         return -1;
-      }
-
-      break;
-
-   case INDEX_CYCLE_PEN_COLORS:
-      tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either ON or OFF
-      if(tok == NULL ||
-         _stricmp(tok, STR_CYCLE_PEN_COLORS_ON) != 0 &&   // use exisiting global constants!!!
-         _stricmp(tok, STR_CYCLE_PEN_COLORS_OFF) != 0)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting %d parameter(s).  Should be: %s",
-            cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-         return -1;
-      }
-
-      strcpy_s(storeArg1, MAX_ARG_STRING_LENGTH, tok);
-      // checking for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting %d parameter(s), you have entered more",
-            cmdList[index].nArgs);
-         return -1;
-      }
-
-      //if everything okay, we can send to main the commands
-      strcpy_s(cmdList[index].args[0].strValue, MAX_ARG_STRING_LENGTH, storeArg1);
-      break;
-
-   case INDEX_CLEAR_TRACE:
-      tok = strtok_s(NULL, seps, &nextTok);  // not getting any nextTok since the function has no args
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting no parameter(s), you have entered more");  // strArgs should contain insightful text.
-         return -1;
-      }
-      break;
-
-   case INDEX_CLEAR_REMOTE_COMMAND_LOG:
-      tok = strtok_s(NULL, seps, &nextTok);  // not getting any nextTok since the function has no args
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting no parameter(s), you have entered more");  // strArgs should contain insightful text.
-         return -1;
-      }
-      break;
-
-   case INDEX_CLEAR_POSITION_LOG:
-      tok = strtok_s(NULL, seps, &nextTok);  // not getting any nextTok since the function has no args
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting no parameter(s), you have entered more");  // strArgs should contain insightful text.
-         return -1;
-      }
-      break;
-
-   case INDEX_SHUTDOWN_SIMULATION:
-      tok = strtok_s(NULL, seps, &nextTok);  // not getting any nextTok since the function has no args
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting no parameter(s), you have entered more");  // strArgs should contain insightful text.
-         return -1;
-      }
-      break;
-
-   case INDEX_END_REMOTE_CONNECTION:
-      tok = strtok_s(NULL, seps, &nextTok);  // not getting any nextTok since the function has no args
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting no parameter(s), you have entered more");  // strArgs should contain insightful text.
-         return -1;
-      }
-      break;
-
-   case INDEX_HOME:
-      tok = strtok_s(NULL, seps, &nextTok);  // not getting any nextTok since the function has no args
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting no parameter(s), you have entered more");  // strArgs should contain insightful text.
-         return -1;
-      }
-      break;
-
-   case INDEX_MOVE_TO:
-      // create a loop that will tokenize each remaining argument and will check its free of garbage and its complete
-      for(i = 0; i < 2; i++)
-      {
-         tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-         if(tok == NULL)
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "expecting %d parameter(s).  Should be: %s",
-               cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-            return -1;
-         }
-         cmdList[index].args[i].dValue = strtod(tok, &pGarbage);
-         if(*pGarbage != '\0')
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "You have entered trailing garbage, try again with no garbage this time");
-            return -1;
-         }
-      }
-      // check for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered extra parameters, try again");
-         return -1;
-      }
-      break;
-
-   case INDEX_DRAW_LINE:
-      // create a loop that will tokenize each remaining argument and will check its free of garbage and its complete
-      for(i = 0; i < 4; i++)
-      {
-         tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-         if(tok == NULL)
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "expecting %d parameter(s).  Should be: %s",
-               cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-            return -1;
-         }
-
-         cmdList[index].args[i].dValue = strtod(tok, &pGarbage);
-         if(*pGarbage != '\0')
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "You have entered trailing garbage, try again with no garbage this time");
-            return -1;
-         }
-
-      }
-
-      // Checking for resolutions
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok == NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting Resolution: %s or %s or %s",
-            STR_RESOLUTION_HIGH, STR_RESOLUTION_MEDIUM, STR_RESOLUTION_LOW);   // global constantes
-         return -1;
-      }
-
-      if(_stricmp(tok, STR_MOTOR_SPEED_HIGH) != 0 && _stricmp(tok, STR_MOTOR_SPEED_MEDIUM) != 0 &&
-         _stricmp(tok, STR_MOTOR_SPEED_LOW) != 0)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting Resolution: %s or %s or %s",
-            STR_RESOLUTION_HIGH, STR_RESOLUTION_MEDIUM, STR_RESOLUTION_LOW);
-         return -1;
-      }
-
-      strcpy_s(cmdList[index].args[i].strValue, MAX_ARG_STRING_LENGTH, tok);
-
-      // check for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered extra parameters, try again");
-         return -1;
-      }
-      break;
-
-   case INDEX_DRAW_ARC:
-      // create a loop that will tokenize each remaining argument and will check its free of garbage and its complete
-      for(i = 0; i < 5; i++)
-      {
-         tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-         if(tok == NULL)
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "expecting %d parameter(s).  Should be: %s",
-               cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-            return -1;
-         }
-
-         cmdList[index].args[i].dValue = strtod(tok, &pGarbage);
-         if(*pGarbage != '\0')
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "You have entered trailing garbage, try again with no garbage this time");
-            return -1;
-         }
-      }
-
-      // Checking for resolutions
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok == NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting Resolution: %s or %s or %s",
-            STR_RESOLUTION_HIGH, STR_RESOLUTION_MEDIUM, STR_RESOLUTION_LOW);   // global constantes
-         return -1;
-      }
-
-      if(_stricmp(tok, STR_MOTOR_SPEED_HIGH) != 0 && _stricmp(tok, STR_MOTOR_SPEED_MEDIUM) != 0 &&
-         _stricmp(tok, STR_MOTOR_SPEED_LOW) != 0)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting Resolution: %s or %s or %s",
-            STR_RESOLUTION_HIGH, STR_RESOLUTION_MEDIUM, STR_RESOLUTION_LOW);
-         return -1;
-      }
-      strcpy_s(cmdList[index].args[5].strValue, tok);
-
-      // check for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered extra parameters, try again");
-         return -1;
-      }
-      break;
-
-   case INDEX_DRAW_RECTANGLE:
-      // create a loop that will tokenize each remaining argument and will check its free of garbage and its complete
-      for(i = 0; i < 4; i++)
-      {
-         tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-         if(tok == NULL)
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "expecting %d parameter(s).  Should be: %s",
-               cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-            return -1;
-         }
-
-         cmdList[index].args[i].dValue = strtod(tok, &pGarbage);
-         if(*pGarbage != '\0')
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "You have entered trailing garbage, try again with no garbage this time");
-            return -1;
-         }
-      }
-
-      // Checking for resolutions
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok == NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting Resolution: %s or %s or %s",
-            STR_RESOLUTION_HIGH, STR_RESOLUTION_MEDIUM, STR_RESOLUTION_LOW);   // global constantes
-         return -1;
-      }
-
-      if(_stricmp(tok, STR_MOTOR_SPEED_HIGH) != 0 && _stricmp(tok, STR_MOTOR_SPEED_MEDIUM) != 0 &&
-         _stricmp(tok, STR_MOTOR_SPEED_LOW) != 0)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting Resolution: %s or %s or %s",
-            STR_RESOLUTION_HIGH, STR_RESOLUTION_MEDIUM, STR_RESOLUTION_LOW);
-         return -1;
-      }
-      strcpy_s(cmdList[index].args[4].strValue, tok);
-
-
-      // check for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered extra parameters, try again");
-         return -1;
-      }
-      break;
-
-   case INDEX_DRAW_TRIANGLE:
-      // create a loop that will tokenize each remaining argument and will check its free of garbage and its complete
-      for(i = 0; i < 6; i++)
-      {
-         tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-         if(tok == NULL)
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "expecting %d parameter(s).  Should be: %s",
-               cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-            return -1;
-         }
-
-         cmdList[index].args[i].dValue = strtod(tok, &pGarbage);
-         if(*pGarbage != '\0')
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "You have entered trailing garbage, try again with no garbage this time");
-            return -1;
-         }
-      }
-
-      // Checking for resolutions
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok == NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting Resolution: %s or %s or %s",
-            STR_RESOLUTION_HIGH, STR_RESOLUTION_MEDIUM, STR_RESOLUTION_LOW);   // global constantes
-         return -1;
-      }
-      if(_stricmp(tok, STR_MOTOR_SPEED_HIGH) != 0 && _stricmp(tok, STR_MOTOR_SPEED_MEDIUM) != 0 &&
-         _stricmp(tok, STR_MOTOR_SPEED_LOW) != 0)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting Resolution: %s or %s or %s",
-            STR_RESOLUTION_HIGH, STR_RESOLUTION_MEDIUM, STR_RESOLUTION_LOW);
-         return -1;
-      }
-      strcpy_s(cmdList[index].args[6].strValue, tok);
-
-      // check for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered extra parameters, try again");
-         return -1;
-      }
-      break;
-
-   case INDEX_ADD_ROTATION:
-      // create a loop that will tokenize each remaining argument and will check its free of garbage and its complete
-      tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-      if(tok == NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting %d parameter(s).  Should be: %s",
-            cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-         return -1;
-      }
-      cmdList[index].args[0].dValue = strtod(tok, &pGarbage);
-      if(*pGarbage != '\0')
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered trailing garbage, try again with no garbage this time");
-         return -1;
-      }
-
-      // check for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered extra parameters, try again");
-         return -1;
-      }
-      break;
-
-   case INDEX_ADD_TRANSLATION:
-      // create a loop that will tokenize each remaining argument and will check its free of garbage and its complete
-      for(i = 0; i < 2; i++)
-      {
-         tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-         if(tok == NULL)
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "expecting %d parameter(s).  Should be: %s",
-               cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-            return -1;
-         }
-         cmdList[index].args[i].dValue = strtod(tok, &pGarbage);
-         if(*pGarbage != '\0')
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "You have entered trailing garbage, try again with no garbage this time");
-            return -1;
-         }
-      }
-
-      // check for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered extra parameters, try again");
-         return -1;
-      }
-      break;
-
-   case INDEX_ADD_SCALING:
-      // create a loop that will tokenize each remaining argument and will check its free of garbage and its complete
-      for(i = 0; i < 2; i++)
-      {
-         tok = strtok_s(NULL, seps, &nextTok);  // get only one argument for penPos either UP or DOWN
-         if(tok == NULL)
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "expecting %d parameter(s).  Should be: %s",
-               cmdList[index].nArgs, cmdList[index].strArgs);  // strArgs should contain insightful text.
-            return -1;
-         }
-
-         cmdList[index].args[i].dValue = strtod(tok, &pGarbage);
-         if(*pGarbage != '\0')
-         {
-            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-               "You have entered trailing garbage, try again with no garbage this time");
-            return -1;
-         }
-
-      }
-
-      // check for no extra arguments
-      tok = strtok_s(NULL, seps, &nextTok);
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "You have entered extra parameters, try again");
-         return -1;
-      }
-
-      break;
-
-   case INDEX_RESET_TRANSFORMATION_MATRIX:
-      tok = strtok_s(NULL, seps, &nextTok);  // shouldnt get any nextTok since the function has no args
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting no parameter(s), you have entered more");  // strArgs should contain insightful text.
-         return -1;
-      }
-      break;
-
-   case INDEX_QUERY_STATE:
-      tok = strtok_s(NULL, seps, &nextTok);  // shouldnt get any nextTok since the function has no args
-      if(tok != NULL)
-      {
-         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
-            "expecting no parameter(s), you have entered more");  // strArgs should contain insightful text.
-         return -1;
-      }
-      break;
-   }
-
-   return index;  // command is valid and has valid arguments so return the index
-}
-
-
-//---------------------------------------------------------------------------------------------------------------------
-// Resets the tranform matrix to the unit matrix.  x, y points will no longer be transformed in inverseKinematics
-// INPUTS:  the 3x3 transform matrix
-// RETURN:  nothing
-void resetTransformMatrix(double TM[][3])  // resets to unit matrix
-{
-   int r, c;  // matrix row, column indexes
-
-   for(r = 0; r < 3; r++)
-   {
-      for(c = 0; c < 3; c++)
-      {
-         TM[r][c] = (r == c ? 1.0 : 0.0);  // same as:  if(r==c) 
-      }                                    //               TM[r][c] = 1.0;
-   }                                       //           else
-}                                          //               TM[r][c] = 0.0;
-
-//---------------------------------------------------------------------------------------------------------------------
-// Premultiplies the transform matrix by matrix M.  M is normally the rotation mat, translation mat, or the scaling mat
-// INPUTS:  TM: the 3x3 transform matrix, M the premultiplier matrix
-// RETURN:  nothing
-void transformMatrixMultiply(double TM[][3], double M[][3])
-{
-   int r, c, cc;     // row, column indexes
-   double TMM[3][3]; // temp matrix
-
-   for(r = 0; r < 3; r++)
-   {
-      for(c = 0; c < 3; c++)
-      {
-         TMM[r][c] = 0.0;  // set element to zero
-
-         for(cc = 0; cc < 3; cc++) // accumulate the multiples
-         {
-            TMM[r][c] += M[r][cc] * TM[cc][c];
-         }
-      }
-   }
-
-   for(r = 0; r < 3; r++)  // copy temp matrix to TM
-   {
-      for(c = 0; c < 3; c++)
-      {
-         TM[r][c] = TMM[r][c];
-      }
-   }
-}
-
-
-//---------------------------------------------------------------------------------------------------------------------
-// Calculates the number of points to be drawn using drawLine or drawArc.  Number is based on length of line/arc- resol
-// INPUTS:  len:  the length of the line or arc to be drawn. resolution: integer parameter to control the point spacing
-// RETURN:  the number of points
-int getN(double len, int resolution)
-{
-   int N; // calculated number of points
-
-   if(resolution == RESOLUTION_HIGH)
-      N = nint(40.0 * (double)len / 600.0);        // i.e., 80 points across the workspace
-   else if(resolution == RESOLUTION_MEDIUM)
-      N = nint(20.0 * (double)len / 600.0);        // i.e., 40 points across the workspace
-   else
-      N = nint(10.0 * (double)len / 600.0);        // i.e., 20 points across the workspace
-
-   return N;
-}
-
-
-//---------------------------------------------------------------------------------------------------------------------
-// // Calculates the integer value nearest to a given floating point value (i.e., 6.2 would give 6, -7.9 would give -8)
-// INPUTS:  d:  the double
-// RETURN:  the nearest integer
-int nint(double d)
-{
-   return (int)floor(d + 0.5);
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// Sets the robot to its starting state
-// INPUTS:  none
-// RETURN:  none
-//---------------------------------------------------------------------------------------------------------------------
-void pauseAndClearRobotAndConsole()
-{
-   printf("Press ENTER to continue...");
-   waitForEnterKey();
-   system("cls");
-   robot.Send("MOTOR_SPEED HIGH\n");
-   robot.Send("HOME\n");
-   robot.Send("CLEAR_TRACE\n");
-   robot.Send("CLEAR_POSITION_LOG\n");
-   robot.Send("CLEAR_REMOTE_COMMAND_LOG\n");  // must be last or all unprocessed commands are lost!
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// This function computes the SCARA forward solution for a given pair of joint angles.
-// INPUTS:  The joint angles theta1Deg and theta2Deg (in DEGREES!!!!!!!!)
-// RETURN:  an FORWARD_SOLUTION structure containing coordinate position x,y corresponding
-//          to the input joint angles
-FORWARD_SOLUTION forwardKinematics(double theta1Deg, double theta2Deg)
-{
-   FORWARD_SOLUTION fsol = {0.0, 0.0, true};
-
-   if(fabs(theta1Deg) > MAX_ABS_THETA1_DEG) fsol.bHasSolution = false;
-   if(fabs(theta2Deg) > MAX_ABS_THETA2_DEG) fsol.bHasSolution = false;
-
-   if(fsol.bHasSolution)
-   {
-      double theta1 = degToRad(theta1Deg), theta2 = degToRad(theta2Deg);
-      fsol.x = L1 * cos(theta1) + L2 * cos(theta1 + theta2);
-      fsol.y = L1 * sin(theta1) + L2 * sin(theta1 + theta2);
-   }
-
-   return fsol;
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// Checks if a string (normally got from a line in a file) contains only whitespace
-// INPUTS:  strLine:  the string
-// RETURN:  true strLine only contains whitespace, false if not.
-bool isBlankLine(const char *strLine)
-{
-   size_t n, len = strlen(strLine);  // n = temp index.  len = # of characters in the string
-   char c;
-
-   for(n = 0; n < len; n++)
-   {
-      c = strLine[n];
-      if(c != ' ' && c != '\t' && c != '\n' && c != '\r') return false;  // if non-whitespace found, return false
-   }
-
-   return true;  // no whitespace characters found!
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// Checks if a string (normally got from a line in a file) is meant to be a comment string.  Comment lines start 
-// with // or \\.
-// INPUTS:  strLine:  the string
-// RETURN:  true if considered a comment string, false if not.
-bool isCommentLine(const char *strLine)
-{
-   size_t n, len = strlen(strLine);
-   char c;
-
-   for(n = 0; n < len; n++)
-   {
-      c = strLine[n];
-      if(c == ' ' || c == '\t' || c == '\n' || c == '\r') continue;  // skip leading whitespace
-
-      if((c == '\\' || c == '/') && n == len - 1) // note that '\\' is c for single '\'
-         return false;  // only one possible because at end of the string (special case)
-      else if((c == '\\' || c == '/') && (strLine[n + 1] == '\\' || strLine[n + 1] == '/'))
-         return true; // it's a comment line!
-   }
-   return false; // if here than line doesn't start with \\ or //
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// Turns an entire input string to upper case characters
-// INPUTS:  str:  the string
-// RETURN:  the address of the string (useful for strcpy_s, strcmp, strcat_s functions)
-char *makeUpper(char *str)
-{
-   size_t n, len;
-
-   len = strlen(str);
-
-   for(n = 0; n < len; n++)
-   {
-      str[n] = (char)toupper(str[n]);
-   }
-
-   return str;
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// Converts an angle in degrees to radians
-// INPUTS:  angDeg: the angle in degrees
-// RETURN:  the angle in radians
-double degToRad(double angDeg)
-{
-   return (PI / 180.0) * angDeg;
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// Converts an angle in radians to degrees
-// INPUTS:  angRad: the angle in radian
-// RETURN:  the angle in degrees
-double radToDeg(double angRad)
-{
-   return (180.0 / PI) * angRad;
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// Closes the robot and the program.  Outputs a message to the console and asks the user to press ENTER before closing.
-// INPUTS:  message:  the message string
-// RETURN:  none
-void closeAndExit(const char *message)
-{
-   printf("\n%s\n", message);
-   printf("Press ENTER to end this program...");
-   waitForEnterKey();
-   robot.Close(); // close remote connection
-   exit(0);  // exit terminates a console program immediately
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// DESCRIPTION:  This function flushes the input buffer to avoid scanf issues
-// ARGUMENTS:    none
-// RETURN VALUE: false if nothing or only '\n' in stdin. true if extra keystrokes precede the '\n'.
-//               Good for detecting left over garbage from scanf_s in the input buffer
-bool flushInputBuffer()
-{
-   unsigned char ch; // temp character variable
-   bool bHasGarbage = false;
-
-   // exit loop when all characters are flushed
-   while((ch = (unsigned char)getchar()) != '\n' && ch != EOF)
-   {
-      if(!bHasGarbage) bHasGarbage = true;
-   }
-   return bHasGarbage;
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// DESCRIPTION:  Waits for user to press enter.  flushes stdin if keystrokes precede enter
-// ARGUMENTS:    none
-// RETURN VALUE: none
-void waitForEnterKey()
-{
-   unsigned char ch;
-   if((ch = (unsigned char)getchar()) != EOF && ch != '\n') flushInputBuffer();
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// Initialize the array of SCARA_COMMAND structures.  The array elements each hold the command name, argument 
-// descriptions, and an array of COMMAND_ARGUMENT unions used to store argument values for the command
-// INPUTS: cmdList:  The array of SCARA_COMMAND structures.
-// RETURN: true if all argument memory was allocated, false if not
-bool initSCARAcommands(SCARA_COMMAND *cmdList)
-{
-   int n; //variable to store the number of arguments and then use it to compute dynamic memory allocation
-
-   // SCARA_COMMAND_0 motorSpeed:
-   cmdList[INDEX_MOTOR_SPEED].cmdName = "motorSpeed";
-   cmdList[INDEX_MOTOR_SPEED].strArgs = "Arg that should be either HIGH / MEDIUM / LOW";
-   n = cmdList[INDEX_MOTOR_SPEED].nArgs = 1;
-   cmdList[INDEX_MOTOR_SPEED].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_MOTOR_SPEED].args == NULL) return false;
-
-   // SCARA_COMMAND_1 penPos:
-   cmdList[INDEX_PEN_POS].cmdName = "penPos";
-   cmdList[INDEX_PEN_POS].strArgs = "Arg that should be either UP / DOWN";
-   n = cmdList[INDEX_PEN_POS].nArgs = 1;
-   cmdList[INDEX_PEN_POS].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_PEN_POS].args == NULL) return false;
-
-   // SCARA_COMMAND_2 penColor:
-   cmdList[INDEX_PEN_COLOR].cmdName = "penColor";
-   cmdList[INDEX_PEN_COLOR].strArgs = "3 int numbers between 0 and 255 r g b";
-   n = cmdList[INDEX_PEN_COLOR].nArgs = 3;
-   cmdList[INDEX_PEN_COLOR].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_PEN_COLOR].args == NULL) return false;
-
-   // SCARA_COMMAND_3 cyclePenColors:
-   cmdList[INDEX_CYCLE_PEN_COLORS].cmdName = "cyclePenColors";
-   cmdList[INDEX_CYCLE_PEN_COLORS].strArgs = "Arg that should be either ON / OFF";
-   n = cmdList[INDEX_CYCLE_PEN_COLORS].nArgs = 1;
-   cmdList[INDEX_CYCLE_PEN_COLORS].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_CYCLE_PEN_COLORS].args == NULL) return false;
-
-   // SCARA_COMMAND_4 clearTrace:
-   cmdList[INDEX_CLEAR_TRACE].cmdName = "clearTrace";
-   cmdList[INDEX_CLEAR_TRACE].strArgs = "NONE";
-   n = cmdList[INDEX_CLEAR_TRACE].nArgs = 0;
-   cmdList[INDEX_CLEAR_TRACE].args = NULL;
-
-   // SCARA_COMMAND_5 clearRemoteCommandLog:
-   cmdList[INDEX_CLEAR_REMOTE_COMMAND_LOG].cmdName = "clearRemoteCommandLog";
-   cmdList[INDEX_CLEAR_REMOTE_COMMAND_LOG].strArgs = "NONE";
-   n = cmdList[INDEX_CLEAR_REMOTE_COMMAND_LOG].nArgs = 0;
-   cmdList[INDEX_CLEAR_REMOTE_COMMAND_LOG].args = NULL;
-
-   // SCARA_COMMAND_6 clearPositionLog:
-   cmdList[INDEX_CLEAR_POSITION_LOG].cmdName = "clearPositionLog";
-   cmdList[INDEX_CLEAR_POSITION_LOG].strArgs = "NONE";
-   n = cmdList[INDEX_CLEAR_POSITION_LOG].nArgs = 0;
-   cmdList[INDEX_CLEAR_POSITION_LOG].args = NULL;
-
-   // SCARA_COMMAND_7 shutdownSimulation:
-   cmdList[INDEX_SHUTDOWN_SIMULATION].cmdName = "shutdownSimulation";
-   cmdList[INDEX_SHUTDOWN_SIMULATION].strArgs = "NONE";
-   n = cmdList[INDEX_SHUTDOWN_SIMULATION].nArgs = 0;
-   cmdList[INDEX_SHUTDOWN_SIMULATION].args = NULL;
-
-   // SCARA_COMMAND_8 endRemoteConnection:
-   cmdList[INDEX_END_REMOTE_CONNECTION].cmdName = "endRemoteConnection";
-   cmdList[INDEX_END_REMOTE_CONNECTION].strArgs = "NONE";
-   n = cmdList[INDEX_END_REMOTE_CONNECTION].nArgs = 0;
-   cmdList[INDEX_END_REMOTE_CONNECTION].args = NULL;
-
-   // SCARA_COMMAND_9 home:
-   cmdList[INDEX_HOME].cmdName = "home";
-   cmdList[INDEX_HOME].strArgs = "NONE";
-   n = cmdList[INDEX_HOME].nArgs = 0;
-   cmdList[INDEX_HOME].args = NULL;
-
-   // SCARA_COMMAND_10 moveTo:
-   cmdList[INDEX_MOVE_TO].cmdName = "moveTo";
-   cmdList[INDEX_MOVE_TO].strArgs = "x , y";
-   n = cmdList[INDEX_MOVE_TO].nArgs = 2;
-   cmdList[INDEX_MOVE_TO].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_MOVE_TO].args == NULL) return false;
-
-   // SCARA_COMMAND_11 drawLine:
-   cmdList[INDEX_DRAW_LINE].cmdName = "drawLine";
-   cmdList[INDEX_DRAW_LINE].strArgs = "x1, y1, x1, y1, resolution";
-   n = cmdList[INDEX_DRAW_LINE].nArgs = 5;
-   cmdList[INDEX_DRAW_LINE].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_DRAW_LINE].args == NULL) return false;
-
-   // SCARA_COMMAND_12 drawArc:
-   cmdList[INDEX_DRAW_ARC].cmdName = "drawArc";
-   cmdList[INDEX_DRAW_ARC].strArgs = "Xc, Yc, r, thetaDegStart, thetaDegEnd, resolution";
-   n = cmdList[INDEX_DRAW_ARC].nArgs = 6;
-   cmdList[INDEX_DRAW_ARC].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_DRAW_ARC].args == NULL) return false;
-
-   // SCARA_COMMAND_13 drawRectangle:
-   cmdList[INDEX_DRAW_RECTANGLE].cmdName = "drawRectangle";
-   cmdList[INDEX_DRAW_RECTANGLE].strArgs = "Xbl,Ybl, Xtr, Ytr, resolution";
-   n = cmdList[INDEX_DRAW_RECTANGLE].nArgs = 5;
-   cmdList[INDEX_DRAW_RECTANGLE].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_DRAW_RECTANGLE].args == NULL) return false;
-
-   // SCARA_COMMAND_14 drawTriangle:
-   cmdList[INDEX_DRAW_TRIANGLE].cmdName = "drawTriangle";
-   cmdList[INDEX_DRAW_TRIANGLE].strArgs = "Xbl, Ybl, Xt, Yt, Xbr, Ybr, resolution";
-   n = cmdList[INDEX_DRAW_TRIANGLE].nArgs = 7;
-   cmdList[INDEX_DRAW_TRIANGLE].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_DRAW_TRIANGLE].args == NULL) return false;
-
-   // SCARA_COMMAND_15 addRotation:
-   cmdList[INDEX_ADD_ROTATION].cmdName = "addRotation";
-   cmdList[INDEX_ADD_ROTATION].strArgs = "rotationDeg";
-   n = cmdList[INDEX_ADD_ROTATION].nArgs = 1;
-   cmdList[INDEX_ADD_ROTATION].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_ADD_ROTATION].args == NULL) return false;
-
-   // SCARA_COMMAND_16 addTranslation:
-   cmdList[INDEX_ADD_TRANSLATION].cmdName = "addTranslation";
-   cmdList[INDEX_ADD_TRANSLATION].strArgs = "dx, dy";
-   n = cmdList[INDEX_ADD_TRANSLATION].nArgs = 2;
-   cmdList[INDEX_ADD_TRANSLATION].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_ADD_TRANSLATION].args == NULL) return false;
-
-   // SCARA_COMMAND_17 addScaling:
-   cmdList[INDEX_ADD_SCALING].cmdName = "addScaling";
-   cmdList[INDEX_ADD_SCALING].strArgs = "SX, SY";
-   n = cmdList[INDEX_ADD_SCALING].nArgs = 2;
-   cmdList[INDEX_ADD_SCALING].args = (COMMAND_ARGUMENT *)malloc(n * sizeof(COMMAND_ARGUMENT));
-   if(cmdList[INDEX_ADD_SCALING].args == NULL) return false;
-
-   // SCARA_COMMAND_18 resetTransform:
-   cmdList[INDEX_RESET_TRANSFORMATION_MATRIX].cmdName = "resetTransformMatrix";
-   cmdList[INDEX_RESET_TRANSFORMATION_MATRIX].strArgs = "NONE";
-   n = cmdList[INDEX_RESET_TRANSFORMATION_MATRIX].nArgs = 0;
-   cmdList[INDEX_RESET_TRANSFORMATION_MATRIX].args = NULL;
-
-   // SCARA_COMMAND_19 queryState:
-   cmdList[INDEX_QUERY_STATE].cmdName = "queryState";
-   cmdList[INDEX_QUERY_STATE].strArgs = "NONE";
-   n = cmdList[INDEX_QUERY_STATE].nArgs = 0;
-   cmdList[INDEX_QUERY_STATE].args = NULL;
-
-   return true;
-}
-
-//----------------------------------------------------------------------------------------------------------------
-//Thus function  will ask the user if he/she want to get the that from keyboard or file
-//Arguments: None
-//return value: an integer of 0 if its from keyboard or 1 if file
-
-int getDataInputMode()
-{
-   char inputData[MAX_ARG_STRING_LENGTH]; // a varialbe to store input value from the user
-   char kb[MAX_ARG_STRING_LENGTH] = "keyboard\n"; // to compare with the inputData and kyboard
-   char f[MAX_ARG_STRING_LENGTH] = "file\n";       // to compare with the inputData and file
-   int ret; // to store the return value of stricmp
-   size_t strLength;    // to calculate the length of the input string
-
-   do
-   {
-      printf("From where do you want to get the data: \"file\" or \"keyboard\"\t");
-      fgets(inputData, MAX_ARG_STRING_LENGTH, stdin);
-
-      strLength = strlen(inputData);
-
-      if(strLength == strlen(kb))
-      {
-         ret = _stricmp(inputData, kb);
-         if(ret != 0) printf("Sorry didnt type the right word try again \n");
-         else if(ret == 0)
-         {
-            printf("Good you have type %s", inputData);
-            return KEYBOARD_INPUT;
-         }
-      }
-
-      else if(strLength == strlen(f))
-
-      {
-         ret = _stricmp(inputData, f);
-         if(ret != 0) printf("Sorry didnt type the right word try again \n");
-         else if(ret == 0)
-         {
-            printf("Good you have type %s", inputData);
-            return FILE_INPUT;
-         }
-
-      }
-      else printf("You didnt type either keboard or file try again!\n");
-
-   }
-   while(true);
-   return 0;
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-// function that will free the dynamic memory
-// return value . void
-// arguments structure that contain scara command args
-void freeDynamicMemory(SCARA_COMMAND *cmdList)
-{
-   int i;  // counter to free all of the dynamic memory of every command
-
-   for(i = 0; i < NUM_COMMANDS; i++) free(cmdList[i].args);
-}
-
-
-
-//---------------------------------------------------------------------------------------------------------------------
-// function that when called, will print all the SCARA COMMANDS and Arguments for each command
-// return value . void
-// arguments structure that contain scara command args
-void help(SCARA_COMMAND *cmdList)
-{
-   int i;      // for counting in for loops
-
-   for(i = 0; i < NUM_COMMANDS; i++)
-   {
-      printf("SCARA_COMMAND_%d\n", i);
-      printf("Command Name: %s. Number of Arguments: %d. And str Arguments are: %s.\n\n",
-         cmdList[i].cmdName, cmdList[i].nArgs, cmdList[i].strArgs);
-   }
-
-}
-
-
-//---------------------------------------------------------------------------------------------------------------------
-// This function will run a series of commands typed by the user using the keyboard and will call executCommand funtion
-// arguments: structre cmdList, the current state and tranformMatrix
-// return value: none.
-void runKeyboardCommands(SCARA_COMMAND *cmdList, SCARA_STATE *state, double transformMatrix[3][3])
-{
-   int index;   // to store the return value of parseCommand which is the index of the found command
-   char strCommand[MAX_COMMAND_LENGTH];         // string that stores the input command
-   char strErrorMsg[MAX_MESSAGE_LENGTH] = {};    // string that will return the error message if the command isnt found
-
-   while(true)
-   {
-      printf("Please enter a command with argument values (type Q to quit or H for help): ");
-      fgets(strCommand, MAX_COMMAND_LENGTH, stdin);
-      if(toupper(strCommand[0]) == 'Q' && strlen(strCommand) == 2) break;
-      else if(toupper(strCommand[0]) == 'H' && strlen(strCommand) == 2)
-      {
-         help(cmdList);
-      }
-      else
-      {
-         index = parseCommand(strCommand, cmdList, strErrorMsg, -1);
-         if(index == -1) printf("%s\n", strErrorMsg);
-         else
-         {
-            printf("%s is a valid command! (index = %d)\n", strCommand, index);
-            executeCommand(cmdList, state, index, transformMatrix);
-         }
-      }
-   }
-
-}
-
-
-//---------------------------------------------------------------------------------------------------------------------
-// This function will open and read the commands for the robot from a file. 
-// Inputs: scaara commandList, the memory address to update the state of the robot and the matrix
-// Return Value: None.
-void runFileCommands(SCARA_COMMAND *cmdList, SCARA_STATE *state, double transformMatrix[3][3])
-{
-   FILE *fi = NULL;  // variable for the address of the location of the file
-   char fileName[MAX_FILENAME_LENGTH] = {};     //variable to store the file name typed by the userr
-   errno_t err = NULL;  // variable to see of the return value of fopen_s is valid
-   char strCommand[MAX_COMMAND_LENGTH];  // variable used as a buffer to store the input line from a file
-   char strErrorMsg[MAX_MESSAGE_LENGTH] = {};  // string that will return the error message if the command isnt found
-   int index;   // to store the return value of parseCommand which is the index of the found command
-
-
-   printf("Please enter the name of the file where you want to get the data from: \n");
-
-   //asked the user for a file name, check for errors and if okay, then used to open the file
-   if(fgets(fileName, MAX_FILENAME_LENGTH, stdin) == NULL)
-   {
-      printf("Sorry but the name of the File isnt valid, the program has finished.");
-      waitForEnterKey();
-      return;
-   }
-
-   fileName[strlen(fileName) - 1] = '\0';  // to substitute the \n char for \0
-
-
-   // opening the file in read mode and check the file exists and has valid data
-   err = fopen_s(&fi, "test.txt", "r");
-
-   if(err != 0 || fi == NULL)
-   {
-      printf("Sorry the file could not be open, the program has finished.");
-      waitForEnterKey();
-      return;
-   }
-
-
-   // checking for emptylines and comment lines
-   while(fgets(strCommand, MAX_COMMAND_LENGTH, fi) != NULL)
-   {
-      if(isBlankLine(strCommand) == true) continue;
-      if(isCommentLine(strCommand) == true) continue;
-      index = parseCommand(strCommand, cmdList, strErrorMsg, -1);
-      if(index == -1) printf("%s\n", strErrorMsg);
-
-      else
-      {
-         printf("%s is a valid command! (index = %d)\n", strCommand, index);
-         executeCommand(cmdList, state, index, transformMatrix);
-      }
-
-   }
-
-   fclose(fi);  //closing the file.
-}
-
-
-//---------------------------------------------------------------------------------------------------------------------
-// This function is where already checked and cleaned input is sent and real action happens
-// arguments: command list, actual state of the SCARA robot, the index of the command and the transform Matrix
-// return value: none
-void executeCommand(SCARA_COMMAND *cmdList, SCARA_STATE *state, int index, double transformMatrix[3][3])
-{
-   char cmdStg[MAX_COMMAND_LENGTH] = {};  // local variable to change numbers to strings used for sprintf
-   double rotationMatrix[3][3];  // matrix to perform rotations
-   double translationMatrix[3][3];  // matrix to perform rotations
-   double scalingMatrix[3][3];  // matrix to perform rotations
-   double theta1Rad;   // variable for converting typed angle which is in degrees and convert to rad
-   INVERSE_SOLUTION isol = {}; // contain the return value when called inversekinematics to know the current state
-   double xbl, ybl, xtr, ytr, xt, yt, xbr, ybr;    // for bottom left, top right, bottom right top x and y coordenates
-
-   switch(index)
-   {
-      // use and if statment to see which alternative it is and then update the state of the robot
-   case INDEX_MOTOR_SPEED:
-      if(_stricmp(cmdList[index].args[0].strValue, STR_RESOLUTION_HIGH) == 0)
-      {
-         robot.Send("MOTOR_SPEED HIGH\n");
-         state->motorSpeed = MOTOR_SPEED_HIGH;
-      }
-
-      else if(_stricmp(cmdList[index].args[0].strValue, STR_RESOLUTION_MEDIUM) == 0)
-      {
-         robot.Send("MOTOR_SPEED MEDIUM\n");
-         state->motorSpeed = MOTOR_SPEED_MEDIUM;
-      }
-
-      else if(_stricmp(cmdList[index].args[0].strValue, STR_RESOLUTION_LOW) == 0)
-
-      {
-         robot.Send("MOTOR_SPEED LOW\n");
-         state->motorSpeed = MOTOR_SPEED_LOW;
-      }
-
-      break;
-
-   case INDEX_PEN_POS:
-      if(_stricmp(cmdList[index].args[0].strValue, STR_PEN_UP) == 0)
-      {
-         robot.Send("PEN_UP\n");
-         state->penPos = PEN_UP;
-      }
-      else if(_stricmp(cmdList[index].args[0].strValue, STR_PEN_DOWN) == 0)
-      {
-         robot.Send("PEN_DOWN\n");
-         state->penPos = PEN_DOWN;
-      }
-
-      break;
-
-   case INDEX_PEN_COLOR:
-      sprintf_s(cmdStg, "PEN_COLOR %d %d %d\n", cmdList[index].args[0].iValue,
-         cmdList[index].args[1].iValue, cmdList[index].args[2].iValue);
-      robot.Send(cmdStg);
-      state->penColor.r = cmdList[index].args[0].iValue;
-      state->penColor.g = cmdList[index].args[1].iValue;
-      state->penColor.b = cmdList[index].args[2].iValue;
-      break;
-
-   case INDEX_CYCLE_PEN_COLORS:
-      if(_stricmp(cmdList[index].args[0].strValue, STR_CYCLE_PEN_COLORS_OFF) == 0)
-      {
-         robot.Send("CYCLE_PEN_COLOR OFF\n");
-         state->cyclePenColors = CYCLE_PEN_COLORS_OFF;
-      }
-      else if(_stricmp(cmdList[index].args[1].strValue, STR_CYCLE_PEN_COLORS_ON) == 0)
-      {
-         robot.Send("CYCLE_PEN_COLOR ON\n");
-         state->cyclePenColors = CYCLE_PEN_COLORS_ON;
-      }
-      break;
-
-   case INDEX_CLEAR_TRACE:
-      robot.Send("CLEAR_TRACE\n");
-      break;
-
-   case INDEX_CLEAR_REMOTE_COMMAND_LOG:
-      sprintf_s(cmdStg, "CLEAR_REMOTE_COMMAND_LOG\n");
-      robot.Send(cmdStg);
-      break;
-
-   case INDEX_SHUTDOWN_SIMULATION:
-      sprintf_s(cmdStg, "SHUTDOWN_SIMULATION\n");
-      robot.Send(cmdStg);
-      break;
-
-   case INDEX_HOME:
-      sprintf_s(cmdStg, "HOME\n");
-      robot.Send(cmdStg);
-      state->currentPos.x = 600.0;
-      state->currentPos.y = 0.0;
-      break;
-
-   case INDEX_MOVE_TO:
-      drawStraightLine(cmdList, index, transformMatrix, state);
-      state->currentPos.x = cmdList[index].args[0].dValue;
-      state->currentPos.y = cmdList[index].args[1].dValue;
-      break;
-
-   case INDEX_DRAW_LINE:
-      drawStraightLine(cmdList, index, transformMatrix, state);
-      state->currentPos.x = cmdList[index].args[2].dValue;
-      state->currentPos.y = cmdList[index].args[3].dValue;
-      break;
-
-   case INDEX_DRAW_ARC:
-      drawArc(cmdList, index, transformMatrix, state);
-      break;
-
-   case INDEX_DRAW_RECTANGLE:
-      xbl = cmdList[index].args[0].dValue;
-      ybl = cmdList[index].args[1].dValue;
-      xtr = cmdList[index].args[2].dValue;
-      ytr = cmdList[index].args[3].dValue;
-
-      cmdList[index].args[0].dValue = xbl;
-      cmdList[index].args[1].dValue = ybl;
-      cmdList[index].args[2].dValue = xbl;
-      cmdList[index].args[3].dValue = ytr;
-      drawStraightLine(cmdList, index, transformMatrix, state);
-
-      cmdList[index].args[0].dValue = xbl;
-      cmdList[index].args[1].dValue = ytr;
-      cmdList[index].args[2].dValue = xtr;
-      cmdList[index].args[3].dValue = ytr;
-      drawStraightLine(cmdList, index, transformMatrix, state);
-
-      cmdList[index].args[0].dValue = xtr;
-      cmdList[index].args[1].dValue = ytr;
-      cmdList[index].args[2].dValue = xtr;
-      cmdList[index].args[3].dValue = ybl;
-      drawStraightLine(cmdList, index, transformMatrix, state);
-
-      cmdList[index].args[0].dValue = xtr;
-      cmdList[index].args[1].dValue = ybl;
-      cmdList[index].args[2].dValue = xbl;
-      cmdList[index].args[3].dValue = ybl;
-      drawStraightLine(cmdList, index, transformMatrix, state);
-      state->currentPos.x = cmdList[index].args[2].dValue;
-      state->currentPos.y = cmdList[index].args[3].dValue;
-      break;
-
-   case INDEX_DRAW_TRIANGLE:
-      xbl = cmdList[index].args[0].dValue;
-      ybl = cmdList[index].args[1].dValue;
-      xt = cmdList[index].args[2].dValue;
-      yt = cmdList[index].args[3].dValue;
-      xbr = cmdList[index].args[4].dValue;
-      ybr = cmdList[index].args[5].dValue;
-
-      cmdList[index].args[0].dValue = xbl;
-      cmdList[index].args[1].dValue = ybl;
-      cmdList[index].args[2].dValue = xt;
-      cmdList[index].args[3].dValue = yt;
-      drawStraightLine(cmdList, index, transformMatrix, state);
-
-      cmdList[index].args[0].dValue = xt;
-      cmdList[index].args[1].dValue = yt;
-      cmdList[index].args[2].dValue = xbr;
-      cmdList[index].args[3].dValue = ybr;
-      drawStraightLine(cmdList, index, transformMatrix, state);
-
-      cmdList[index].args[0].dValue = xbr;
-      cmdList[index].args[1].dValue = ybr;
-      cmdList[index].args[2].dValue = xbl;
-      cmdList[index].args[3].dValue = ybl;
-      drawStraightLine(cmdList, index, transformMatrix, state);
-      state->currentPos.x = cmdList[index].args[2].dValue;
-      state->currentPos.y = cmdList[index].args[3].dValue;
-      break;
-
-   case INDEX_ADD_ROTATION:
-      theta1Rad = degToRad(cmdList[index].args[0].dValue);
-      rotationMatrix[0][0] = cos(theta1Rad);
-      rotationMatrix[0][1] = -sin(theta1Rad);
-      rotationMatrix[0][2] = 0.0;
-      rotationMatrix[1][0] = sin(theta1Rad);
-      rotationMatrix[1][1] = cos(theta1Rad);
-      rotationMatrix[1][2] = 0.0;
-      rotationMatrix[2][0] = 0.0;
-      rotationMatrix[2][1] = 0.0;
-      rotationMatrix[2][2] = 1.0;
-      transformMatrixMultiply(transformMatrix, rotationMatrix);
-      break;
-
-   case INDEX_ADD_TRANSLATION:
-      translationMatrix[0][0] = 1.0;
-      translationMatrix[0][1] = 0.0;
-      translationMatrix[0][2] = cmdList[index].args[0].dValue;
-      translationMatrix[1][0] = 0.0;
-      translationMatrix[1][1] = 1.0;
-      translationMatrix[1][2] = cmdList[index].args[1].dValue;
-      translationMatrix[2][0] = 0.0;
-      translationMatrix[2][1] = 0.0;
-      translationMatrix[2][2] = 1.0;
-      transformMatrixMultiply(transformMatrix, translationMatrix);
-      break;
-
-   case INDEX_ADD_SCALING:
-      scalingMatrix[0][0] = cmdList[index].args[0].dValue;
-      scalingMatrix[0][1] = 0.0;
-      scalingMatrix[0][2] = 0.0;
-      scalingMatrix[1][0] = 0.0;
-      scalingMatrix[1][1] = cmdList[index].args[1].dValue;
-      scalingMatrix[1][2] = 0.0;
-      scalingMatrix[2][0] = 0.0;
-      scalingMatrix[2][1] = 0.0;
-      scalingMatrix[2][2] = 1.0;
-      transformMatrixMultiply(transformMatrix, scalingMatrix);
-      break;
-
-   case INDEX_RESET_TRANSFORMATION_MATRIX:
-      resetTransformMatrix(transformMatrix);
-      break;
-
-   case INDEX_QUERY_STATE:
-      printf_s("Current Position x: %.2lf y: %.2lf\n", state->currentPos.x, state->currentPos.y);
-      printf_s("Current Angles Theta1: %.2lf Theta2: %.2lf\n", state->currentPos.theta1Deg, state->currentPos.theta2Deg);
-      if(state->currentPos.armPos == LEFT_ARM) printf_s("Current Arm Configuration: LEFT_ARM\n");
-      else if(state->currentPos.armPos == RIGHT_ARM) printf_s("Current Arm Configuration: RIGHT_ARM\n");
-      else if(state->currentPos.armPos == NO_ARM) printf_s("Current Arm Configuration: NO_ARM\n");
-      break;
-   }
-
-}
-
-
-//---------------------------------------------------------------------------------------------------------------------
-// This function will be called from executeCommand to calculate the n intermediate points of a straight lines and then
-// call inverseKinematics to send the angles to the SCARA robot
-// arguments structure that contain cmdList, the index where to command was found and the transformMatrix
-// return value: none since we are sending pointers 
-void drawStraightLine(SCARA_COMMAND *cmdList, int index, double transformMatrix[3][3], SCARA_STATE *state)
-{
-   char commandString[MAX_COMMAND_LENGTH];   // for using sprintf_s and send commands to the robot
-   double adderLeft = 0, adderRight = 0;     // to store the accumulation of angles for the most efficient path
-   double len, x0, x1, y0, y1;               // to copy values of cmdList array and work with smaller commands
-                                             // those variables are for length, inicital and final coordanates for x/y
-   int n;                                    // n is number if intermediate points                                         
-   int i;                                    // used for counting
-   bool bRight, bLeft;                       // to store the return values fo left and right solutions
-   double arrayX[MAX_POINTS] = {0}, arrayY[MAX_POINTS] = {0};     // to store in the array the intermediate coordanates in x/y
-   double arrayTheta1R[MAX_POINTS] = {0}, arrayTheta2R[MAX_POINTS] = {0}, arrayTheta1L[MAX_POINTS] = {0},
-      arrayTheta2L[MAX_POINTS] = {0};
-   // to store in array the theta1 and 2 degrees and check for the shortest / fastest solution
-   INVERSE_SOLUTION isol;                    // for the retun value of inverseKinematics
-
-   x0 = cmdList[index].args[0].dValue;
-   y0 = cmdList[index].args[1].dValue;
-   x1 = cmdList[index].args[2].dValue;
-   y1 = cmdList[index].args[3].dValue;
-   len = sqrt(pow(x1 - x0, 2) + pow(y1 - y0, 2));
-   n = 0;
-
-   int b;
-   b = cmdList[index].nArgs;
-
-   if(_stricmp(cmdList[index].args[cmdList[index].nArgs - 1].strValue, STR_RESOLUTION_HIGH) == 0)
-   {
-      n = getN(len, RESOLUTION_HIGH);
-   }
-   else  if(_stricmp(cmdList[index].args[cmdList[index].nArgs - 1].strValue, STR_RESOLUTION_MEDIUM) == 0)
-
-   {
-      n = getN(len, RESOLUTION_MEDIUM);
-   }
-   else if(_stricmp(cmdList[index].args[cmdList[index].nArgs - 1].strValue, STR_RESOLUTION_LOW) == 0)
-   {
-      n = getN(len, RESOLUTION_LOW);
-   }
-
-   if(n == 0)
-   {
-      arrayX[0] = x0 + ((x1 - x0) * (double)0 / ((double)n + 1.0));
-      arrayY[0] = y0 + ((y1 - y0) * (double)0 / ((double)n + 1.0));
-      n = -1;
-   }
-   else
-   {
-      for(i = 0; i <= n + 1; i++)
-      {
-         arrayX[i] = x0 + ((x1 - x0) * (double)i / ((double)n + 1.0));
-         arrayY[i] = y0 + ((y1 - y0) * (double)i / ((double)n + 1.0));
-      }
-   }
-   bLeft = true;
-   bRight = true;
-
-   // calulating theta1 and theta2 for each pair of coordanates prevously stored in arrayx and arrayy
-   // use inverseKinematics and send the angles to the robot and print angles and position
-
-   for(i = 0; i <= n + 1; i++)
-   {
-      isol = inverseKinematics(arrayX[i], arrayY[i], transformMatrix);
-      bLeft = bLeft && isol.bLeft;                              // validating left solution
-      bRight = bRight && isol.bRight;                            // validating right solution
-
-      // add al angles together to see the most optimal solution
-      adderLeft = isol.theta1DegLeft + isol.theta2DegLeft + adderLeft;
-      adderRight = isol.theta1DegRight + isol.theta2DegRight + adderRight;
-
-      arrayTheta1R[i] = isol.theta1DegRight;
-      arrayTheta2R[i] = isol.theta2DegRight;
-      arrayTheta1L[i] = isol.theta1DegLeft;
-      arrayTheta2L[i] = isol.theta2DegLeft;
-   }
-
-
-   // creating the most efficient path
-   if(bLeft == true && bRight == true)
-   {
-      if(adderLeft < adderRight) bRight = false;
-      else if(adderLeft >= adderRight) bLeft = false;
-   }
-
-
-   for(i = 0; i <= n + 1; i++)
-   {
-      if(i == 0)
-      {
-         sprintf_s(commandString, "PEN_UP\n");
-         robot.Send(commandString);
-      }
-      if(bRight == true)
-      {
-         sprintf_s(commandString, "ROTATE_JOINT ANG1 %lf ANG2 %lf\n", arrayTheta1R[i], arrayTheta2R[i]);
-         robot.Send(commandString);
-      }
-      else if(bLeft == true)
-      {
-         sprintf_s(commandString, "ROTATE_JOINT ANG1 %lf ANG2 %lf\n", arrayTheta1L[i], arrayTheta2L[i]);
-         robot.Send(commandString);
-      }
-      if(i == 0)
-      {
-         sprintf_s(commandString, "PEN_DOWN\n");
-         robot.Send(commandString);
-      }
-
-      if(i == n + 1 && bRight == true)
-      {
-         state->currentPos.theta1Deg = arrayTheta1R[i];
-         state->currentPos.theta2Deg = arrayTheta2R[i];
-      }
-      else if(i == n + 1 && bLeft == true)
-      {
-         state->currentPos.theta1Deg = arrayTheta1L[i];
-         state->currentPos.theta2Deg = arrayTheta2L[i];
-      }
-   }
-}
-
-
-
-
-//----------------------------------------------------------------------------------------------------------------
-// This function computes the SCARA inverse solution for a given x,y position.
-// both right arm and left arm solutions are returned in the INVERSE_SOLUTION structure.
-// INPUTS:  The position coordinates x, y and the tranformMatrix
-// RETURN:  an INVERSE_SOLUTION structure containing joint angles for both left and 
-//          right arms.  RETURN ANGLES ARE IN DEGREES!!!!!!!!!!!!!!
-
-INVERSE_SOLUTION inverseKinematics(double x, double y, double transformMatrix[3][3])
-{
-   INVERSE_SOLUTION isol = {0.0, 0.0, 0.0, 0.0, false, false};  // structure for solution left/right arm angles
-   double len, beta, alfa, thetaRad1Right, thetaRad2Right, thetaRad1Left, thetaRad2Left;
-   // to calculate length, angles beta and alfa (from SCARA Robot and Theta1 and 2 in Rad a for both configuration
-
-   // x, y are the original (non-transformed) coordinates.
-   double xt = x, yt = y;
-   x = xt * transformMatrix[0][0] + yt * transformMatrix[0][1] + transformMatrix[0][2];
-   y = xt * transformMatrix[1][0] + yt * transformMatrix[1][1] + transformMatrix[1][2];
-
-
-   len = sqrt(x * x + y * y);
-   beta = atan2(y, x);
-   alfa = acos((L2 * L2 - len * len - L1 * L1) / (-2 * len * L1));
-
-
-   // right arm configuration
-   thetaRad1Right = beta - alfa;
-   thetaRad2Right = (atan2((y - L1 * sin(thetaRad1Right)), (x - L1 * cos(thetaRad1Right)))) - thetaRad1Right;
-   if(thetaRad2Right <= -PI) thetaRad2Right = thetaRad2Right + 2 * PI;
-   else if(thetaRad2Right >= PI) thetaRad2Right = -2 * PI + thetaRad2Right;
-   isol.theta1DegRight = radToDeg(thetaRad1Right);
-   isol.theta2DegRight = radToDeg(thetaRad2Right);
-
-   if(isol.theta1DegRight >= -MAX_ABS_THETA1_DEG && isol.theta1DegRight <= MAX_ABS_THETA1_DEG &&
-      isol.theta2DegRight >= -MAX_ABS_THETA2_DEG && isol.theta2DegRight <= MAX_ABS_THETA2_DEG)
-
-   {
-      isol.bRight = true;
-   }
-
-   // left arm configuration
-   thetaRad1Left = beta + alfa;
-   thetaRad2Left = (atan2((y - L1 * sin(thetaRad1Left)), (x - L1 * cos(thetaRad1Left)))) - thetaRad1Left;
-   if(thetaRad2Left <= -PI) thetaRad2Left = thetaRad2Left + 2 * PI;
-   else if(thetaRad2Left >= PI) thetaRad2Left = -2 * PI + thetaRad2Left;
-   isol.theta1DegLeft = radToDeg(thetaRad1Left);
-   isol.theta2DegLeft = radToDeg(thetaRad2Left);
-
-   if(isol.theta1DegLeft >= -MAX_ABS_THETA1_DEG && isol.theta1DegLeft <= MAX_ABS_THETA1_DEG &&
-      isol.theta2DegLeft >= -MAX_ABS_THETA2_DEG && isol.theta2DegLeft <= MAX_ABS_THETA2_DEG)
-
-   {
-      isol.bLeft = true;
-   }
-   return isol;
-}
-
-
-
-//-----------------------------------------------------------------------------------------------------------
-// DESCRIPTION:  calculate x and y coordanates and store them in arrays, then print the values as well as draw them
-// ARGUMENTS:    structure
-// RETURN VALUE: void since we are working with pointers adn passing info by referencing
-
-void drawArc(SCARA_COMMAND *cmdList, int index, double transformMatrix[3][3], SCARA_STATE *state)
-{
-   int N = 0, i;     // N is for intermediate points and i is used as a counter
-   const int SIZE = 200;  // SIZE variable to store the coordanates of the x and y points in all the n intermediate
-   double x[SIZE] = {}, y[SIZE] = {}, theta;    //to store the coordanates of all n intermediate points
-   char commandString[MAX_COMMAND_LENGTH];      //to store and send the information to the scara robor
-   INVERSE_SOLUTION isol = {0.0, 0.0, 0.0, 0.0, false, false};  // structure for solution left/right arm angles
-   bool bLeft = true, bRight = true;      // to check the righ and left arm configuration
-   double adderLeft = 0, adderRight = 0;  // to accumulate the angles of every point across an arc to check fastest way
-   double theta1Left[SIZE] = {}, theta2Left[SIZE] = {}, theta1Right[SIZE] = {}, theta2Right[SIZE] = {};
-   double len, xc, yc, radius;               // to copy values of cmdList array and work with smaller commands xc / yc
-                                             // are the coordanates of the center of the arc.
-   double thetaStart, thetaEnd;              // to copy the values of cmdList to to the start and end angles
-
-   xc = cmdList[index].args[0].dValue;
-   yc = cmdList[index].args[1].dValue;
-   radius = cmdList[index].args[2].dValue;
-   thetaStart = degToRad(cmdList[index].args[3].dValue);
-   thetaEnd = degToRad(cmdList[index].args[4].dValue);
-
-
-   // length of arc formular is s times (delta theta)
-   len = abs(cmdList[index].args[2].dValue * (thetaEnd - thetaStart));
-
-   if(_stricmp(cmdList[index].args[cmdList[index].nArgs - 1].strValue, STR_RESOLUTION_HIGH) == 0)
-   {
-      N = getN(len, RESOLUTION_HIGH);
-   }
-   else  if(_stricmp(cmdList[index].args[cmdList[index].nArgs - 1].strValue, STR_RESOLUTION_MEDIUM) == 0)
-
-   {
-      N = getN(len, RESOLUTION_MEDIUM);
-   }
-   else if(_stricmp(cmdList[index].args[cmdList[index].nArgs - 1].strValue, STR_RESOLUTION_LOW) == 0)
-   {
-      N = getN(len, RESOLUTION_LOW);
-   }
-
-
-
-   // to calculate x and y coordinate across the circumference
-   for(i = 0; i <= N - 1; i++)
-   {
-      theta = thetaStart + (thetaEnd - thetaStart) * ((double)i / (N - 1.0));
-      x[i] = xc + radius * cos(theta);
-      y[i] = yc + radius * sin(theta);
-
-      isol = inverseKinematics(x[i], y[i], transformMatrix);
-
-      if(i == N - 1)
-      {
-         state->currentPos.theta1Deg = x[i];
-         state->currentPos.theta2Deg = y[i];
-      }
-
-      theta1Left[i] = isol.theta1DegLeft;
-      theta2Left[i] = isol.theta2DegLeft;
-      theta1Right[i] = isol.theta1DegRight;
-      theta2Right[i] = isol.theta2DegRight;
-      bLeft = bLeft && isol.bLeft;                              // validating left solution
-      bRight = bRight && isol.bRight;                            // validating right solution
-
- // add al angles together to see the most optimal solution
-      adderLeft = isol.theta1DegLeft + isol.theta2DegLeft + adderLeft;
-      adderRight = isol.theta1DegRight + isol.theta2DegRight + adderRight;
-   }
-
-
-   //creating the most efficient path
-   if(bLeft == true && bRight == true)
-   {
-      if(adderLeft < adderRight) bRight = false;
-      else if(adderLeft >= adderRight) bLeft = false;
-   }
-   sprintf_s(commandString, MAX_COMMAND_LENGTH, "PEN_UP\n");
-   robot.Send(commandString);
-
-
-   for(i = 0; i < N; i++) // removed -1 from N
-   {
-      if(bRight == true)
-      {
-         sprintf_s(commandString, "ROTATE_JOINT ANG1 %lf ANG2 %lf\n", theta1Right[i], theta2Right[i]);
-         robot.Send(commandString);
-      }
-      else if(bLeft == true)
-      {
-         sprintf_s(commandString, "ROTATE_JOINT ANG1 %lf ANG2 %lf\n", theta1Left[i], theta2Left[i]);
-         robot.Send(commandString);
-      }
-      if(i == 0)
-      {
-         sprintf_s(commandString, MAX_COMMAND_LENGTH, "PEN_DOWN\n");
-         robot.Send(commandString);
-      }
-
-      if(i == N)
-      {
-         sprintf_s(commandString, "PEN_UP\n");
-         robot.Send(commandString);
-      }
-   }
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-//This function will get x and y coordinates and check that the whole path can be drawn
-//Arguments, the x and y coordinates of every point
-//Return Value, true if its inside the range or false if not.
-bool checkPad(double x, double y)
-{
-
-   return false;
-}
+/**********************************************************************************************************************
+Course: ROBT1270
+
+Program: SCARA Robot Simulator Advanced Control
+
+Purpose: To demonstrate advanced control over the SCARA Robot Simulator by using process abstraction.
+Programming methods: formatted I/O, conditional statements, functions, loops, arrays, data parsing.
+
+Author: Alejandro Fajardo
+
+Date Created: May 18, 2021.
+
+**********************************************************************************************************************/
+
+//-------------------------- Standard library prototypes --------------------------------------------------------------
+#include <stdio.h>  // formatted i/o
+#include <math.h>   // math functions
+#include <stdlib.h> // system function
+#include <string.h> // memcpy, strlen
+#include <float.h>  // DBL_MAX (unlimited number arguments)
+#include <chrono>   // steady clock for trace timestamps
+#include <charconv> // to_chars: locale free number formatting of the robot commands
+#include <thread>   // one worker thread per robot cell in multi-robot mode
+#include <atomic>   // lock-free job queue index shared by the cell workers
+#include <mutex>    // input line queue of the streaming mode
+#include <condition_variable>  // wakes the streaming mode when a line arrives
+#ifdef _WIN32
+#include <winsock2.h>    // sockets of the server mode (before robot.h, which may pull in windows.h)
+#include <windows.h>     // memory-mapped file of the IK cache
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET SOCKET_HANDLE;
+#define closeSocket closesocket
+#define SEND_FLAGS 0
+#else
+#include <sys/socket.h>  // sockets of the server mode
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>      // job directories of the batch planner (FindFirstFile on Windows)
+#include <sys/mman.h>    // memory-mapped file of the IK cache
+#include <sys/file.h>    // flock: one run at a time uses an IK cache file
+#include <sys/stat.h>
+typedef int SOCKET_HANDLE;
+#define INVALID_SOCKET (-1)
+#define closeSocket close
+#define SEND_FLAGS MSG_NOSIGNAL  // a client that went away must not kill the server
+#endif
+#include "robot.h"  // robot functions
+
+CRobot robot;       // the global robot Class
+bool bRobotConnected = false;  // true once the global robot has been initialized
+bool bInteractive = true;      // false when started with command line options: never prompt or wait for ENTER
+int programExitCode = 0;       // exit code of the program (not 0 once a job could not be run)
+bool bPlanCache = false;       // true to reuse the plans of unchanged command lines (--cache)
+bool bPeephole = true;         // true to leave out robot commands that change nothing (--no-peephole turns it off)
+bool bJointEncoding = false;   // true to write compiled command files in the joint delta encoding (--encode)
+
+// robot that the commands of the current thread go to.  The global robot, except in the workers of multi-robot mode
+thread_local CRobot *pActiveRobot = &robot;
+thread_local int activeCellId = -1;   // robot cell run by the current thread (-1 when driving just the global robot)
+thread_local bool bDryRun = false;    // true to plan without sending anything to the robot
+thread_local struct JOINT_TRAJECTORY *pJointCapture = NULL;  // if not NULL, joint setpoints are also stored here
+thread_local struct SERVER_CLIENT *pReplyClient = NULL;  // if not NULL, queryState is also sent to this connection
+thread_local FILE *pJobReport = NULL;  // if not NULL, the messages of the commands run go here (see messageFile)
+thread_local int nRejectedCommands = 0;  // commands that could not be carried out (counted by the batch planner)
+thread_local int jointDecimals = 6;   // decimal places of the joint angles sent to the robot (see jointDecimals)
+thread_local struct COMMAND_OUTPUT *pCommandOutput = NULL;  // if not NULL, robot commands are written here instead
+thread_local struct PLAN_CACHE *pPlanCapture = NULL;  // if not NULL, robot commands are also recorded here
+thread_local const struct PARSED_COMMAND *pNextSegment = NULL;  // command drawn after the current one, if known
+
+
+//---------------------------- Program Constants ----------------------------------------------------------------------
+constexpr double PI = 3.14159265358979323846;
+const int MAX_SPLINE_POINTS = 8;                // maximum number of points of a drawSpline
+const int MAX_ARGS = 1 + 2 * MAX_SPLINE_POINTS; // maximum number of command arguments (drawSpline: resolution, points)
+const size_t MAX_ARG_STRING_LENGTH = 20;        // for sting arguments, i.e., "HIGH", "DOWN", "ON"
+const size_t MAX_COMMAND_LENGTH = 256;          // maximum number of characters in command string
+const size_t MAX_MESSAGE_LENGTH = 256;          // maximum number of characters in error message string
+const size_t MAX_FILENAME_LENGTH = 256;         // maximum number of characters in a filename (includes path)
+const char *TRACE_FILENAME = "trace.json";      // chrome trace-event file written while the trace is ON
+const size_t TRACE_BUFFER_SIZE = 64 * 1024;     // trace events are buffered and written to disk in blocks this big
+const size_t TRACE_MAX_EVENT_LENGTH = 256;      // maximum number of characters in one trace event
+const char *ROBOT_PROFILE_FILENAME = "robot_profile.txt";  // robot model loaded at startup (if the file exists)
+const int MAX_ROBOT_CELLS = 16;                 // maximum number of robots driven at once in multi-robot mode
+const int MAX_JOBS = 16384;                     // maximum number of job files in a manifest or job directory
+const int MAX_BATCH_THREADS = 64;               // most jobs the batch planner plans at once
+const char *STR_COMPILED_EXTENSION = ".robot";  // batch planner: robot commands of a job, in the output directory
+const char *STR_REPORT_EXTENSION = ".report.txt";  // batch planner: what went wrong planning a job
+const char *STR_PLAN_CACHE_EXTENSION = ".plancache";  // plan cache of a command file (--cache)
+const char PLAN_CACHE_MAGIC[8] = "SCARAPC";     // start of a plan cache file
+const int PLAN_CACHE_VERSION = 2;               // plan cache files of another version are ignored
+// most bytes a plan key is hashed from: a command and the one after it (see getPlanKey), the state and the profile
+const size_t MAX_PLAN_INPUTS = 2 * (2 * sizeof(int) + MAX_ARGS * sizeof(double) + MAX_FILENAME_LENGTH) + 256;
+
+// joint delta encoding of compiled command files (--encode).  Each record starts with one of the JOINT_RECORD tags
+const char *STR_ENCODED_EXTENSION = ".robotj";  // batch planner: encoded robot commands of a job
+const char JOINT_STREAM_MAGIC[8] = "SCARAJD";   // start of an encoded command file
+const int JOINT_STREAM_VERSION = 1;             // written after the magic
+const int JOINT_KEYFRAME_INTERVAL = 64;         // setpoints between two absolute keyframes
+enum JOINT_RECORD { JOINT_RECORD_TEXT, JOINT_RECORD_KEYFRAME, JOINT_RECORD_DELTA, JOINT_RECORD_PEN_UP,
+   JOINT_RECORD_PEN_DOWN };
+
+// run estimate (--estimate).  A joint move accelerates, cruises and brakes (trapezoid), one setpoint after the other
+const double ESTIMATE_MAX_VELOCITY_DEG[2] = {180.0, 240.0};     // joint speeds if the robot profile has none (deg/s)
+const double ESTIMATE_MAX_ACCELERATION_DEG[2] = {720.0, 960.0}; // joint accelerations if the profile has none
+const double ESTIMATE_PEN_SECONDS = 0.25;       // time of a PEN_UP or PEN_DOWN
+
+// shared workspace (two arms, one drawing area) collision checking.  Time is counted in joint setpoints ("ticks")
+const double LINK_CAPSULE_RADIUS = 25.0;        // half width of an arm link plus clearance (mm)
+const double COLLISION_CELL_SIZE = 150.0;       // cell size of the spatial hash (mm)
+const int COLLISION_SLICE_TICKS = 8;            // ticks per time slice of the spatial hash
+const int COLLISION_TIME_MARGIN = 2;            // a link is treated as present this many ticks before and after
+const int COLLISION_HASH_BUCKETS = 1 << 16;     // number of buckets in the spatial hash (power of 2)
+const int MAX_WAIT_TICKS = 100000;              // give up waiting for the other arm after this many ticks
+
+// streaming mode (lookahead over the commands typed/streamed in)
+const int LOOKAHEAD_DEPTH = 8;                  // maximum number of commands held back to plan paths
+const double LOOKAHEAD_MAX_LATENCY_MS = 200.0;  // a command never waits longer than this before it runs
+const double PATH_JOIN_TOLERANCE = 0.01;        // a segment continues a path if it starts this close to its end (mm)
+const int INPUT_QUEUE_DEPTH = 64;               // lines read ahead of the streaming mode
+
+// server mode (command streams from other programs over local TCP connections)
+const unsigned short SERVER_PORT = 5270;        // port listened to on 127.0.0.1
+const int MAX_SERVER_CLIENTS = 8;               // maximum number of connections at once
+const int SERVER_QUEUE_DEPTH = 32;              // commands received but not yet run.  Clients aren't read when full
+const size_t SERVER_INPUT_BUFFER = 4 * MAX_COMMAND_LENGTH;   // received bytes not yet split into lines
+const size_t SERVER_REPLY_BUFFER = 64 * 1024;   // replies not yet sent to a client
+const size_t SERVER_REPLY_HIGH_WATER = 32 * 1024;  // a client isn't read while more replies than this are unsent
+const char *STR_SERVER_QUIT = "Q";              // a client line that closes its connection
+const char *STR_SERVER_STOP = "STOP_SERVER";    // a client line that stops the server once its queue has run
+const char *STR_SERVER_CANCEL = "STOP";         // a client line that stops the shape being drawn and drops the queue
+const int SERVER_STEP_CREDIT = 8;               // robot commands a shape may send before the connections are served
+
+// point files (drawPoints)
+const int POINTS_BATCH = 256;                   // points read, transformed and solved at a time
+const double POINTS_ROW_HEIGHT = 5.0;           // height of the rows of the SERPENTINE point order (mm)
+const char *STR_POINTS_BINARY_EXTENSION = ".bin";  // point files with this extension hold pairs of doubles x, y
+
+// curves (drawQuadBezier, drawCubicBezier, drawSpline)
+const double CURVE_FLATNESS[] = {0.5, 0.2, 0.05};  // furthest a curve strays from its chords (mm), LOW/MEDIUM/HIGH
+const int CURVE_PIECES_PER_SPAN = 4;            // each cubic is split in 4 so flat parts get fewer points (power of 2)
+const int MAX_CURVE_PIECES = CURVE_PIECES_PER_SPAN * (MAX_SPLINE_POINTS - 1);  // pieces of the longest curve
+
+// imported drawings (importDrawing)
+const char *STR_SVG_EXTENSION = ".svg";        // files with this extension are SVG, any other file is G-code
+const double MM_PER_INCH = 25.4;                // G-code G20 coordinates are in inches
+const size_t MAX_NUMBER_LENGTH = 64;            // longest number read from SVG path data
+
+// automatic placement of a job (autoFit)
+const double AUTOFIT_GRID_MM = 0.5;             // job points closer than this are checked once
+const double AUTOFIT_REACH_MARGIN = 1.0;        // points must be this far inside LMIN/LMAX (covers AUTOFIT_GRID_MM)
+const int AUTOFIT_RADIUS_STEPS = 24;            // distances from the shoulder tried for the job, out to LMAX
+const double AUTOFIT_ANGLE_STEP_DEG = 10.0;     // directions around the shoulder tried for the job
+const double AUTOFIT_ROTATION_STEP_DEG = 15.0;  // rotations of the job tried
+const double AUTOFIT_SCALE_STEP = 0.1;          // with SCALE the job is shrunk in these steps until it fits
+const int AUTOFIT_MAX_THREADS = 16;             // candidate poses are checked by up to this many threads
+
+// bounds of whole shapes, checked before their points are solved (probeShapeArms)
+const double BOUNDS_ARC_STEP_DEG = 22.5;        // arcs are bounded piece by piece (the bound is < 2% of r too wide)
+const double BOUNDS_MARGIN_MM = 0.1;            // a shape must be this far inside LMAX for its points not to be checked
+const double BOUNDS_MARGIN_DEG = 0.1;           // and its joint angles this far inside their limits
+
+// singularity guard (singularityGuard ON)
+const double SINGULARITY_ZONE_DEG = 10.0;       // near-singular: elbow this close to straight or to its limit
+const double SINGULARITY_MAX_STEP_DEG = 1.0;    // near-singular moves are split so no joint turns more per point
+const int SINGULARITY_MAX_SUBSTEPS = 64;        // most points added between two points of a shape
+
+// continuous path mode (continuousPath ON).  A corner is cut between points on both segments, moved in halfway each
+// time until the joint move between them passes within the tolerance of the corner's joint angles
+const double BLEND_MAX_TOLERANCE_DEG = 10.0;    // largest joint tolerance of a blended corner
+const int BLEND_MAX_HALVINGS = 8;               // tries at cutting a corner before it is sent as it is
+
+// IK cache (--ik-cache): points and joint angles of the shapes drawn, kept in a memory-mapped file across runs
+const char IK_CACHE_MAGIC[8] = "SCARAIK";       // start of an IK cache file
+const int IK_CACHE_VERSION = 1;                 // files of another version or layout are emptied
+const int IK_CACHE_SLOTS = 65536;               // hash table slots (a power of 2, at most half of them used)
+const int IK_CACHE_BLOCK_POINTS = 64;           // points per block of the file (a shape uses a chain of blocks)
+const size_t IK_CACHE_MAX_BYTES = 64 * 1024 * 1024;  // size of the cache file; least recently used shapes go first
+const int IK_CACHE_MAX_POINTS = 8192;           // shapes with more points are not cached
+const int IK_POINT_VALUES = 6;                  // x, y, then theta1/theta2 of the left and of the right arm
+
+
+const int NO_FILE_LINE = 0;  			// for parseCommand to differentiate between file and keyboard input
+
+// compile-time math used to derive the reach of each arm geometry (std sqrt/cos are not constexpr)
+constexpr double constexprSqrt(double v)
+{
+   double r = v > 1.0 ? v : 1.0;  // Newton iterations from above converge for any v >= 0
+   for(int i = 0; i < 100; i++) r = 0.5 * (r + v / r);
+   return r;
+}
+constexpr double constexprCos(double rad)
+{
+   while(rad > PI) rad -= 2.0 * PI;    // reduce to [-PI, PI] so the series converges quickly
+   while(rad < -PI) rad += 2.0 * PI;
+   double term = 1.0, sum = 1.0;
+   for(int k = 1; k < 30; k++)
+   {
+      term *= -rad * rad / ((2.0 * k - 1.0) * (2.0 * k));
+      sum += term;
+   }
+   return sum;
+}
+
+// arm geometry of each supported robot model.  The kinematics are templates on these types, so the link lengths 
+// and joint limits of every model are constants in its own IK/FK.  Add a struct here, an entry to ROBOT_MODEL and 
+// a case to solveInverseKinematics/precisionReport to support a new model.
+struct ARM_SCARA600
+{
+   static constexpr double L1 = 350.0;                  // length of inner arm
+   static constexpr double L2 = 250.0;                  // length of outer arm
+   static constexpr double MAX_ABS_THETA1_DEG = 150.0;  // maximum shoulder angle (CW or CCW)
+   static constexpr double MAX_ABS_THETA2_DEG = 170.0;  // maximum elbow bend angle (CW or CCW)
+};
+struct ARM_SCARA450
+{
+   static constexpr double L1 = 250.0;
+   static constexpr double L2 = 200.0;
+   static constexpr double MAX_ABS_THETA1_DEG = 140.0;
+   static constexpr double MAX_ABS_THETA2_DEG = 160.0;
+};
+struct ARM_SCARA800
+{
+   static constexpr double L1 = 450.0;
+   static constexpr double L2 = 350.0;
+   static constexpr double MAX_ABS_THETA1_DEG = 150.0;
+   static constexpr double MAX_ABS_THETA2_DEG = 165.0;
+};
+// arm geometry read from the robot profile file at startup.  Same interface as the models above but the values
+// are only known at run time (they refer into robotProfile)
+struct ARM_PROFILE
+{
+   static const double &L1;
+   static const double &L2;
+   static const double &MAX_ABS_THETA1_DEG;
+   static const double &MAX_ABS_THETA2_DEG;
+};
+
+// max/min reach of an arm geometry, worked out at compile time
+template<class ARM> struct ARM_REACH
+{
+   static constexpr double LMAX = ARM::L1 + ARM::L2;
+   static constexpr double LMIN = constexprSqrt(ARM::L1 * ARM::L1 + ARM::L2 * ARM::L2 -
+      2.0 * ARM::L1 * ARM::L2 * constexprCos(PI - ARM::MAX_ABS_THETA2_DEG * PI / 180.0));
+};
+template<> struct ARM_REACH<ARM_PROFILE>  // worked out once when the profile is loaded
+{
+   static const double &LMAX;
+   static const double &LMIN;
+};
+
+// robot model names (for the robotModel command).  Order must match ROBOT_MODEL
+constexpr const char *STR_ROBOT_MODELS[] = {"SCARA600", "SCARA450", "SCARA800", "PROFILE"};
+enum ROBOT_MODEL
+{
+   ROBOT_MODEL_SCARA600, ROBOT_MODEL_SCARA450, ROBOT_MODEL_SCARA800, ROBOT_MODEL_PROFILE, NUM_ROBOT_MODELS
+};
+
+// geometry of the default model (ARM_SCARA600)
+const double L1 = ARM_SCARA600::L1;                  	// length of inner arm
+const double L2 = ARM_SCARA600::L2;                  	// length of outer arm
+const double MAX_ABS_THETA1_DEG = ARM_SCARA600::MAX_ABS_THETA1_DEG;  	// maximum shoulder angle (CW or CCW)
+const double MAX_ABS_THETA2_DEG = ARM_SCARA600::MAX_ABS_THETA2_DEG;  	// maximum elbow bend angle (CW or CCW)
+
+// max/min reach of the robot
+const double LMAX = ARM_REACH<ARM_SCARA600>::LMAX;
+const double LMIN = ARM_REACH<ARM_SCARA600>::LMIN;
+
+// motor speed constants
+constexpr const char *STR_MOTOR_SPEED_LOW = "LOW";
+constexpr const char *STR_MOTOR_SPEED_MEDIUM = "MEDIUM";
+constexpr const char *STR_MOTOR_SPEED_HIGH = "HIGH";
+enum MOTOR_SPEED { MOTOR_SPEED_LOW, MOTOR_SPEED_MEDIUM, MOTOR_SPEED_HIGH };  // enum sets 1st value to 0, 2nd to 1, ..
+
+// object drawing resolution constants (for rectangle, triangle, arc, line) 
+constexpr const char *STR_RESOLUTION_LOW = "LOW";
+constexpr const char *STR_RESOLUTION_MEDIUM = "MEDIUM";
+constexpr const char *STR_RESOLUTION_HIGH = "HIGH";
+enum RESOLUTION { RESOLUTION_LOW, RESOLUTION_MEDIUM, RESOLUTION_HIGH };
+
+// pen position constants
+constexpr const char *STR_PEN_UP = "UP";
+constexpr const char *STR_PEN_DOWN = "DOWN";
+enum PEN_POSITION { PEN_UP, PEN_DOWN };
+
+// cycle pen colors constants
+constexpr const char *STR_CYCLE_PEN_COLORS_ON = "ON";
+constexpr const char *STR_CYCLE_PEN_COLORS_OFF = "OFF";
+enum CYCLE_PEN_COLORS { CYCLE_PEN_COLORS_ON, CYCLE_PEN_COLORS_OFF };
+
+// job trace constants
+constexpr const char *STR_TRACE_ON = "ON";
+constexpr const char *STR_TRACE_OFF = "OFF";
+enum TRACE { TRACE_ON, TRACE_OFF };
+
+// kinematics precision constants (DOUBLE is the reference, FLOAT is the opt-in reduced precision path)
+constexpr const char *STR_PRECISION_DOUBLE = "DOUBLE";
+constexpr const char *STR_PRECISION_FLOAT = "FLOAT";
+enum KINEMATICS_PRECISION { PRECISION_DOUBLE, PRECISION_FLOAT };
+
+// point order constants (drawPoints).  SERPENTINE sorts the points into rows drawn in alternate directions
+constexpr const char *STR_POINT_ORDER_KEEP = "KEEP";
+constexpr const char *STR_POINT_ORDER_SERPENTINE = "SERPENTINE";
+enum POINT_ORDER { POINT_ORDER_KEEP, POINT_ORDER_SERPENTINE };
+
+// autoFit constants.  SCALE may shrink the job to make it fit
+constexpr const char *STR_AUTOFIT_FIXED = "FIXED";
+constexpr const char *STR_AUTOFIT_SCALE = "SCALE";
+enum AUTOFIT_SCALING { AUTOFIT_FIXED, AUTOFIT_SCALE };
+
+// singularity guard constants
+constexpr const char *STR_SINGULARITY_GUARD_ON = "ON";
+constexpr const char *STR_SINGULARITY_GUARD_OFF = "OFF";
+enum SINGULARITY_GUARD { SINGULARITY_GUARD_ON, SINGULARITY_GUARD_OFF };
+
+// continuous path constants
+constexpr const char *STR_CONTINUOUS_PATH_ON = "ON";
+constexpr const char *STR_CONTINUOUS_PATH_OFF = "OFF";
+enum CONTINUOUS_PATH { CONTINUOUS_PATH_ON, CONTINUOUS_PATH_OFF };
+
+const double PRECISION_REPORT_STEP_DEG = 0.5;  // joint angle step used to sweep the workspace in precisionReport
+
+// limits for colors
+const int COLOR_MIN = 0;
+const int COLOR_MAX = 255;
+
+// limits for the decimal places of the joint angles sent to the robot
+const int JOINT_DECIMALS_MIN = 0;
+const int JOINT_DECIMALS_MAX = 9;
+
+// arm position constants
+enum ARM_POSITION { LEFT_ARM, RIGHT_ARM, NO_ARM }; // no arm means can't reach a point.  Used in checkPath.
+
+// index of each SCARA command
+
+enum COMMAND_LIST_INDEX
+{
+   INDEX_MOTOR_SPEED, INDEX_PEN_POS, INDEX_PEN_COLOR, INDEX_CYCLE_PEN_COLORS, INDEX_CLEAR_TRACE,
+   INDEX_CLEAR_REMOTE_COMMAND_LOG, INDEX_CLEAR_POSITION_LOG, INDEX_SHUTDOWN_SIMULATION,
+   INDEX_END_REMOTE_CONNECTION, INDEX_HOME, INDEX_MOVE_TO, INDEX_DRAW_LINE, INDEX_DRAW_ARC,
+   INDEX_DRAW_RECTANGLE, INDEX_DRAW_TRIANGLE, INDEX_ADD_ROTATION, INDEX_ADD_TRANSLATION, INDEX_ADD_SCALING,
+   INDEX_RESET_TRANSFORMATION_MATRIX, INDEX_QUERY_STATE, INDEX_TRACE,
+   INDEX_KINEMATICS_PRECISION, INDEX_PRECISION_REPORT, INDEX_ROBOT_MODEL, INDEX_JOINT_DECIMALS,
+   INDEX_DRAW_POINTS, INDEX_DRAW_QUAD_BEZIER, INDEX_DRAW_CUBIC_BEZIER, INDEX_DRAW_SPLINE,
+   INDEX_IMPORT_DRAWING, INDEX_AUTO_FIT, INDEX_SINGULARITY_GUARD, INDEX_CONTINUOUS_PATH,
+   NUM_COMMANDS
+};
+const int NUM_SCARA_COMMANDS = NUM_COMMANDS; 	// number of abstracted SCARA commands. 
+
+// argument types of the commands (see ARG_SCHEMA).  An ARG_PATH is the rest of the line, so it must come last
+enum ARG_TYPE { ARG_DOUBLE, ARG_INT, ARG_KEYWORD, ARG_PATH };
+
+// keywords of the keyword arguments.  Order must match the enum of each
+constexpr const char *MOTOR_SPEED_KEYWORDS[] = {STR_MOTOR_SPEED_LOW, STR_MOTOR_SPEED_MEDIUM, STR_MOTOR_SPEED_HIGH};
+constexpr const char *RESOLUTION_KEYWORDS[] = {STR_RESOLUTION_LOW, STR_RESOLUTION_MEDIUM, STR_RESOLUTION_HIGH};
+constexpr const char *PEN_POSITION_KEYWORDS[] = {STR_PEN_UP, STR_PEN_DOWN};
+constexpr const char *CYCLE_PEN_COLORS_KEYWORDS[] = {STR_CYCLE_PEN_COLORS_ON, STR_CYCLE_PEN_COLORS_OFF};
+constexpr const char *TRACE_KEYWORDS[] = {STR_TRACE_ON, STR_TRACE_OFF};
+constexpr const char *PRECISION_KEYWORDS[] = {STR_PRECISION_DOUBLE, STR_PRECISION_FLOAT};
+constexpr const char *POINT_ORDER_KEYWORDS[] = {STR_POINT_ORDER_KEEP, STR_POINT_ORDER_SERPENTINE};
+constexpr const char *AUTOFIT_KEYWORDS[] = {STR_AUTOFIT_FIXED, STR_AUTOFIT_SCALE};
+constexpr const char *SINGULARITY_GUARD_KEYWORDS[] = {STR_SINGULARITY_GUARD_ON, STR_SINGULARITY_GUARD_OFF};
+constexpr const char *CONTINUOUS_PATH_KEYWORDS[] = {STR_CONTINUOUS_PATH_ON, STR_CONTINUOUS_PATH_OFF};
+
+enum INPUT_MODE { KEYBOARD_INPUT, FILE_INPUT, MULTI_ROBOT_INPUT, SHARED_WORKSPACE_INPUT, STREAM_INPUT,
+   SERVER_INPUT, BATCH_INPUT }; // for users choice
+constexpr const char *INPUT_MODE_NAMES[] = {"keyboard", "file", "multi", "shared", "stream", "server", "batch"};
+constexpr int NUM_INPUT_MODES = sizeof(INPUT_MODE_NAMES) / sizeof(INPUT_MODE_NAMES[0]);
+
+
+
+//----------------------------- Program Structures --------------------------------------------------------------------
+
+typedef struct RGB_COLOR // for describing pen RGB color
+{
+   int r, g, b;   		// red, green, blue components (0-255 each)
+}
+RGB_COLOR;
+
+
+
+typedef struct SCARA_POSITION  	// to store the current position of the pen.  Note that armPos is redundant.
+{
+   double x, y, theta1Deg, theta2Deg;
+   int armPos;
+}
+SCARA_POSITION;
+
+
+
+typedef struct SCARA_STATE  	// used to store the current state of the robot.
+{
+   SCARA_POSITION currentPos;
+   int motorSpeed, penPos, cyclePenColors;
+   RGB_COLOR penColor;
+   int kinematicsPrecision;   // PRECISION_DOUBLE or PRECISION_FLOAT, selected per job
+   int robotModel;            // one of ROBOT_MODEL, picks the arm geometry used by the kinematics
+   int pathArm;               // arm to keep using while a path continues (NO_ARM to choose per shape)
+   bool bJoinPath;            // true if the next shape starts where the pen is (don't lift it)
+   bool bSingularityGuard;    // true to add points and slow down where the arm is near a singularity
+   bool bContinuousPath;      // true to keep the pen down on shapes that start where the pen is (continuousPath)
+   double blendToleranceDeg;  // joint tolerance the corners between them are cut to (0 for sharp corners)
+}
+SCARA_STATE;
+
+				
+// forward solution is NEVER TRANSFORMED!!
+typedef struct FORWARD_SOLUTION	// encapsulates both x and y for forward solution 
+{
+   double x, y;
+   bool bHasSolution;
+}
+FORWARD_SOLUTION;
+
+
+
+typedef struct INVERSE_SOLUTION	// encapsulates both right/left arm angles for inverse solution
+{
+   double theta1DegLeft, theta1DegRight;  // right arm solution
+   double theta2DegLeft, theta2DegRight;  // left arm solution
+   bool bLeft, bRight;                    // true if has solution
+}
+INVERSE_SOLUTION;
+
+
+// a union is used to save space. ONLY ONE PARAMETER CAN BE USED AT A TIME BECAUSE THE MEMORY IS SHARED
+typedef union COMMAND_ARGUMENT
+{
+   double dValue; // to store floating point values
+   int iValue;    // to store integer values and keyword arguments (like "HIGH", "MEDIUM", "LOW") as enum values
+}
+COMMAND_ARGUMENT;
+
+
+// what an argument of a command must look like.  parseCommand checks every argument against it
+typedef struct ARG_SCHEMA
+{
+   int type;                  // ARG_TYPE
+   double minValue, maxValue; // valid range of ARG_INT and ARG_DOUBLE values
+   const char *const *keywords;  // ARG_KEYWORD: the valid words.  The position of the word is stored (in iValue)
+   int nKeywords;             // number of keywords
+}
+ARG_SCHEMA;
+
+
+// struct to hold the description of abstracted commands like drawRectangle (see SCARA_COMMANDS)
+typedef struct SCARA_COMMAND
+{
+   const char *cmdName;       // name of the command.  Pointer points at hardcoded string constant.
+   const char *strArgs;       // names of all arguments.  Pointer points at hardcoded string constant.
+   int nArgs;                 // number of input arguments for the command
+   ARG_SCHEMA args[MAX_ARGS]; // type and valid values of each argument
+   int nMinArgs = 0;          // if not 0, the arguments after the first nMinArgs are optional x, y pairs
+}
+SCARA_COMMAND;
+
+
+// a parsed command: plain values, so it can be copied, queued and reordered freely
+typedef struct PARSED_COMMAND
+{
+   int index;                           // index of the command in SCARA_COMMANDS
+   int lineNumber;                      // line of the file it was read from, or -1
+   int nArgs;                           // number of arguments given (less than the schema's with optional pairs)
+   COMMAND_ARGUMENT args[MAX_ARGS];     // argument values
+   char strPath[MAX_FILENAME_LENGTH];   // value of the ARG_PATH argument, if the command has one
+}
+PARSED_COMMAND;
+
+
+// schemas of the argument types: any number, a whole number in a range, or one of a list of words
+constexpr ARG_SCHEMA argDouble() { return {ARG_DOUBLE, -DBL_MAX, DBL_MAX, NULL, 0}; }
+constexpr ARG_SCHEMA argDouble(double minValue, double maxValue) { return {ARG_DOUBLE, minValue, maxValue, NULL, 0}; }
+constexpr ARG_SCHEMA argInt(int minValue, int maxValue)
+{
+   return {ARG_INT, (double)minValue, (double)maxValue, NULL, 0};
+}
+template<size_t N> constexpr ARG_SCHEMA argKeyword(const char *const (&keywords)[N])
+{
+   return {ARG_KEYWORD, 0.0, 0.0, keywords, (int)N};
+}
+constexpr ARG_SCHEMA argPath() { return {ARG_PATH, 0.0, 0.0, NULL, 0}; }
+
+// every SCARA command: its name, a description of its arguments and their schema.  Order must match COMMAND_LIST_INDEX
+constexpr SCARA_COMMAND SCARA_COMMANDS[NUM_COMMANDS] =
+{
+   {"motorSpeed", "Arg that should be either HIGH / MEDIUM / LOW", 1, {argKeyword(MOTOR_SPEED_KEYWORDS)}},
+   {"penPos", "Arg that should be either UP / DOWN", 1, {argKeyword(PEN_POSITION_KEYWORDS)}},
+   {"penColor", "3 int numbers between 0 and 255 r g b", 3,
+      {argInt(COLOR_MIN, COLOR_MAX), argInt(COLOR_MIN, COLOR_MAX), argInt(COLOR_MIN, COLOR_MAX)}},
+   {"cyclePenColors", "Arg that should be either ON / OFF", 1, {argKeyword(CYCLE_PEN_COLORS_KEYWORDS)}},
+   {"clearTrace", "NONE", 0, {}},
+   {"clearRemoteCommandLog", "NONE", 0, {}},
+   {"clearPositionLog", "NONE", 0, {}},
+   {"shutdownSimulation", "NONE", 0, {}},
+   {"endRemoteConnection", "NONE", 0, {}},
+   {"home", "NONE", 0, {}},
+   {"moveTo", "x , y", 2, {argDouble(), argDouble()}},
+   {"drawLine", "x1, y1, x1, y1, resolution", 5,
+      {argDouble(), argDouble(), argDouble(), argDouble(), argKeyword(RESOLUTION_KEYWORDS)}},
+   {"drawArc", "Xc, Yc, r, thetaDegStart, thetaDegEnd, resolution", 6,
+      {argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argKeyword(RESOLUTION_KEYWORDS)}},
+   {"drawRectangle", "Xbl,Ybl, Xtr, Ytr, resolution", 5,
+      {argDouble(), argDouble(), argDouble(), argDouble(), argKeyword(RESOLUTION_KEYWORDS)}},
+   {"drawTriangle", "Xbl, Ybl, Xt, Yt, Xbr, Ybr, resolution", 7,
+      {argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argKeyword(RESOLUTION_KEYWORDS)}},
+   {"addRotation", "rotationDeg", 1, {argDouble()}},
+   {"addTranslation", "dx, dy", 2, {argDouble(), argDouble()}},
+   {"addScaling", "SX, SY", 2, {argDouble(), argDouble()}},
+   {"resetTransformMatrix", "NONE", 0, {}},
+   {"queryState", "NONE", 0, {}},
+   {"trace", "Arg that should be either ON / OFF", 1, {argKeyword(TRACE_KEYWORDS)}},
+   {"kinematicsPrecision", "Arg that should be either DOUBLE / FLOAT", 1, {argKeyword(PRECISION_KEYWORDS)}},
+   {"precisionReport", "NONE", 0, {}},
+   {"robotModel", "Arg that should be either SCARA600 / SCARA450 / SCARA800 / PROFILE", 1,
+      {argKeyword(STR_ROBOT_MODELS)}},
+   {"jointDecimals", "number of decimal places (0 to 9) of the joint angles sent to the robot", 1,
+      {argInt(JOINT_DECIMALS_MIN, JOINT_DECIMALS_MAX)}},
+   {"drawPoints", "KEEP / SERPENTINE order, point file (x, y lines, or pairs of doubles if it ends in .bin)", 2,
+      {argKeyword(POINT_ORDER_KEYWORDS), argPath()}},
+   {"drawQuadBezier", "x0, y0, x1, y1 (control point), x2, y2, resolution", 7,
+      {argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argKeyword(RESOLUTION_KEYWORDS)}},
+   {"drawCubicBezier", "x0, y0, x1, y1, x2, y2 (control points), x3, y3, resolution", 9,
+      {argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(),
+       argKeyword(RESOLUTION_KEYWORDS)}},
+   {"drawSpline", "resolution, then 2 to 8 points x, y the curve goes through", MAX_ARGS,
+      {argKeyword(RESOLUTION_KEYWORDS), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(),
+       argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(), argDouble(),
+       argDouble(), argDouble()}, 5},
+   {"importDrawing", "resolution, G-code file (G0 to G3) or .svg file (<path> data, the y axis points down)", 2,
+      {argKeyword(RESOLUTION_KEYWORDS), argPath()}},
+   {"autoFit", "FIXED / SCALE (may shrink the job), command file of the job to place in reach of the robot", 2,
+      {argKeyword(AUTOFIT_KEYWORDS), argPath()}},
+   {"singularityGuard", "Arg that should be either ON / OFF", 1, {argKeyword(SINGULARITY_GUARD_KEYWORDS)}},
+   {"continuousPath", "ON / OFF, joint tolerance (0 to 10 deg) the corners between connected shapes are cut to", 2,
+      {argKeyword(CONTINUOUS_PATH_KEYWORDS), argDouble(0.0, BLEND_MAX_TOLERANCE_DEG)}},
+};
+static_assert(SCARA_COMMANDS[NUM_COMMANDS - 1].cmdName != NULL, "SCARA_COMMANDS needs an entry for every command");
+
+
+// struct to hold info related for drawing an arc
+typedef struct ARC_INFO
+{
+   double thetaARad, thetaBRad, Xc, Yc, R;
+   RGB_COLOR rgb;
+}ARC_INFO;
+
+
+//structure that holds the line information of a straightline
+typedef struct LINE_INFO
+{
+   double X0, Y0, X1, Y1;
+   RGB_COLOR rgb;
+   int N;
+
+}LINE_INFO;
+
+
+// buffered writer for the chrome trace-event (Perfetto) job timeline.  Events are appended to the buffer by the
+// thread running the job and only reach the disk when the buffer fills or the trace is closed, so no locks are needed
+typedef struct TRACE_WRITER
+{
+   FILE *fo;                        // trace file, NULL when tracing is off
+   char buffer[TRACE_BUFFER_SIZE];  // events not yet written to the file
+   size_t used;                     // number of characters used in buffer
+   bool bFirstEvent;                // true until the first event is written (no leading comma)
+}
+TRACE_WRITER;
+
+thread_local TRACE_WRITER traceWriter = {};  // the job trace of this thread.  Closed (fo == NULL) until "trace ON"
+
+
+// robot model read from the robot profile file.  Filled in once by loadRobotProfile before any commands run and
+// never written again, so planning threads can all read it.  Aligned so it doesn't share cache lines.
+typedef struct alignas(64) ROBOT_PROFILE
+{
+   char name[MAX_ARG_STRING_LENGTH];         // model name from the file
+   bool bLoaded;                             // true once a profile file has been read successfully
+   double L1, L2;                            // link lengths
+   double maxAbsTheta1Deg, maxAbsTheta2Deg;  // joint limits (CW or CCW)
+   double LMIN, LMAX;                        // reach, derived from the above
+   double homeDeg[2];                        // joint angles after HOME (deg, joint 1 then joint 2)
+   double xHome, yHome;                      // pen position there, derived from homeDeg
+   double maxVelocityDeg[2];                 // per joint max velocity (deg/s)
+   double maxAccelerationDeg[2];             // per joint max acceleration (deg/s^2)
+   bool bSpeedSupported[3];                  // speed table, indexed by MOTOR_SPEED
+   double speedScale[3];                     // fraction of max velocity used at each supported speed
+}
+ROBOT_PROFILE;
+
+
+// one robot cell of multi-robot mode.  Everything a job touches lives here, so cells never share mutable data.
+typedef struct SCARA_CELL
+{
+   int id;                                      // cell number (0 based)
+   CRobot *pRobot;                              // connection to this cell's robot
+   SCARA_STATE state;                           // current state of this cell's robot
+   double transformMatrix[3][3];                // this cell's transform stack
+   int nJobsRun;                                // number of jobs this cell has run
+}
+SCARA_CELL;
+
+
+// the job queue shared by all the cells.  Filled before the workers start; workers claim jobs by bumping nextJob
+typedef struct JOB_QUEUE
+{
+   char (*fileNames)[MAX_FILENAME_LENGTH];      // job file names (dynamic array)
+   int nJobs;                                   // number of jobs in fileNames
+   std::atomic<int> nextJob;                    // index of the next job not yet claimed by a cell
+}
+JOB_QUEUE;
+
+
+// robot commands written to a file instead of being sent: the compiled command file of a batch job (see runBatchJob)
+// or the --output file.  With no file they are only counted (--dry-run, --estimate, --benchmark)
+typedef struct COMMAND_OUTPUT
+{
+   FILE *fo;                                    // the compiled command file (NULL to only count the commands)
+   int nCommands;                               // robot commands written
+   int nSetpoints;                              // ROTATE_JOINT commands among them
+   int nUnreachable;                            // shapes no arm could draw
+   int nPenMoves;                               // PEN_UP and PEN_DOWN commands
+   int motorSpeed;                              // last MOTOR_SPEED written
+   double theta1Deg, theta2Deg;                 // last joint setpoint
+   double travelDeg[2];                         // total travel of each joint
+   double seconds;                              // estimated time the robot takes to run the commands
+   struct JOINT_ENCODER *pEncoder;              // if not NULL, fo is written in the joint delta encoding
+}
+COMMAND_OUTPUT;
+
+
+// joint delta encoding of a compiled command file (--encode), also used to decode one.  A ROTATE_JOINT is written as
+// the change of each angle, in units of its last decimal place, from the setpoint before, packed as varints.  An
+// absolute keyframe comes first, every JOINT_KEYFRAME_INTERVAL setpoints and when the decimal places change, so a
+// reader can start again at any keyframe.  PEN_UP and PEN_DOWN are just their tag; other commands (and setpoints
+// that don't read back the same) are text
+typedef struct JOINT_ENCODER
+{
+   long long q[2];                              // last setpoint, in units of its last decimal place
+   int decimals;                                // its decimal places
+   int nSinceKeyframe;                          // setpoints since the last keyframe (-1 before the first)
+   long long nTextBytes, nEncodedBytes;         // size of the commands as text and encoded
+}
+JOINT_ENCODER;
+
+
+// what the robot driven by a thread was last told, so that sendToRobot can leave out the commands that change
+// nothing (see isRedundantCommand).  An empty string means not known
+typedef struct ROBOT_STREAM
+{
+   char pen[MAX_COMMAND_LENGTH];                // last PEN_UP or PEN_DOWN
+   char speed[MAX_COMMAND_LENGTH];              // last MOTOR_SPEED
+   char color[MAX_COMMAND_LENGTH];              // last PEN_COLOR
+   char cycle[MAX_COMMAND_LENGTH];              // last CYCLE_PEN_COLOR
+   char joints[MAX_COMMAND_LENGTH];             // last ROTATE_JOINT
+   char held[MAX_COMMAND_LENGTH];               // PEN_UP held back to see if PEN_DOWN comes next ("" if none)
+   int nRemoved;                                // commands left out
+}
+ROBOT_STREAM;
+
+
+// what the plan of a command depends on, as the bytes its key is hashed from (see getPlanKey)
+typedef struct PLAN_INPUTS
+{
+   char bytes[MAX_PLAN_INPUTS];                 // the command, the state it starts in, ...
+   size_t length;                               // bytes used
+}
+PLAN_INPUTS;
+
+
+// one command line of a plan cache: the robot commands it was planned into and the state it left the robot in
+typedef struct PLAN_CACHE_ENTRY
+{
+   unsigned long long key;                      // hash of the command and the state it started in (see getPlanKey)
+   size_t inputStart, inputLength;              // the inputs of the key, in the cache's text
+   SCARA_STATE state;                           // state after the command
+   double transformMatrix[3][3];                // transform matrix after the command
+   int jointDecimals;                           // jointDecimals after the command
+   int nUnreachable;                            // shapes of the command no arm could draw
+   size_t textStart, textLength;                // its robot commands, in the cache's text
+}
+PLAN_CACHE_ENTRY;
+
+
+// plans of the command lines of a command file (--cache).  A line that starts in the same state as when it was last
+// planned gives the same robot commands, so after an edit only the edited lines, and the lines after them whose
+// starting state changed, are planned again.
+typedef struct PLAN_CACHE
+{
+   PLAN_CACHE_ENTRY *entries;                   // the plans (dynamic array)
+   int nEntries, capacity;                      // plans stored, room for
+   int *slots;                                  // hash table of entry indices (-1: empty), nSlots is a power of 2
+   int nSlots;                                  // size of the hash table
+   char *text;                                  // robot commands and key inputs of all the plans (dynamic array)
+   size_t textLength, textCapacity;             // characters stored, room for
+   bool bOutOfMemory;                           // true once a plan could not be stored
+   int nHits, nMisses;                          // lines reused, lines planned
+}
+PLAN_CACHE;
+
+
+// start of an IK cache file.  The file is the header, IK_CACHE_SLOTS entries, then the blocks of points
+typedef struct IK_CACHE_HEADER
+{
+   char magic[8];                               // IK_CACHE_MAGIC
+   int version, nSlots, nBlocks, blockPoints;   // layout of the file, checked when it is opened
+   int bDirty;                                  // 1 while a run has the file open (a file left dirty is emptied)
+   int nEntries;                                // shapes stored
+   int lruHead, lruTail;                        // most and least recently used shape (-1: none)
+   int freeBlock, nFreeBlocks;                  // first free block (-1: none), number of free blocks
+}
+IK_CACHE_HEADER;
+
+
+// a shape in the IK cache: an entry of its hash table (linear probing, no tombstones)
+typedef struct IK_CACHE_ENTRY
+{
+   unsigned long long key;                      // hash of the shape (see getIkKey), 0 for an empty slot
+   int nPoints;                                 // number of points
+   int firstBlock;                              // first block of its points (the blocks are chained)
+   int bLeft, bRight;                           // arms that can draw every point
+   int lruPrev, lruNext;                        // more and less recently used shapes (-1: none)
+   double adderLeft, adderRight;                // arm costs
+   double xEnd, yEnd;                           // where the pen ends
+}
+IK_CACHE_ENTRY;
+
+
+// IK_CACHE_BLOCK_POINTS points of a shape in the IK cache
+typedef struct IK_CACHE_BLOCK
+{
+   int next, unused;                            // next block of the shape or of the free list (-1: none)
+   double points[IK_CACHE_BLOCK_POINTS][IK_POINT_VALUES];  // x, y, left arm angles, right arm angles
+}
+IK_CACHE_BLOCK;
+
+
+// the IK cache file mapped into memory (see ikCacheOpen).  Every thread shares it
+typedef struct IK_CACHE
+{
+   void *base;                                  // the mapping (NULL if no cache is open)
+   size_t size;                                 // its size
+   IK_CACHE_HEADER *header;                     // the parts of the file
+   IK_CACHE_ENTRY *entries;
+   IK_CACHE_BLOCK *blocks;
+#ifdef _WIN32
+   HANDLE hFile, hMapping;                      // the file and its mapping
+#else
+   int fd;                                      // the file (locked while it is open)
+#endif
+   std::mutex lock;                             // one thread at a time
+   int nHits, nMisses, nStored;                 // shapes found, not found and stored in this run
+}
+IK_CACHE;
+
+
+// options given on the command line (see parseCommandLine)
+typedef struct CLI_OPTIONS
+{
+   int inputMode;                               // INPUT_MODE or -1 to ask the user
+   const char *fileName;                        // --file: command file of the file mode
+   const char *jobsPath;                        // --jobs: manifest or job directory of the multi, shared and batch
+                                                //         modes
+   const char *outDir;                          // --out: output directory of the batch mode
+   const char *outputName;                      // --output: file the robot commands are written to ("-": stdout)
+   int nRobots;                                 // --robots: robot cells of the multi mode (0 to ask the user)
+   bool bDryRun, bEstimate, bBenchmark, bHelp;  // --dry-run, --estimate, --benchmark, --help
+   bool bCache, bNoPeephole, bEncode;           // --cache, --no-peephole, --encode
+   const char *ikCacheName;                     // --ik-cache: IK cache file
+   const char *decodeName;                      // --decode: encoded command file to write back as text
+   const char *strBase;                         // --base: "x y rotationDeg" of arm B in the shared mode
+   bool bUseRobot;                              // true if the robot is connected (derived from the above)
+}
+CLI_OPTIONS;
+
+
+// one worker thread of the batch planner.  Each job gets its own state and transform matrix
+typedef struct BATCH_WORKER
+{
+   int id;                                      // worker number (0 based)
+   int nPlanned;                                // jobs planned with no problems
+   int nWithProblems;                           // jobs planned with invalid lines or shapes out of reach
+   int nFailed;                                 // jobs that could not be read or written
+}
+BATCH_WORKER;
+
+
+// joint setpoints sent by a job, in order.  Used to plan robots that share a workspace
+typedef struct JOINT_TRAJECTORY
+{
+   double (*theta)[2];                          // theta1Deg, theta2Deg of each setpoint (dynamic array)
+   int n, capacity;                             // setpoints stored, setpoints allocated
+}
+JOINT_TRAJECTORY;
+
+
+// where an arm's base sits in the shared workspace frame
+typedef struct ARM_BASE
+{
+   double x, y, rotDeg;                         // base position and the rotation of its +x axis
+   int robotModel;                              // arm geometry
+}
+ARM_BASE;
+
+
+// a link of an arm at one tick: the segment between its joints, swept by LINK_CAPSULE_RADIUS
+typedef struct LINK_CAPSULE
+{
+   double x0, y0, x1, y1;
+}
+LINK_CAPSULE;
+
+
+// one link of one tick filed under one spatial hash cell and time slice
+typedef struct CAPSULE_HASH_ENTRY
+{
+   int slice, cx, cy;                           // time slice and cell
+   int tick, link;                              // which capsule
+   int next;                                    // next entry in the same bucket, -1 at the end
+}
+CAPSULE_HASH_ENTRY;
+
+
+// spatial hash over time-sliced link capsules of the arm that has priority
+typedef struct CAPSULE_HASH
+{
+   int *buckets;                                // first entry of each bucket, -1 if empty
+   CAPSULE_HASH_ENTRY *entries;                 // all entries (dynamic array)
+   int nEntries, capacity;
+   const JOINT_TRAJECTORY *traj;                // the trajectory that was hashed
+   ARM_BASE base;                               // and where its arm is
+}
+CAPSULE_HASH;
+
+
+// result of scheduling the second arm around the first
+typedef struct SHARED_SCHEDULE
+{
+   int *waitBefore;                             // ticks the second arm waits before each of its setpoints
+   int nTicks;                                  // ticks until both arms are done
+   int nWaits, waitTicks;                       // number of waits inserted, and their total length
+   int nConflicts;                              // conflicts that could not be solved by waiting
+}
+SHARED_SCHEDULE;
+
+
+// a batch of points and their joint angles for drawPoints.  Arrays of each value (not an array of points) so that
+// inverseKinematicsBatchT can work through them with vector instructions
+typedef struct IK_BATCH
+{
+   double x[POINTS_BATCH], y[POINTS_BATCH];                      // points (not transformed)
+   double theta1DegLeft[POINTS_BATCH], theta2DegLeft[POINTS_BATCH];      // left arm solution
+   double theta1DegRight[POINTS_BATCH], theta2DegRight[POINTS_BATCH];    // right arm solution
+   bool bLeft[POINTS_BATCH], bRight[POINTS_BATCH];               // true if the arm reaches the point
+   int n;                                                        // number of points in the batch
+}
+IK_BATCH;
+
+
+// a point file being read by drawPoints
+typedef struct POINT_FILE
+{
+   FILE *fi;                                    // the open file
+   bool bBinary;                                // true for pairs of doubles, false for text lines "x, y"
+   int lineNumber;                              // lines read so far (text files)
+}
+POINT_FILE;
+
+
+// the points a drawing command goes through, worked out one at a time (line, arc, curve, or the single point of
+// moveTo).  A curve is a chain of cubic Bezier pieces, each with its own number of points
+typedef struct SHAPE_POINTS
+{
+   int index;                                   // INDEX_MOVE_TO, INDEX_DRAW_LINE, INDEX_DRAW_ARC or a curve
+   double x0, y0, x1, y1;                       // line end points (also the ends of a curve)
+   double xc, yc, radius, thetaStart, thetaEnd; // arc centre, radius and angles (radians)
+   double piece[MAX_CURVE_PIECES][4][2];        // control points of the curve pieces
+   int pieceEnd[MAX_CURVE_PIECES];              // number of the last point of each piece
+   int nPieces;                                 // number of curve pieces
+   int nPoints;                                 // number of points
+}
+SHAPE_POINTS;
+
+
+// region a shape stays in after the transform, as seen from the shoulder
+typedef struct SHAPE_BOUNDS
+{
+   double rMin, rMax;                           // distance from the shoulder (mm)
+   double betaMin, betaMax;                     // direction from the shoulder (radians, between -PI and PI)
+}
+SHAPE_BOUNDS;
+
+
+// steps of a drawing command (see DRAW_STEPPER)
+enum DRAW_STEP { DRAW_STEP_PEN_UP, DRAW_STEP_FIRST_POINT, DRAW_STEP_PEN_DOWN, DRAW_STEP_POINTS, DRAW_STEP_DONE };
+
+
+// a moveTo, drawLine, drawArc or curve being drawn one robot command at a time.  The points and joint angles are
+// worked out when they are sent, so the memory used doesn't depend on the resolution
+typedef struct DRAW_STEPPER
+{
+   SHAPE_POINTS shape;                          // points of the shape
+   int arm;                                     // LEFT_ARM, RIGHT_ARM, or NO_ARM if no arm can draw the whole shape
+   int step;                                    // next DRAW_STEP
+   int i;                                       // next point to send
+   int lineNumber;                              // line of the command (for the singularity guard report)
+
+   // singularity guard (see singularityGuardStep)
+   int subStep, nSubSteps;                      // next point added before point i, number of steps to point i
+   bool bSlowed;                                // motor speed lowered to LOW
+   int nNearSingular, nAdded;                   // points near a singularity, points added
+   double closestDeg, xClosest, yClosest;       // closest the elbow came to straight or its limit, and where
+   bool bClosestStraight;                       // true if the closest was to straight (full extension)
+
+   // IK cache (see ikCacheLookup)
+   unsigned long long ikKey;                    // key of the shape, or 0 if it is not cached
+   double (*ikPoints)[IK_POINT_VALUES];         // its points and joint angles (NULL: worked out as they are sent)
+   bool bIkHit;                                 // true if ikPoints came from the cache, false if being recorded
+   bool bIkLeft, bIkRight;                      // arms that can draw every point (see probeShapeArms)
+   double ikAdderLeft, ikAdderRight;            // arm costs
+   double xIkEnd, yIkEnd;                       // where the pen ends (of a shape from the cache)
+
+   // corner blending (see blendCorner)
+   double blend[2][4];                          // x, y and joint angles of the points sent instead of the last one
+   int iBlend, nBlend;                          // next of them to send, number of them
+}
+DRAW_STEPPER;
+
+
+// a parsed command waiting in the lookahead queue
+typedef struct LOOKAHEAD_ENTRY
+{
+   PARSED_COMMAND cmd;                          // the command
+   double tsQueued;                             // when it was queued (traceNow, microseconds)
+}
+LOOKAHEAD_ENTRY;
+
+
+// commands held back so that paths made of several segments can be planned before the first one runs
+typedef struct LOOKAHEAD_QUEUE
+{
+   LOOKAHEAD_ENTRY entries[LOOKAHEAD_DEPTH];    // circular buffer
+   int head, count;                             // oldest entry, number of entries
+   bool bInPath;                                // true while the segments run continue one path
+}
+LOOKAHEAD_QUEUE;
+
+
+// a G-code or SVG file being turned into drawing commands by importDrawing
+typedef struct IMPORTER
+{
+   FILE *fi;                                    // the file
+   const char *fileName;                        // its name
+   int lineNumber;                              // line being read
+   int resolution;                              // RESOLUTION of the drawing commands
+   double x, y;                                 // current point
+   double xStart, yStart;                       // start of the SVG subpath (where Z goes back to)
+   LOOKAHEAD_QUEUE queue;                       // drawing commands held back to join them into paths
+   int nCommands, nSkipped;                     // commands drawn, commands out of reach
+}
+IMPORTER;
+
+
+// a point of a job being placed by autoFit
+typedef struct FIT_POINT
+{
+   double x, y;                                 // the point as the job gives it
+   double d;                                    // distance from the centre of the job (far points are checked first)
+   int segment;                                 // part of the job (transform) it is drawn with
+}
+FIT_POINT;
+
+
+// a part of a job drawn with the same transform commands of the job itself
+typedef struct FIT_SEGMENT
+{
+   double TM[3][3];                             // the job's own transforms, applied after the placement
+   bool bPlaced;                                // false after the job resets the transform (the placement is lost)
+}
+FIT_SEGMENT;
+
+
+// the points of a job being placed by autoFit
+typedef struct FIT_JOB
+{
+   FIT_POINT *points;                           // points of the job, one per AUTOFIT_GRID_MM cell
+   int nPoints, pointCapacity;                  // number of points, room in points
+   FIT_SEGMENT *segments;                       // parts of the job
+   int nSegments, segmentCapacity;              // number of parts, room in segments
+   double xc, yc;                               // centre of the placed points (middle of their bounding box)
+}
+FIT_JOB;
+
+
+// a placement of a job: scaled and rotated about its centre, then moved so the centre is at (x, y)
+typedef struct FIT_POSE
+{
+   double scale, rotationDeg, x, y;             // the placement
+   double margin;                               // how far the job stays inside LMIN/LMAX (mm)
+   int arm;                                     // arm that can draw the whole job (LEFT_ARM or RIGHT_ARM)
+   int candidate;                               // number of the candidate pose (ties go to the lowest)
+}
+FIT_POSE;
+
+
+// lines read by the input thread of the streaming mode and not yet handled
+typedef struct INPUT_LINE_QUEUE
+{
+   char lines[INPUT_QUEUE_DEPTH][MAX_COMMAND_LENGTH];  // circular buffer
+   int head, count;                             // oldest line, number of lines
+   bool bEnd;                                   // true after the quit line or the end of the input
+   std::mutex lock;                             // protects everything above
+   std::condition_variable cvChanged;           // signalled when a line is added or removed
+}
+INPUT_LINE_QUEUE;
+
+
+// a connection of the server mode
+typedef struct SERVER_CLIENT
+{
+   SOCKET_HANDLE sock;                          // INVALID_SOCKET if the slot is free
+   char inBuf[SERVER_INPUT_BUFFER];             // received bytes, the last line may be incomplete
+   size_t inUsed;                               // number of bytes in inBuf
+   bool bDiscarding;                            // true while skipping the rest of a line that was too long
+   char outBuf[SERVER_REPLY_BUFFER];            // replies not yet sent
+   size_t outUsed;                              // number of bytes in outBuf
+   int lineNumber;                              // lines received so far (used in the replies)
+   int nQueued;                                 // commands of this client waiting in the server queue
+   bool bQuit;                                  // true once the client sent the quit line
+   bool bEndOfStream;                           // true once the client closed its side (nothing more to read)
+   bool bBroken;                                // true if sending failed (nothing more is sent)
+}
+SERVER_CLIENT;
+
+
+// a command received by the server and waiting to run
+typedef struct SERVER_JOB
+{
+   int client;                                  // client slot to reply to
+   PARSED_COMMAND cmd;                          // the command (its lineNumber is the line of the client's stream)
+}
+SERVER_JOB;
+
+
+// commands received by the server, run in order
+typedef struct SERVER_QUEUE
+{
+   SERVER_JOB jobs[SERVER_QUEUE_DEPTH];         // circular buffer
+   int head, count;                             // oldest job, number of jobs
+}
+SERVER_QUEUE;
+
+ROBOT_PROFILE robotProfile = {};  // the loaded robot profile (robotProfile.bLoaded is false if there is none)
+IK_CACHE ikCache;                 // shapes drawn before, with their joint angles (--ik-cache)
+thread_local ROBOT_STREAM robotStream = {};  // what the robot of this thread was last told (see isRedundantCommand)
+std::atomic<int> nRedundantCommands(0);      // robot commands left out by every thread
+
+const double &ARM_PROFILE::L1 = robotProfile.L1;
+const double &ARM_PROFILE::L2 = robotProfile.L2;
+const double &ARM_PROFILE::MAX_ABS_THETA1_DEG = robotProfile.maxAbsTheta1Deg;
+const double &ARM_PROFILE::MAX_ABS_THETA2_DEG = robotProfile.maxAbsTheta2Deg;
+const double &ARM_REACH<ARM_PROFILE>::LMAX = robotProfile.LMAX;
+const double &ARM_REACH<ARM_PROFILE>::LMIN = robotProfile.LMIN;
+
+
+//----------------------------- Local Function Prototypes -------------------------------------------------------------
+bool flushInputBuffer();            		// flushes any characters left in the standard input buffer
+void waitForEnterKey();             		// waits for the Enter key to be pressed
+double degToRad(double);            		// returns angle in radians from input angle in degrees
+double radToDeg(double);            		// returns angle in degrees from input angle in radians
+void closeAndExit(const char *);    		// prints a message and closes program
+int nint(double d);                 		// find int nearest to double
+char *makeUpper(char *);            		// changes a string to all upper case
+bool isBlankLine(const char *);     		// checks if a string is composed entiredly of whitespace characters
+bool isCommentLine(const char *);   		// check if a string is considered a comment string
+void pauseAndClearRobotAndConsole();      	// asks the user to press ENTER and then clears the robot interface
+void resetTransformMatrix(double TM[][3]);      // resets the transform matrix to the identity matrix
+void transformMatrixMultiply(double TM[][3], double M[][3]);    // premultiplies the transform matrix TM by matrix M
+FORWARD_SOLUTION forwardKinematics(double, double);  // implements forward kinematics
+int getN(double len, int resolution);  		// number of points to use for a line for drawLine or arc for drawArc.
+int getDataInputMode();                		// get an input from the user so the program know where is it gonna get the data
+int parseCommand(char *strCommand, PARSED_COMMAND *cmd, char *strErrorMsg, int lineNumber); //Compare the input com
+void help();                     		// function that will print all SCARA COMMANDS, arguments, and any needed info
+void runKeyboardCommands(SCARA_STATE *state, double transformMatrix[3][3]);      //fun keyboard
+void runFileCommands(SCARA_STATE *state, double transformMatrix[3][3], const char *fileName); //runs a command file
+bool parseCommandLine(int argc, char *argv[], CLI_OPTIONS *options);  // reads the command line options
+void printUsage();                     		// prints the command line options
+void printRunSummary(const CLI_OPTIONS *options, const COMMAND_OUTPUT *output, double elapsedUs);  // end of run
+void executeCommand(const PARSED_COMMAND *cmd, SCARA_STATE *state, double transformMatrix[3][3]);  //commds exe
+void drawArc(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state);//calc starting/end
+void drawStraightLine(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state);//for line
+void drawPoints(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state);  // pen dots from a file
+void drawCurve(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state);  // Bezier or spline
+void importDrawing(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state);  // G-code or SVG
+void importCommand(IMPORTER *imp, int index, const double *values, int nValues, double transformMatrix[3][3],
+   SCARA_STATE *state);                         // queues an imported drawing command
+void importArc(IMPORTER *imp, double x, double y, bool bCentre, double i, double j, double r, bool bLargeArc,
+   bool bPositive, double transformMatrix[3][3], SCARA_STATE *state);  // imports a circular arc
+void importLine(IMPORTER *imp, double x, double y, double transformMatrix[3][3], SCARA_STATE *state);  // a line
+void importGcode(IMPORTER *imp, double transformMatrix[3][3], SCARA_STATE *state);  // imports a G-code file
+int importGetc(IMPORTER *imp);                  // reads a character of an imported file
+void importUngetc(IMPORTER *imp, int c);        // puts it back
+bool svgFindPathData(IMPORTER *imp, int *pQuote);  // finds the next <path> d attribute
+int svgReadItem(IMPORTER *imp, int quote, double *pValue);  // next command letter or number of SVG path data
+void svgImportPath(IMPORTER *imp, int quote, double transformMatrix[3][3], SCARA_STATE *state);  // one <path>
+void importSvg(IMPORTER *imp, double transformMatrix[3][3], SCARA_STATE *state);  // imports an SVG file
+int getShapeCorners(const PARSED_COMMAND *cmd, double corners[4][2]);  // corners of a rectangle or triangle
+void autoFit(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state);  // places a job in reach
+bool readFitJob(const char *fileName, FIT_JOB *job);  // collects the points a job draws
+bool addFitSegment(FIT_JOB *job, double TM[3][3], bool bPlaced);  // a part of a job with new transform commands
+bool addFitPoint(FIT_JOB *job, double x, double y);  // adds a point of a job
+void packFitPoints(FIT_JOB *job);               // keeps one point of a job per AUTOFIT_GRID_MM cell
+int compareFitPointCells(const void *a, const void *b);     // qsort order of job points by cell
+int compareFitPointDistance(const void *a, const void *b);  // qsort order of job points, far ones first
+void getFitTransform(const FIT_JOB *job, const FIT_POSE *pose, double TM[3][3]);  // transform of a placement
+bool checkFitPose(const FIT_JOB *job, const SCARA_STATE *state, FIT_POSE *pose);  // true if a placement fits
+void autoFitWorker(const FIT_JOB *job, const SCARA_STATE *state, double scale, int first, int step,
+   FIT_POSE *best);                             // checks a share of the candidate placements
+bool openPointFile(POINT_FILE *pf, const char *fileName);   // opens a point file (text or binary)
+int readPoints(POINT_FILE *pf, double *x, double *y, int maxPoints);  // reads the next points of a point file
+int comparePointsSerpentine(const void *a, const void *b);  // qsort order of the SERPENTINE point order
+INVERSE_SOLUTION solveInverseKinematics(double, double, double transformMatrix[3][3], const SCARA_STATE *state);
+void solveInverseKinematicsBatch(IK_BATCH *batch, double transformMatrix[3][3], const SCARA_STATE *state);
+void precisionReport(const SCARA_STATE *state); // reports the FLOAT kinematics error against DOUBLE over the workspace
+template<class ARM, class REAL> INVERSE_SOLUTION inverseKinematicsT(double, double, double transformMatrix[3][3]);
+template<class ARM, class REAL> void inverseKinematicsBatchT(IK_BATCH *batch, double transformMatrix[3][3]);
+template<class ARM> FORWARD_SOLUTION forwardKinematicsT(double, double);   // forward kinematics of one arm geometry
+bool loadRobotProfile(const char *fileName, char *strErrorMsg);  // reads the robot profile file into robotProfile
+void getHomePosition(int robotModel, SCARA_POSITION *pos);  // pose and pen position after HOME for a model
+void getReach(int robotModel, double *pLMin, double *pLMax);         // LMIN/LMAX of a model
+bool isCommandInReach(const PARSED_COMMAND *cmd, double transformMatrix[3][3], const SCARA_STATE *state);
+bool checkPad(double, double);     		//will check that a full pad can be draw prior to the drawing. 
+bool traceOpen(const char *fileName);           // starts writing a chrome trace-event timeline of the job
+void traceClose();                              // flushes and closes the trace file
+double traceNow();                              // trace timestamp in microseconds
+void traceSpan(const char *name, const char *category, double tsStart, int lineNumber); // records a complete span
+void sendToRobot(const char *strCommand);       // sends one command to the robot driven by the current thread
+FILE *messageFile();                            // where the messages of the commands run by this thread go
+bool isRedundantCommand(ROBOT_STREAM *stream, const char *strCommand);  // true if a command changes nothing
+void writeRobotCommand(const char *strCommand);  // sends a command that got through the peephole filter
+void flushRobotStream();                        // sends the PEN_UP the peephole filter is holding back
+void startJointStream(JOINT_ENCODER *encoder, FILE *fo);  // writes the header of an encoded command file
+void encodeRobotCommand(JOINT_ENCODER *encoder, FILE *fo, const char *strCommand);  // writes one encoded command
+bool parseSetpoint(const char *strCommand, long long q[2], int *pDecimals);  // quantised angles of a ROTATE_JOINT
+void formatSetpoint(char *strCommand, size_t size, const long long q[2], int decimals);  // and back
+char *appendQuantised(char *p, char *end, long long q, int decimals);  // writes q / 10^decimals into a command
+int putVarint(unsigned char *p, unsigned long long value);  // packs a varint
+bool getVarint(FILE *fi, unsigned long long *pValue);       // reads a varint
+bool decodeCommandFile(const char *fileName, const char *outputName);  // stand-in decoder (--decode)
+bool runCommandFile(const char *fileName, SCARA_STATE *state, double transformMatrix[3][3]);  // runs a command file
+bool readCommandLine(FILE *fi, char *strCommand, int *pLineNumber);  // next line that isn't blank or a comment
+void runMultiRobotJobs(const SCARA_STATE *initialState, int nRobots, const char *jobsPath);  // several robot cells
+void runCellWorker(SCARA_CELL *cell, JOB_QUEUE *jobs);     // runs jobs on one cell until the queue is empty
+bool loadJobQueue(const char *path, JOB_QUEUE *jobs);      // job files of a manifest or a directory
+int compareFileNames(const void *a, const void *b);        // qsort order of job file names
+void runBatchPlanner(const SCARA_STATE *initialState, const char *jobsPath, const char *outDir);  // offline planner
+void countRobotCommand(COMMAND_OUTPUT *output, const char *strCommand);  // counts a command written by sendToRobot
+void addEstimatedMove(COMMAND_OUTPUT *output, double theta1Deg, double theta2Deg);  // time of one joint move
+void executeCachedCommand(const PARSED_COMMAND *cmd, SCARA_STATE *state, double transformMatrix[3][3],
+   const PLAN_CACHE *oldCache, PLAN_CACHE *newCache);  // executeCommand, reusing the plan of an unchanged line
+bool isCacheableCommand(int index);             // true if a command only sends robot commands and changes the state
+unsigned long long hashBytes(unsigned long long h, const void *data, size_t size);  // FNV-1a hash of some bytes
+unsigned long long getPlanKey(const PARSED_COMMAND *cmd, const SCARA_STATE *state, double transformMatrix[3][3],
+   PLAN_INPUTS *inputs);                        // key of the plan of a command, and what it is hashed from
+void addPlanInputs(PLAN_INPUTS *inputs, const void *data, size_t size);  // adds some bytes to the inputs of a key
+void addCommandInputs(PLAN_INPUTS *inputs, const PARSED_COMMAND *cmd);  // adds a command to the inputs of a key
+void addRobotProfileInputs(PLAN_INPUTS *inputs);  // adds the loaded robot profile to the inputs of a key
+int findPlanEntry(const PLAN_CACHE *cache, unsigned long long key, const char *inputs, size_t inputLength);
+bool addPlanEntry(PLAN_CACHE *cache, const PLAN_CACHE_ENTRY *entry);  // stores a plan
+bool addPlanText(PLAN_CACHE *cache, const char *text, size_t length);  // stores robot commands or key inputs
+void replayPlanText(const char *text, size_t length, int robotModel);  // sends the robot commands of a stored plan
+bool loadPlanCache(const char *fileName, PLAN_CACHE *cache);  // reads a plan cache file
+bool savePlanCache(const char *fileName, const PLAN_CACHE *cache);  // writes a plan cache file
+void freePlanCache(PLAN_CACHE *cache);          // frees a plan cache
+void runBatchWorker(BATCH_WORKER *worker, JOB_QUEUE *jobs, const SCARA_STATE *initialState, const char *outDir);
+int runBatchJob(const char *fileName, const char *outDir, const SCARA_STATE *initialState);  // plans one job
+void sendJointSetpoint(double theta1Deg, double theta2Deg);  // sends (and captures) one ROTATE_JOINT
+char *appendText(char *p, char *end, const char *text);  // copies text into a command being built
+char *appendInt(char *p, char *end, int value);          // writes an integer into a command being built
+char *appendFixed(char *p, char *end, double value, int decimals);  // writes a fixed point number into a command
+void getLinkLengths(int robotModel, double *pL1, double *pL2);  // link lengths of a robot model
+void getJointLimits(int robotModel, double *pMaxTheta1Deg, double *pMaxTheta2Deg);  // joint limits of a robot model
+bool captureJointTrajectory(const char *fileName, const SCARA_STATE *initialState, JOINT_TRAJECTORY *traj);
+void getArmLinks(const JOINT_TRAJECTORY *traj, int tick, const ARM_BASE *base, LINK_CAPSULE links[2]);
+double segmentDistance(const LINK_CAPSULE *a, const LINK_CAPSULE *b);   // closest distance between two segments
+int capsuleHashBucket(int slice, int cx, int cy);  // bucket of a (time slice, cell) key
+bool buildCapsuleHash(const JOINT_TRAJECTORY *traj, const ARM_BASE *base, CAPSULE_HASH *hash);
+bool capsuleHashCollides(const CAPSULE_HASH *hash, const LINK_CAPSULE links[2], int tick);
+bool scheduleSharedWorkspace(const CAPSULE_HASH *first, const JOINT_TRAJECTORY *second, const ARM_BASE *secondBase,
+   SHARED_SCHEDULE *schedule);                // makes the second arm wait for the first wherever they would collide
+void runSharedWorkspacePlanner(const SCARA_STATE *initialState, const char *jobsPath,
+   const char *strBase);                        // plans two jobs for arms sharing a workspace
+void initShapePoints(SHAPE_POINTS *shape, const PARSED_COMMAND *cmd);          // a shape's points
+void getShapePoint(const SHAPE_POINTS *shape, double i, double *x, double *y);    // i-th point of a shape
+void initCurvePoints(SHAPE_POINTS *shape, const PARSED_COMMAND *cmd, int resolution);  // a curve's pieces
+void addCurvePieces(SHAPE_POINTS *shape, const double b[4][2], int nPieces, int resolution);  // tessellates a span
+void getCubicPoint(const double b[4][2], double t, double *x, double *y);       // point of a cubic Bezier
+double getCurveSegmentDeviation(const double b[4][2], double t0, double t1);    // how far a segment is from its chord
+void probeShapeArms(const SHAPE_POINTS *shape, double transformMatrix[3][3], const SCARA_STATE *state,
+   bool *pbLeft, bool *pbRight, double *pAdderLeft, double *pAdderRight);   // arm feasibility and cost of a shape
+void getSafeArms(const SHAPE_POINTS *shape, double transformMatrix[3][3], const SCARA_STATE *state,
+   bool *pbLeftSafe, bool *pbRightSafe);        // arms that can draw a whole shape, from its bounds
+bool getShapeBounds(const SHAPE_POINTS *shape, double transformMatrix[3][3], SHAPE_BOUNDS *bounds);  // shape region
+bool addHullBounds(const double hull[][2], int n, double transformMatrix[3][3], SHAPE_BOUNDS *bounds);  // hull region
+bool isPathCommand(int index);                  // true for the commands that can be chained into one path
+bool isCurveCommand(int index);                 // true for drawQuadBezier, drawCubicBezier and drawSpline
+void getPathEnds(const PARSED_COMMAND *cmd, double *xs, double *ys, double *xe, double *ye);  // ends of a path command
+void lookaheadPush(LOOKAHEAD_QUEUE *queue, const PARSED_COMMAND *cmd);  // queues a command
+bool lookaheadHeadReady(const LOOKAHEAD_QUEUE *queue, const SCARA_STATE *state, bool bFlush);
+void lookaheadRunHead(LOOKAHEAD_QUEUE *queue, SCARA_STATE *state,
+   double transformMatrix[3][3]);               // plans (if needed) and runs the oldest queued command
+void readInputLines(INPUT_LINE_QUEUE *input);   // input thread of the streaming mode
+void runStreamingCommands(SCARA_STATE *state, double transformMatrix[3][3]);  // keyboard/piped commands, lookahead
+void formatState(const SCARA_STATE *state, char *strState, size_t size);  // the text printed by queryState
+void initDrawStepper(DRAW_STEPPER *stepper, const PARSED_COMMAND *cmd, double transformMatrix[3][3],
+   const SCARA_STATE *state);                   // chooses the arm of a shape, ready to be drawn by drawStep
+bool drawStep(DRAW_STEPPER *stepper, double transformMatrix[3][3], SCARA_STATE *state);  // sends the next command
+void cancelDrawStepper(DRAW_STEPPER *stepper, SCARA_STATE *state);  // stops a shape part way, lifting the pen
+bool singularityGuardStep(DRAW_STEPPER *stepper, double x, double y, const INVERSE_SOLUTION *pIsol,
+   double transformMatrix[3][3], SCARA_STATE *state);  // adds points and slows down near singularities
+bool blendCorner(DRAW_STEPPER *stepper, double x, double y, const double theta[2], double transformMatrix[3][3],
+   const SCARA_STATE *state);                   // cuts the corner at the last point of a shape
+bool getArmAngles(double x, double y, int arm, double transformMatrix[3][3], const SCARA_STATE *state,
+   double theta[2]);                            // joint angles of one arm at a point
+double jointDistanceToMove(const double theta[2], const double a[2], const double b[2]);  // joint space distance
+void restoreMotorSpeed(DRAW_STEPPER *stepper, const SCARA_STATE *state);  // undoes the guard's slow down
+void reportSingularity(const DRAW_STEPPER *stepper);  // where a shape came near a singularity
+bool ikCacheOpen(const char *fileName);         // maps the IK cache file
+void ikCacheClose();                            // unmaps the IK cache file
+void ikCacheReset();                            // empties the IK cache
+unsigned long long getIkKey(const PARSED_COMMAND *cmd, double transformMatrix[3][3], const SCARA_STATE *state);
+int ikCacheFind(unsigned long long key);        // entry of a shape, or -1
+void ikCacheUnlink(int e);                      // takes an entry out of the LRU list
+void ikCachePushFront(int e);                   // makes an entry the most recently used
+void ikCacheMoveEntry(int from, int to);        // moves an entry to another slot, keeping the LRU list
+void ikCacheEvict(int e);                       // removes a shape, freeing its blocks
+bool ikCacheLookup(DRAW_STEPPER *stepper, const PARSED_COMMAND *cmd);  // a shape's points from the cache
+void ikCacheRecordPoint(DRAW_STEPPER *stepper, int i, double x, double y, const INVERSE_SOLUTION *pIsol);
+void ikCacheFinish(DRAW_STEPPER *stepper, double transformMatrix[3][3], const SCARA_STATE *state);  // stores a shape
+unsigned long long hashCommand(unsigned long long h, const PARSED_COMMAND *cmd);  // adds a command to a hash
+unsigned long long hashRobotProfile(unsigned long long h);  // adds the loaded robot profile to a hash
+SOCKET_HANDLE serverOpen(unsigned short port);  // listening socket of the server mode
+void serverQueueReply(SERVER_CLIENT *client, const char *strReply);  // adds a reply to a client's send buffer
+bool isKeywordLine(const char *strLine, const char *keyword);  // true if the line is just the keyword
+void serverReadLines(SERVER_CLIENT *clients, int c, const SCARA_STATE *state,
+   SERVER_QUEUE *queue, bool *pbStop, bool *pbCancel);   // splits a client's input into lines and queues them
+void runServerCommands(SCARA_STATE *state, double transformMatrix[3][3]);  // server mode
+
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+// demonstrates advanced control of the robot simulator using all facets of C learned in the course.  Without command
+// line options the user is asked for everything; with them the program runs unattended (see printUsage)
+// INPUTS: argc, argv: the command line options
+// RETURN: an integer - signals to the O/S how the program terminated.
+int main(int argc, char *argv[])
+{
+   CLI_OPTIONS options = {-1, NULL, NULL, NULL, NULL, 0, false, false, false, false, false, false, false, NULL, NULL,
+      NULL, true};              // options
+   COMMAND_OUTPUT output = {};   // robot commands written or counted instead of sent (--output, --dry-run, ...)
+   JOINT_ENCODER encoder = {};   // joint delta encoding of the output file (--encode)
+   double tsStart;               // when the job started (--benchmark)
+
+   if(!parseCommandLine(argc, argv, &options))
+   {
+      printUsage();
+      return 2;
+   }
+   if(options.bHelp)
+   {
+      printUsage();
+      return 0;
+   }
+   if(options.decodeName != NULL) return decodeCommandFile(options.decodeName, options.outputName) ? 0 : 1;
+   bInteractive = argc < 2;
+   bPlanCache = options.bCache;
+   bPeephole = !options.bNoPeephole;
+   bJointEncoding = options.bEncode;
+   if(options.ikCacheName != NULL) ikCacheOpen(options.ikCacheName);
+
+   // open connection with robot
+   if(options.bUseRobot)
+   {
+      if(!robot.Initialize())
+      {
+         programExitCode = 1;
+         closeAndExit("Sorry the robot could not be connected");
+      }
+      bRobotConnected = true;
+   }
+
+   int dataInputMode; // stores the input mode (keyboard or file)
+
+   // current state of the robot (position, pen, and motor states).
+   SCARA_STATE state = {600.0, 0.0, 0.0, 0.0, LEFT_ARM, CYCLE_PEN_COLORS_OFF, MOTOR_SPEED_MEDIUM, 255, 0, 0, PEN_DOWN,
+                        PRECISION_DOUBLE, ROBOT_MODEL_SCARA600, NO_ARM, false, false, false, 0.0};
+
+   // all points sent to inverseKinematics will be transformed using transformMatrix BEFORE 
+   // the motor angle values are calculated
+   double transformMatrix[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+
+   // load the robot profile, if there is one, and make it the model used by the job
+   char strErrorMsg[MAX_MESSAGE_LENGTH] = {};  // error message from loadRobotProfile
+   if(!loadRobotProfile(ROBOT_PROFILE_FILENAME, strErrorMsg))
+   {
+      programExitCode = 1;
+      closeAndExit(strErrorMsg);
+   }
+   if(robotProfile.bLoaded)
+   {
+      printf("Using robot profile %s from %s\n", robotProfile.name, ROBOT_PROFILE_FILENAME);
+      state.robotModel = ROBOT_MODEL_PROFILE;
+      getHomePosition(state.robotModel, &state.currentPos);
+   }
+   // ask the user if they want to get commands from the keyboard or a file, unless it is on the command line
+   dataInputMode = options.inputMode >= 0 ? options.inputMode : getDataInputMode();
+
+   // robot commands that are not sent go to the --output file, or are only counted
+   if(!options.bUseRobot && dataInputMode != BATCH_INPUT)
+   {
+      output.motorSpeed = state.motorSpeed;
+      if(options.bDryRun || options.outputName == NULL) output.fo = NULL;
+      else if(strcmp(options.outputName, "-") == 0) output.fo = stdout;
+      else if(fopen_s(&output.fo, options.outputName, bJointEncoding ? "wb" : "w") != 0 || output.fo == NULL)
+      {
+         sprintf_s(strErrorMsg, "Sorry the output file %s could not be opened", options.outputName);
+         programExitCode = 1;
+         closeAndExit(strErrorMsg);
+      }
+      if(bJointEncoding && output.fo != NULL)
+      {
+         output.pEncoder = &encoder;
+         startJointStream(&encoder, output.fo);
+      }
+      pCommandOutput = &output;
+   }
+   tsStart = traceNow();
+
+   if(dataInputMode == KEYBOARD_INPUT)
+
+      runKeyboardCommands(&state, transformMatrix); // get/run commands interactively from the keyboard
+   else if(dataInputMode == MULTI_ROBOT_INPUT)
+      runMultiRobotJobs(&state, options.nRobots, options.jobsPath); // run a manifest of job files on several robots
+   else if(dataInputMode == SHARED_WORKSPACE_INPUT)
+      runSharedWorkspacePlanner(&state, options.jobsPath, options.strBase); // two arms that share a drawing area
+   else if(dataInputMode == STREAM_INPUT)
+      runStreamingCommands(&state, transformMatrix); // keyboard/piped commands with lookahead
+   else if(dataInputMode == SERVER_INPUT)
+      runServerCommands(&state, transformMatrix); // command streams sent by other programs
+   else if(dataInputMode == BATCH_INPUT)
+      runBatchPlanner(&state, options.jobsPath, options.outDir); // plan many command files into compiled files
+   else
+      runFileCommands(&state, transformMatrix, options.fileName); // get/run commands from a specified file
+
+   if(pCommandOutput != NULL)
+   {
+      pCommandOutput = NULL;
+      if(output.fo != NULL && output.fo != stdout) fclose(output.fo);
+      printRunSummary(&options, &output, traceNow() - tsStart);
+   }
+   if(nRedundantCommands > 0)
+   {
+      printf("%d redundant robot command(s) left out (--no-peephole sends them)\n", (int)nRedundantCommands);
+   }
+   closeAndExit("Thanks for playing!"); // that's all folks!
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads the command line options.  Options that don't apply to the chosen input mode are errors, so an unattended
+// run never falls back to asking the user something.
+// INPUTS:  argc, argv: the command line, options: where to store the options (already set to their defaults)
+// RETURN:  false (with a message printed) if an option is not valid
+bool parseCommandLine(int argc, char *argv[], CLI_OPTIONS *options)
+{
+   char *pGarbage = NULL;   // trailing garbage of a number
+   int i, m;                // option, input mode counters
+
+   for(i = 1; i < argc; i++)
+   {
+      const char *arg = argv[i];                          // the option
+      const char *value = i + 1 < argc ? argv[i + 1] : NULL;  // its value, for options that have one
+
+      if(strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) options->bHelp = true;
+      else if(strcmp(arg, "--dry-run") == 0) options->bDryRun = true;
+      else if(strcmp(arg, "--estimate") == 0) options->bEstimate = true;
+      else if(strcmp(arg, "--benchmark") == 0) options->bBenchmark = true;
+      else if(strcmp(arg, "--cache") == 0) options->bCache = true;
+      else if(strcmp(arg, "--no-peephole") == 0) options->bNoPeephole = true;
+      else if(strcmp(arg, "--encode") == 0) options->bEncode = true;
+      else if(strcmp(arg, "--input") != 0 && strcmp(arg, "--file") != 0 && strcmp(arg, "--jobs") != 0 &&
+         strcmp(arg, "--out") != 0 && strcmp(arg, "--output") != 0 && strcmp(arg, "--robots") != 0 &&
+         strcmp(arg, "--ik-cache") != 0 && strcmp(arg, "--decode") != 0 && strcmp(arg, "--base") != 0)
+      {
+         printf("Sorry %s is not a valid option\n", arg);
+         return false;
+      }
+      else if(value == NULL)
+      {
+         printf("Sorry %s needs a value\n", arg);
+         return false;
+      }
+      else
+      {
+         i++;
+         if(strcmp(arg, "--input") == 0)
+         {
+            for(m = 0; m < NUM_INPUT_MODES && _stricmp(value, INPUT_MODE_NAMES[m]) != 0; m++);
+            if(m == NUM_INPUT_MODES)
+            {
+               printf("Sorry %s is not an input mode\n", value);
+               return false;
+            }
+            options->inputMode = m;
+         }
+         else if(strcmp(arg, "--file") == 0) options->fileName = value;
+         else if(strcmp(arg, "--jobs") == 0) options->jobsPath = value;
+         else if(strcmp(arg, "--out") == 0) options->outDir = value;
+         else if(strcmp(arg, "--output") == 0) options->outputName = _stricmp(value, "robot") == 0 ? NULL : value;
+         else if(strcmp(arg, "--ik-cache") == 0) options->ikCacheName = value;
+         else if(strcmp(arg, "--decode") == 0) options->decodeName = value;
+         else if(strcmp(arg, "--base") == 0) options->strBase = value;
+         else
+         {
+            options->nRobots = (int)strtol(value, &pGarbage, 10);
+            if(*pGarbage != '\0' || options->nRobots < 1 || options->nRobots > MAX_ROBOT_CELLS)
+            {
+               printf("Sorry the number of robots must be between 1 and %d\n", MAX_ROBOT_CELLS);
+               return false;
+            }
+         }
+      }
+   }
+   if(argc < 2 || options->bHelp) return true;  // interactive, as before
+
+   // the input mode defaults to what the other options need, or to the commands piped to stdin
+   if(options->inputMode < 0)
+   {
+      if(options->fileName != NULL) options->inputMode = FILE_INPUT;
+      else if(options->strBase != NULL) options->inputMode = SHARED_WORKSPACE_INPUT;
+      else if(options->outDir != NULL) options->inputMode = BATCH_INPUT;
+      else if(options->nRobots > 0) options->inputMode = MULTI_ROBOT_INPUT;
+      else options->inputMode = KEYBOARD_INPUT;
+   }
+   if(options->inputMode == FILE_INPUT && options->fileName == NULL)
+   {
+      printf("Sorry the file mode needs --file\n");
+      return false;
+   }
+   if((options->inputMode == MULTI_ROBOT_INPUT || options->inputMode == BATCH_INPUT) && options->jobsPath == NULL)
+   {
+      printf("Sorry the %s mode needs --jobs\n", INPUT_MODE_NAMES[options->inputMode]);
+      return false;
+   }
+   if(options->inputMode == SHARED_WORKSPACE_INPUT && (options->jobsPath == NULL || options->strBase == NULL))
+   {
+      printf("Sorry the shared mode needs --jobs (the job of arm A, then arm B) and --base\n");
+      return false;
+   }
+   if(options->strBase != NULL && options->inputMode != SHARED_WORKSPACE_INPUT)
+   {
+      printf("Sorry --base only applies to the shared mode\n");
+      return false;
+   }
+   if(options->inputMode == MULTI_ROBOT_INPUT && options->nRobots == 0) options->nRobots = 1;
+   if(options->bEncode && options->inputMode != BATCH_INPUT &&
+      (options->outputName == NULL || strcmp(options->outputName, "-") == 0 || options->bDryRun))
+   {
+      printf("Sorry --encode needs an --output file or the batch mode\n");
+      return false;
+   }
+   if(options->inputMode == BATCH_INPUT && options->outDir == NULL) options->outDir = ".";
+   if(options->bCache && options->inputMode != FILE_INPUT && options->inputMode != BATCH_INPUT)
+   {
+      printf("Sorry --cache only applies to the file and batch modes\n");
+      return false;
+   }
+
+   // the multi mode drives its robots from their own threads and the batch planner writes one file per job
+   options->bUseRobot = options->outputName == NULL && !options->bDryRun && !options->bEstimate &&
+      !options->bBenchmark && options->inputMode != BATCH_INPUT;
+   if((options->inputMode == MULTI_ROBOT_INPUT || options->inputMode == BATCH_INPUT) &&
+      (options->outputName != NULL || options->bDryRun || options->bEstimate || options->bBenchmark))
+   {
+      printf("Sorry --output, --dry-run, --estimate and --benchmark don't apply to the %s mode\n",
+         INPUT_MODE_NAMES[options->inputMode]);
+      return false;
+   }
+   return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Prints the command line options
+// INPUTS:  none
+// RETURN:  none
+void printUsage()
+{
+   printf("Usage: SCARA [options]   (no options: ask for everything at the console)\n"
+      "  --input MODE     keyboard, file, multi, shared, stream, server or batch (commands are read from stdin in\n"
+      "                   the keyboard and stream modes)\n"
+      "  --file FILE      command file of the file mode\n"
+      "  --jobs PATH      job manifest or directory of the multi and batch modes, and of the shared mode (two\n"
+      "                   jobs: arm A, then arm B)\n"
+      "  --base \"X Y R\"   shared mode: base of arm B relative to arm A (mm, mm, rotation in degrees)\n"
+      "  --robots N       number of robots of the multi mode (1 - %d)\n"
+      "  --out DIR        output directory of the batch mode (default .)\n"
+      "  --output DEST    where the robot commands go: robot (default), a file, or - for stdout\n"
+      "  --dry-run        plan the job and count the robot commands without sending or writing them\n"
+      "  --estimate       estimate how long the robot takes to run the job\n"
+      "  --benchmark      time the planning of the job\n"
+      "  --cache          file and batch modes: keep the plan of every command line in <job>%s and only plan the\n"
+      "                   lines that were edited (or start in a different state) when the job is run again\n"
+      "  --ik-cache FILE  keep the joint angles of the shapes drawn in FILE (%d MB at most) and reuse them\n"
+      "  --no-peephole    send every robot command, even those that repeat what the robot was last told\n"
+      "  --encode         write the --output file (or the batch mode's %s files) with the joint setpoints\n"
+      "                   packed as varint deltas, several times smaller\n"
+      "  --decode FILE    write an --encode file back as text commands to --output (default stdout) and stop\n"
+      "  --help           print this\n", MAX_ROBOT_CELLS, STR_PLAN_CACHE_EXTENSION,
+      (int)(IK_CACHE_MAX_BYTES / (1024 * 1024)), STR_ENCODED_EXTENSION);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Prints what a run without the robot did: where its commands went and, if asked for, the estimate and the timing
+// INPUTS:  options: the command line options, output: the counted commands, elapsedUs: planning time (microseconds)
+// RETURN:  none
+void printRunSummary(const CLI_OPTIONS *options, const COMMAND_OUTPUT *output, double elapsedUs)
+{
+   if(output->fo != NULL)
+   {
+      printf("%d robot command(s) (%d joint setpoints) written to %s, %d shape(s) out of reach\n", output->nCommands,
+         output->nSetpoints, strcmp(options->outputName, "-") == 0 ? "stdout" : options->outputName,
+         output->nUnreachable);
+   }
+   else
+   {
+      printf("Planned %d robot command(s) (%d joint setpoints), %d shape(s) out of reach, nothing was sent\n",
+         output->nCommands, output->nSetpoints, output->nUnreachable);
+   }
+   if(output->pEncoder != NULL && output->pEncoder->nEncodedBytes > 0)
+   {
+      printf("Joint delta encoding: %lld bytes instead of %lld (%.1f times smaller)\n",
+         output->pEncoder->nEncodedBytes, output->pEncoder->nTextBytes,
+         (double)output->pEncoder->nTextBytes / output->pEncoder->nEncodedBytes);
+   }
+   if(options->bEstimate)
+   {
+      printf("Estimated robot time: %.1f s (joint travel %.1f / %.1f deg, %d pen moves)\n", output->seconds,
+         output->travelDeg[0], output->travelDeg[1], output->nPenMoves);
+   }
+   if(options->bBenchmark)
+   {
+      printf("Planning took %.3f ms: %.0f robot commands/s, %.0f joint setpoints/s\n", elapsedUs / 1000.0,
+         elapsedUs > 0.0 ? output->nCommands * 1e6 / elapsedUs : 0.0,
+         elapsedUs > 0.0 ? output->nSetpoints * 1e6 / elapsedUs : 0.0);
+   }
+}
+
+
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// This function processes a user-inputted or file-read command string, i.e., "moveTo 300.0 400.0\n". then is tokenized 
+// to extract the command name (i.e., "moveTo") and the command arguments (i.e.,"300.0"  "400.0"). If name isnt found
+// in SCARA_COMMANDS or any argument doesn't match the command's ARG_SCHEMA, the function formats an error message and
+// returns -1. The error message contains the file line number if the command was read from a file.  If all arguments
+// are valid, their values are stored in cmd (ARG_KEYWORD arguments store the position of the word in the keyword list)
+// INPUTS: strCommand - The user-inputted or file-read command string (tokenized in place)
+//         cmd - where to store the parsed command
+//         strError - a pointer to a string used to store an error message
+//         lineNumber - the line number of the command string if read from a file or -1 if user-inputted
+// RETURN: the index of the command in SCARA_COMMANDS, or -1 if the command and/or arguments was not valid
+int parseCommand(char *strCommand, PARSED_COMMAND *cmd, char *strErrorMsg, int lineNumber)
+{
+   int index = -1;  // stores the index of the command from SCARA_COMMANDS if found and has valid argument data
+   char *tok = NULL, *nextTok = NULL;  // for tokenizing strCommand
+   const char *seps = " \t\n\r,;:\\/_"; // for tokenzing strCommand.  Possibly delimeters (can be altered if desired)
+   char *pGarbage = NULL;  //  will store if there is any trailing garbage
+   char strLine[24] = "";  // " (line n)" for file-read commands
+   char strCount[24] = ""; // number of arguments the command takes, i.e. "7" or "5 to 17"
+   const ARG_SCHEMA *schema;  // what the argument being parsed must look like
+   double value;           // value of a number argument
+   size_t len = 0;         // length of a path argument
+   int i, k;               // argument, keyword
+
+   if(lineNumber != -1) sprintf_s(strLine, " (line %d)", lineNumber);
+
+   // tokenizing the first command and compare it with the Scara Commands
+   tok = strtok_s(strCommand, seps, &nextTok); // tokenize the command name (i.e., "moveTo")
+   if(tok != NULL)  // if got something, search for matching command in SCARA_COMMANDS (case-insenstive match!)
+   {
+      for(index = 0; index < NUM_COMMANDS; index++)
+      {
+         if(_stricmp(tok, SCARA_COMMANDS[index].cmdName) == 0) break;
+      }
+   }
+
+   if(tok == NULL || index == NUM_COMMANDS)  // command not found, format error message and return
+   {
+      sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "%s is not a valid command%s", tok, strLine);
+      return -1;
+   }
+
+   cmd->index = index;
+   cmd->lineNumber = lineNumber;
+   if(SCARA_COMMANDS[index].nMinArgs > 0)
+      sprintf_s(strCount, "%d to %d", SCARA_COMMANDS[index].nMinArgs, SCARA_COMMANDS[index].nArgs);
+   else
+      sprintf_s(strCount, "%d", SCARA_COMMANDS[index].nArgs);
+
+   // command name ok.  Every argument is checked against the schema of the command
+   for(i = 0; i < SCARA_COMMANDS[index].nArgs; i++)
+   {
+      schema = &SCARA_COMMANDS[index].args[i];
+      if(schema->type != ARG_PATH) tok = strtok_s(NULL, seps, &nextTok);
+      else  // the rest of the line without the blanks around it (a path may hold spaces, '/', '_', ':' ...)
+      {
+         tok = nextTok;
+         while(tok != NULL && (*tok == ' ' || *tok == '\t')) tok++;
+         len = tok == NULL ? 0 : strlen(tok);
+         while(len > 0 && strchr(" \t\r\n", tok[len - 1]) != NULL) len--;
+         if(len == 0) tok = NULL;
+         else
+         {
+            tok[len] = '\0';
+            nextTok = tok + len;
+         }
+      }
+      if(tok == NULL && SCARA_COMMANDS[index].nMinArgs > 0 && i >= SCARA_COMMANDS[index].nMinArgs &&
+         (i - SCARA_COMMANDS[index].nMinArgs) % 2 == 0) break;  // no more optional pairs
+      if(tok == NULL)
+      {
+         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting %s parameter(s).  Should be: %s%s",
+            strCount, SCARA_COMMANDS[index].strArgs, strLine);  // strArgs is insightful text.
+         return -1;
+      }
+
+      if(schema->type == ARG_PATH)
+      {
+         if(len >= MAX_FILENAME_LENGTH)
+         {
+            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "the file name is too long%s", strLine);
+            return -1;
+         }
+         strcpy_s(cmd->strPath, MAX_FILENAME_LENGTH, tok);
+         continue;
+      }
+
+      if(schema->type == ARG_KEYWORD)
+      {
+         for(k = 0; k < schema->nKeywords; k++)
+         {
+            if(_stricmp(tok, schema->keywords[k]) == 0) break;
+         }
+         if(k == schema->nKeywords)
+         {
+            sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "%s is not valid.  Should be: %s%s", tok,
+               SCARA_COMMANDS[index].strArgs, strLine);
+            return -1;
+         }
+         cmd->args[i].iValue = k;
+         continue;
+      }
+
+      value = schema->type == ARG_INT ? (double)strtol(tok, &pGarbage, 10) : strtod(tok, &pGarbage);
+      if(*pGarbage != '\0')
+      {
+         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
+            "You have entered trailing garbage, try again with no garbage this time%s", strLine);
+         return -1;
+      }
+      if(value < schema->minValue || value > schema->maxValue)
+      {
+         sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "Sorry values most be between %g and %g, try again%s",
+            schema->minValue, schema->maxValue, strLine);
+         return -1;
+      }
+      if(schema->type == ARG_INT) cmd->args[i].iValue = (int)value;
+      else cmd->args[i].dValue = value;
+   }
+   cmd->nArgs = i;
+
+   // checking for no extra arguments
+   tok = strtok_s(NULL, seps, &nextTok);
+   if(tok != NULL)
+   {
+      sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "expecting %s parameter(s), you have entered more%s",
+         strCount, strLine);
+      return -1;
+   }
+
+   return index;  // command is valid and has valid arguments so return the index
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Resets the tranform matrix to the unit matrix.  x, y points will no longer be transformed in inverseKinematics
+// INPUTS:  the 3x3 transform matrix
+// RETURN:  nothing
+void resetTransformMatrix(double TM[][3])  // resets to unit matrix
+{
+   int r, c;  // matrix row, column indexes
+
+   for(r = 0; r < 3; r++)
+   {
+      for(c = 0; c < 3; c++)
+      {
+         TM[r][c] = (r == c ? 1.0 : 0.0);  // same as:  if(r==c) 
+      }                                    //               TM[r][c] = 1.0;
+   }                                       //           else
+}                                          //               TM[r][c] = 0.0;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Premultiplies the transform matrix by matrix M.  M is normally the rotation mat, translation mat, or the scaling mat
+// INPUTS:  TM: the 3x3 transform matrix, M the premultiplier matrix
+// RETURN:  nothing
+void transformMatrixMultiply(double TM[][3], double M[][3])
+{
+   int r, c, cc;     // row, column indexes
+   double TMM[3][3]; // temp matrix
+
+   for(r = 0; r < 3; r++)
+   {
+      for(c = 0; c < 3; c++)
+      {
+         TMM[r][c] = 0.0;  // set element to zero
+
+         for(cc = 0; cc < 3; cc++) // accumulate the multiples
+         {
+            TMM[r][c] += M[r][cc] * TM[cc][c];
+         }
+      }
+   }
+
+   for(r = 0; r < 3; r++)  // copy temp matrix to TM
+   {
+      for(c = 0; c < 3; c++)
+      {
+         TM[r][c] = TMM[r][c];
+      }
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Calculates the number of points to be drawn using drawLine or drawArc.  Number is based on length of line/arc- resol
+// INPUTS:  len:  the length of the line or arc to be drawn. resolution: integer parameter to control the point spacing
+// RETURN:  the number of points
+int getN(double len, int resolution)
+{
+   int N; // calculated number of points
+
+   if(resolution == RESOLUTION_HIGH)
+      N = nint(40.0 * (double)len / 600.0);        // i.e., 80 points across the workspace
+   else if(resolution == RESOLUTION_MEDIUM)
+      N = nint(20.0 * (double)len / 600.0);        // i.e., 40 points across the workspace
+   else
+      N = nint(10.0 * (double)len / 600.0);        // i.e., 20 points across the workspace
+
+   return N;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// // Calculates the integer value nearest to a given floating point value (i.e., 6.2 would give 6, -7.9 would give -8)
+// INPUTS:  d:  the double
+// RETURN:  the nearest integer
+int nint(double d)
+{
+   return (int)floor(d + 0.5);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sets the robot to its starting state
+// INPUTS:  none
+// RETURN:  none
+//---------------------------------------------------------------------------------------------------------------------
+void pauseAndClearRobotAndConsole()
+{
+   if(bInteractive)  // nobody to press ENTER or look at the console in an unattended run
+   {
+      printf("Press ENTER to continue...");
+      waitForEnterKey();
+      system("cls");
+   }
+   sendToRobot("MOTOR_SPEED HIGH\n");
+   sendToRobot("HOME\n");
+   sendToRobot("CLEAR_TRACE\n");
+   sendToRobot("CLEAR_POSITION_LOG\n");
+   sendToRobot("CLEAR_REMOTE_COMMAND_LOG\n");  // must be last or all unprocessed commands are lost!
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// This function computes the SCARA forward solution for a given pair of joint angles.
+// INPUTS:  The joint angles theta1Deg and theta2Deg (in DEGREES!!!!!!!!)
+// RETURN:  an FORWARD_SOLUTION structure containing coordinate position x,y corresponding
+//          to the input joint angles
+FORWARD_SOLUTION forwardKinematics(double theta1Deg, double theta2Deg)
+{
+   return forwardKinematicsT<ARM_SCARA600>(theta1Deg, theta2Deg);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks if a string (normally got from a line in a file) contains only whitespace
+// INPUTS:  strLine:  the string
+// RETURN:  true strLine only contains whitespace, false if not.
+bool isBlankLine(const char *strLine)
+{
+   size_t n, len = strlen(strLine);  // n = temp index.  len = # of characters in the string
+   char c;
+
+   for(n = 0; n < len; n++)
+   {
+      c = strLine[n];
+      if(c != ' ' && c != '\t' && c != '\n' && c != '\r') return false;  // if non-whitespace found, return false
+   }
+
+   return true;  // no whitespace characters found!
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks if a string (normally got from a line in a file) is meant to be a comment string.  Comment lines start 
+// with // or \\.
+// INPUTS:  strLine:  the string
+// RETURN:  true if considered a comment string, false if not.
+bool isCommentLine(const char *strLine)
+{
+   size_t n, len = strlen(strLine);
+   char c;
+
+   for(n = 0; n < len; n++)
+   {
+      c = strLine[n];
+      if(c == ' ' || c == '\t' || c == '\n' || c == '\r') continue;  // skip leading whitespace
+
+      if((c == '\\' || c == '/') && n == len - 1) // note that '\\' is c for single '\'
+         return false;  // only one possible because at end of the string (special case)
+      else if((c == '\\' || c == '/') && (strLine[n + 1] == '\\' || strLine[n + 1] == '/'))
+         return true; // it's a comment line!
+   }
+   return false; // if here than line doesn't start with \\ or //
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Turns an entire input string to upper case characters
+// INPUTS:  str:  the string
+// RETURN:  the address of the string (useful for strcpy_s, strcmp, strcat_s functions)
+char *makeUpper(char *str)
+{
+   size_t n, len;
+
+   len = strlen(str);
+
+   for(n = 0; n < len; n++)
+   {
+      str[n] = (char)toupper(str[n]);
+   }
+
+   return str;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Converts an angle in degrees to radians
+// INPUTS:  angDeg: the angle in degrees
+// RETURN:  the angle in radians
+double degToRad(double angDeg)
+{
+   return (PI / 180.0) * angDeg;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Converts an angle in radians to degrees
+// INPUTS:  angRad: the angle in radian
+// RETURN:  the angle in degrees
+double radToDeg(double angRad)
+{
+   return (180.0 / PI) * angRad;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Closes the robot and the program.  Outputs a message to the console and asks the user to press ENTER before closing
+// (unless the program was started with command line options).
+// INPUTS:  message:  the message string
+// RETURN:  none
+void closeAndExit(const char *message)
+{
+   printf("\n%s\n", message);
+   if(bInteractive)
+   {
+      printf("Press ENTER to end this program...");
+      waitForEnterKey();
+   }
+   traceClose();  // make sure a running trace reaches the disk
+   ikCacheClose();
+   flushRobotStream();
+   if(bRobotConnected) robot.Close(); // close remote connection
+   exit(programExitCode);  // exit terminates a console program immediately
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  This function flushes the input buffer to avoid scanf issues
+// ARGUMENTS:    none
+// RETURN VALUE: false if nothing or only '\n' in stdin. true if extra keystrokes precede the '\n'.
+//               Good for detecting left over garbage from scanf_s in the input buffer
+bool flushInputBuffer()
+{
+   int ch; // temp character variable (an int, so EOF can't be mistaken for a character)
+   bool bHasGarbage = false;
+
+   // exit loop when all characters are flushed
+   while((ch = getchar()) != '\n' && ch != EOF)
+   {
+      if(!bHasGarbage) bHasGarbage = true;
+   }
+   return bHasGarbage;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Waits for user to press enter.  flushes stdin if keystrokes precede enter
+// ARGUMENTS:    none
+// RETURN VALUE: none
+void waitForEnterKey()
+{
+   int ch;  // the key, or EOF at the end of piped input
+   if((ch = getchar()) != EOF && ch != '\n') flushInputBuffer();
+}
+
+//----------------------------------------------------------------------------------------------------------------
+//Thus function  will ask the user if he/she want to get the that from keyboard or file
+//Arguments: None
+//return value: an integer of 0 if its from keyboard or 1 if file
+
+int getDataInputMode()
+{
+   char inputData[MAX_ARG_STRING_LENGTH]; // a varialbe to store input value from the user
+   char kb[MAX_ARG_STRING_LENGTH] = "keyboard\n"; // to compare with the inputData and kyboard
+   char f[MAX_ARG_STRING_LENGTH] = "file\n";       // to compare with the inputData and file
+   char m[MAX_ARG_STRING_LENGTH] = "multi\n";      // to compare with the inputData and multi (several robots)
+   char sh[MAX_ARG_STRING_LENGTH] = "shared\n";    // to compare with the inputData and shared (shared workspace)
+   char st[MAX_ARG_STRING_LENGTH] = "stream\n";    // to compare with the inputData and stream (lookahead mode)
+   char sv[MAX_ARG_STRING_LENGTH] = "server\n";    // to compare with the inputData and server (socket server)
+   char b[MAX_ARG_STRING_LENGTH] = "batch\n";      // to compare with the inputData and batch (offline planner)
+   int ret; // to store the return value of stricmp
+   size_t strLength;    // to calculate the length of the input string
+
+   do
+   {
+      printf("From where do you want to get the data: \"file\" or \"keyboard\" "
+         "(or \"multi\" / \"shared\" / \"stream\" / \"server\" / \"batch\")\t");
+      if(fgets(inputData, MAX_ARG_STRING_LENGTH, stdin) == NULL) closeAndExit("Sorry there is no more input");
+
+      strLength = strlen(inputData);
+
+      if(strLength == strlen(kb))
+      {
+         ret = _stricmp(inputData, kb);
+         if(ret != 0) printf("Sorry didnt type the right word try again \n");
+         else if(ret == 0)
+         {
+            printf("Good you have type %s", inputData);
+            return KEYBOARD_INPUT;
+         }
+      }
+
+      else if(strLength == strlen(f))
+
+      {
+         ret = _stricmp(inputData, f);
+         if(ret != 0) printf("Sorry didnt type the right word try again \n");
+         else if(ret == 0)
+         {
+            printf("Good you have type %s", inputData);
+            return FILE_INPUT;
+         }
+
+      }
+      else if(strLength == strlen(m))  // same length as "batch"
+      {
+         if(_stricmp(inputData, m) == 0)
+         {
+            printf("Good you have type %s", inputData);
+            return MULTI_ROBOT_INPUT;
+         }
+         else if(_stricmp(inputData, b) == 0)
+         {
+            printf("Good you have type %s", inputData);
+            return BATCH_INPUT;
+         }
+         else printf("Sorry didnt type the right word try again \n");
+      }
+      else if(strLength == strlen(sh))  // same length as "stream" and "server"
+      {
+         if(_stricmp(inputData, sh) == 0)
+         {
+            printf("Good you have type %s", inputData);
+            return SHARED_WORKSPACE_INPUT;
+         }
+         else if(_stricmp(inputData, st) == 0)
+         {
+            printf("Good you have type %s", inputData);
+            return STREAM_INPUT;
+         }
+         else if(_stricmp(inputData, sv) == 0)
+         {
+            printf("Good you have type %s", inputData);
+            return SERVER_INPUT;
+         }
+         else printf("Sorry didnt type the right word try again \n");
+      }
+      else printf("You didnt type either keboard or file try again!\n");
+
+   }
+   while(true);
+   return 0;
+}
+
+
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// function that when called, will print all the SCARA COMMANDS and Arguments for each command
+// return value . void
+// arguments none (the commands are described in SCARA_COMMANDS)
+void help()
+{
+   int i;      // for counting in for loops
+
+   for(i = 0; i < NUM_COMMANDS; i++)
+   {
+      printf("SCARA_COMMAND_%d\n", i);
+      printf("Command Name: %s. Number of Arguments: %d. And str Arguments are: %s.\n\n",
+         SCARA_COMMANDS[i].cmdName, SCARA_COMMANDS[i].nArgs, SCARA_COMMANDS[i].strArgs);
+   }
+
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// This function will run a series of commands typed by the user using the keyboard and will call executCommand funtion
+// arguments: the current state and tranformMatrix
+// return value: none.
+void runKeyboardCommands(SCARA_STATE *state, double transformMatrix[3][3])
+{
+   PARSED_COMMAND cmd;   // the parsed command
+   int index;   // to store the return value of parseCommand which is the index of the found command
+   char strCommand[MAX_COMMAND_LENGTH];         // string that stores the input command
+   char strErrorMsg[MAX_MESSAGE_LENGTH] = {};    // string that will return the error message if the command isnt found
+
+   while(true)
+   {
+      printf("Please enter a command with argument values (type Q to quit or H for help): ");
+      if(fgets(strCommand, MAX_COMMAND_LENGTH, stdin) == NULL) break;  // end of the piped commands
+      if(toupper(strCommand[0]) == 'Q' && strlen(strCommand) == 2) break;
+      else if(toupper(strCommand[0]) == 'H' && strlen(strCommand) == 2)
+      {
+         help();
+      }
+      else
+      {
+         double tsLine = traceNow();  // start of this command line in the trace
+         index = parseCommand(strCommand, &cmd, strErrorMsg, -1);
+         if(index == -1) printf("%s\n", strErrorMsg);
+         else
+         {
+            printf("%s is a valid command! (index = %d)\n", strCommand, index);
+            executeCommand(&cmd, state, transformMatrix);
+         }
+         traceSpan("keyboard line", "script", tsLine, -1);
+      }
+   }
+
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// This function will open and read the commands for the robot from a file. 
+// Inputs: scaara commandList, the memory address to update the state of the robot and the matrix, the file name
+//         (NULL to ask the user for it)
+// Return Value: None.
+void runFileCommands(SCARA_STATE *state, double transformMatrix[3][3], const char *fileName)
+{
+   char strInput[MAX_FILENAME_LENGTH] = {};     //variable to store the file name typed by the userr
+
+   if(fileName == NULL)
+   {
+      printf("Please enter the name of the file where you want to get the data from: \n");
+
+      //asked the user for a file name, check for errors and if okay, then used to open the file
+      if(fgets(strInput, MAX_FILENAME_LENGTH, stdin) == NULL)
+      {
+         printf("Sorry but the name of the File isnt valid, the program has finished.");
+         programExitCode = 1;
+         if(bInteractive) waitForEnterKey();
+         return;
+      }
+
+      strInput[strcspn(strInput, "\r\n")] = '\0';  // to substitute the \n char for \0
+      fileName = strInput;
+   }
+
+   if(!runCommandFile(fileName, state, transformMatrix))
+   {
+      printf("Sorry the file could not be open, the program has finished.");
+      programExitCode = 1;
+      if(bInteractive) waitForEnterKey();
+      return;
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads and runs every command of a command file.  Blank and comment lines are skipped, invalid commands are 
+// reported (with their line number) and skipped.  The file is read one command ahead, so the corner at the end of a
+// shape can be blended into the shape after it (continuousPath).
+// Inputs: the file name, scara commandList, the memory address to update the state of the robot and the matrix
+// Return Value: false if the file could not be opened, true otherwise
+bool runCommandFile(const char *fileName, SCARA_STATE *state, double transformMatrix[3][3])
+{
+   FILE *fi = NULL;  // variable for the address of the location of the file
+   errno_t err = 0;  // variable to see of the return value of fopen_s is valid
+   char strCommand[2][MAX_COMMAND_LENGTH];  // buffers to store the line being run and the line after it
+   char strErrorMsg[2][MAX_MESSAGE_LENGTH] = {};  // the error messages of those lines if the command isnt found
+   PARSED_COMMAND cmd[2];  // the parsed commands of those lines
+   int index[2];           // to store the return value of parseCommand which is the index of the found command
+   int lineNumber[2] = {};  // lines of the file of the two commands
+   bool bHaveLine[2];      // true if there is a line in the buffer
+   int cur = 0, next;      // buffer of the line being executed, of the one after it
+   double tsLine;       // start of the current line in the trace
+   PLAN_CACHE oldCache = {}, newCache = {};     // plans of the last run and of this one (--cache)
+   char cacheName[MAX_FILENAME_LENGTH] = {};    // file the plans are kept in
+   bool bCache = bPlanCache && activeCellId == -1 && pJointCapture == NULL && !bDryRun;  // cells may share a job
+
+   // opening the file in read mode and check the file exists
+   err = fopen_s(&fi, fileName, "r");
+   if(err != 0 || fi == NULL) return false;
+   if(bCache)
+   {
+      sprintf_s(cacheName, "%s%s", fileName, STR_PLAN_CACHE_EXTENSION);
+      loadPlanCache(cacheName, &oldCache);
+   }
+
+   bHaveLine[cur] = readCommandLine(fi, strCommand[cur], &lineNumber[cur]);
+   if(bHaveLine[cur]) index[cur] = parseCommand(strCommand[cur], &cmd[cur], strErrorMsg[cur], lineNumber[cur]);
+   while(bHaveLine[cur])
+   {
+      // the line after this one is parsed first
+      next = 1 - cur;
+      lineNumber[next] = lineNumber[cur];
+      bHaveLine[next] = readCommandLine(fi, strCommand[next], &lineNumber[next]);
+      if(bHaveLine[next])
+         index[next] = parseCommand(strCommand[next], &cmd[next], strErrorMsg[next], lineNumber[next]);
+
+      tsLine = traceNow();
+      if(index[cur] == -1) printf("%s\n", strErrorMsg[cur]);
+
+      else
+      {
+         printf("%s is a valid command! (index = %d)\n", strCommand[cur], index[cur]);
+         pNextSegment = state->bContinuousPath && bHaveLine[next] && index[next] != -1 &&
+            isPathCommand(cmd[next].index) ? &cmd[next] : NULL;
+         if(bCache) executeCachedCommand(&cmd[cur], state, transformMatrix, &oldCache, &newCache);
+         else executeCommand(&cmd[cur], state, transformMatrix);
+         pNextSegment = NULL;
+      }
+      traceSpan("script line", "script", tsLine, lineNumber[cur]);
+      cur = next;
+   }
+
+   fclose(fi);  //closing the file.
+   if(bCache)
+   {
+      printf("Plan cache: %d of %d command(s) reused\n", newCache.nHits, newCache.nHits + newCache.nMisses);
+      if(!savePlanCache(cacheName, &newCache)) printf("Sorry the plan cache %s could not be written\n", cacheName);
+      freePlanCache(&oldCache);
+      freePlanCache(&newCache);
+   }
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads the next line of a command file, skipping the blank and comment lines
+// INPUTS:  fi: the open command file, strCommand: where to store the line (MAX_COMMAND_LENGTH characters),
+//          pLineNumber: line number of the last line read, counted on
+// RETURN:  false at the end of the file
+bool readCommandLine(FILE *fi, char *strCommand, int *pLineNumber)
+{
+   while(fgets(strCommand, MAX_COMMAND_LENGTH, fi) != NULL)
+   {
+      (*pLineNumber)++;
+      if(!isBlankLine(strCommand) && !isCommentLine(strCommand)) return true;
+   }
+   return false;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Runs a command like executeCommand, but if the same command was planned before starting in the same state (in this
+// run or the last one) its robot commands are sent again and its end state is taken, without planning it.  Otherwise
+// it is planned and its robot commands and end state are stored in newCache.  Commands that do more than send robot
+// commands and change the state (see isCacheableCommand) always run.  The messages a command prints while it is
+// planned are not repeated when its plan is reused, so a command that could not be carried out isn't stored.  A plan
+// is only reused if the inputs of its key are the same, so a hash collision is never taken for the same command.
+// INPUTS:  cmd, state, transformMatrix: as for executeCommand, oldCache: plans of the last run,
+//          newCache: plans of this run
+// RETURN:  none
+void executeCachedCommand(const PARSED_COMMAND *cmd, SCARA_STATE *state, double transformMatrix[3][3],
+   const PLAN_CACHE *oldCache, PLAN_CACHE *newCache)
+{
+   PLAN_CACHE_ENTRY entry;                      // the plan of the command
+   PLAN_INPUTS inputs;                          // what the plan depends on
+   const PLAN_CACHE *from = newCache;           // cache the plan was found in
+   int e, nUnreachable = pCommandOutput != NULL ? pCommandOutput->nUnreachable : 0;  // plan, shapes out of reach
+   int nRejected = nRejectedCommands;           // commands not carried out so far
+
+   if(!isCacheableCommand(cmd->index))
+   {
+      executeCommand(cmd, state, transformMatrix);
+      return;
+   }
+
+   entry.key = getPlanKey(cmd, state, transformMatrix, &inputs);
+   e = findPlanEntry(newCache, entry.key, inputs.bytes, inputs.length);
+   if(e < 0)
+   {
+      from = oldCache;
+      e = findPlanEntry(oldCache, entry.key, inputs.bytes, inputs.length);
+   }
+   if(e >= 0)  // planned before
+   {
+      entry = from->entries[e];
+      replayPlanText(from->text + entry.textStart, entry.textLength, state->robotModel);
+      *state = entry.state;
+      memcpy(transformMatrix[0], entry.transformMatrix, sizeof(entry.transformMatrix));
+      jointDecimals = entry.jointDecimals;
+      if(pCommandOutput != NULL) pCommandOutput->nUnreachable += entry.nUnreachable;
+      newCache->nHits++;
+      if(from == newCache) return;
+
+      entry.inputStart = newCache->textLength;  // keep it for the next run
+      entry.textStart = entry.inputStart + entry.inputLength;
+      if(addPlanText(newCache, inputs.bytes, inputs.length) &&
+         addPlanText(newCache, from->text + from->entries[e].textStart, entry.textLength))
+      {
+         addPlanEntry(newCache, &entry);
+      }
+      return;
+   }
+
+   // plan it, recording its robot commands after the inputs of its key
+   entry.inputStart = newCache->textLength;
+   entry.inputLength = inputs.length;
+   addPlanText(newCache, inputs.bytes, inputs.length);
+   entry.textStart = newCache->textLength;
+   pPlanCapture = newCache;
+   executeCommand(cmd, state, transformMatrix);
+   pPlanCapture = NULL;
+   entry.textLength = newCache->textLength - entry.textStart;
+   entry.state = *state;
+   memcpy(entry.transformMatrix, transformMatrix[0], sizeof(entry.transformMatrix));
+   entry.jointDecimals = jointDecimals;
+   entry.nUnreachable = pCommandOutput != NULL ? pCommandOutput->nUnreachable - nUnreachable : 0;
+   newCache->nMisses++;
+   if(!newCache->bOutOfMemory && nRejectedCommands == nRejected) addPlanEntry(newCache, &entry);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Tells if the plan of a command can be reused: its robot commands and end state only depend on the command and the
+// state it starts in.  Commands that print reports, read other files or start a trace always run.
+// INPUTS:  index: the command index
+// RETURN:  true if the command can be cached
+bool isCacheableCommand(int index)
+{
+   return index != INDEX_QUERY_STATE && index != INDEX_TRACE && index != INDEX_PRECISION_REPORT &&
+      index != INDEX_DRAW_POINTS && index != INDEX_IMPORT_DRAWING && index != INDEX_AUTO_FIT;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds some bytes to a 64-bit FNV-1a hash
+// INPUTS:  h: the hash so far (14695981039346656037 to start), data: the bytes, size: number of bytes
+// RETURN:  the new hash
+unsigned long long hashBytes(unsigned long long h, const void *data, size_t size)
+{
+   const unsigned char *p = (const unsigned char *)data;   // byte counter
+   size_t i;
+
+   for(i = 0; i < size; i++) h = (h ^ p[i]) * 1099511628211ull;
+   return h;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Key of the plan of a command: a hash of the command's values, the state it starts in (position, pen, speed,
+// precision, model, path arm, guard and continuous path), the transform matrix, jointDecimals and the robot profile.
+// In continuous path mode the command after it is hashed too, since its corner is blended into it.  Fields are
+// hashed one by one, so struct padding never changes the key.  The bytes hashed are kept in inputs, so a plan found
+// under the key can be checked against them.
+// INPUTS:  cmd: the command, state, transformMatrix: the state it starts in, inputs: where to put the hashed bytes
+// RETURN:  the key
+unsigned long long getPlanKey(const PARSED_COMMAND *cmd, const SCARA_STATE *state, double transformMatrix[3][3],
+   PLAN_INPUTS *inputs)
+{
+   const SCARA_POSITION *pos = &state->currentPos;
+   int values[] = {pos->armPos, state->motorSpeed, state->penPos, state->cyclePenColors,
+      state->penColor.r, state->penColor.g, state->penColor.b, state->kinematicsPrecision, state->robotModel,
+      state->pathArm, state->bJoinPath, state->bSingularityGuard, state->bContinuousPath,
+      jointDecimals};                                                               // the whole number values
+   double position[] = {pos->x, pos->y, pos->theta1Deg, pos->theta2Deg, state->blendToleranceDeg};  // pen, blend
+
+   inputs->length = 0;
+   addCommandInputs(inputs, cmd);
+   addPlanInputs(inputs, values, sizeof(values));
+   addPlanInputs(inputs, position, sizeof(position));
+   addPlanInputs(inputs, transformMatrix[0], 9 * sizeof(double));
+   if(state->bContinuousPath && pNextSegment != NULL) addCommandInputs(inputs, pNextSegment);
+   addRobotProfileInputs(inputs);
+   return hashBytes(14695981039346656037ull, inputs->bytes, inputs->length);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds some bytes to the inputs of a key
+// INPUTS:  inputs: the inputs so far, data: the bytes, size: number of bytes
+// RETURN:  none
+void addPlanInputs(PLAN_INPUTS *inputs, const void *data, size_t size)
+{
+   memcpy(inputs->bytes + inputs->length, data, size);
+   inputs->length += size;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds a parsed command (its index, the values of its arguments and the file of a path argument, with its ending
+// '\0') to the inputs of a key.  The line number is left out.
+// INPUTS:  inputs: the inputs so far, cmd: the command
+// RETURN:  none
+void addCommandInputs(PLAN_INPUTS *inputs, const PARSED_COMMAND *cmd)
+{
+   const ARG_SCHEMA *schema = SCARA_COMMANDS[cmd->index].args;  // types of the arguments
+   int i;
+
+   addPlanInputs(inputs, &cmd->index, sizeof(int));
+   addPlanInputs(inputs, &cmd->nArgs, sizeof(int));
+   for(i = 0; i < cmd->nArgs; i++)  // only the used part of each union
+   {
+      if(schema[i].type == ARG_DOUBLE) addPlanInputs(inputs, &cmd->args[i].dValue, sizeof(double));
+      else if(schema[i].type == ARG_PATH) addPlanInputs(inputs, cmd->strPath, strlen(cmd->strPath) + 1);
+      else addPlanInputs(inputs, &cmd->args[i].iValue, sizeof(int));
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds a parsed command to a hash (see addCommandInputs)
+// INPUTS:  h: the hash so far, cmd: the command
+// RETURN:  the new hash
+unsigned long long hashCommand(unsigned long long h, const PARSED_COMMAND *cmd)
+{
+   PLAN_INPUTS inputs;   // the bytes of the command
+
+   inputs.length = 0;
+   addCommandInputs(&inputs, cmd);
+   return hashBytes(h, inputs.bytes, inputs.length);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds the robot profile (what the plans of the profile model depend on) to the inputs of a key, if one is loaded
+// INPUTS:  inputs: the inputs so far
+// RETURN:  none
+void addRobotProfileInputs(PLAN_INPUTS *inputs)
+{
+   if(!robotProfile.bLoaded) return;
+
+   double profile[] = {robotProfile.L1, robotProfile.L2, robotProfile.maxAbsTheta1Deg, robotProfile.maxAbsTheta2Deg,
+      robotProfile.homeDeg[0], robotProfile.homeDeg[1]};   // geometry of the profile model
+   addPlanInputs(inputs, profile, sizeof(profile));
+   addPlanInputs(inputs, robotProfile.bSpeedSupported, sizeof(robotProfile.bSpeedSupported));
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds the robot profile to a hash (see addRobotProfileInputs)
+// INPUTS:  h: the hash so far
+// RETURN:  the new hash
+unsigned long long hashRobotProfile(unsigned long long h)
+{
+   PLAN_INPUTS inputs;   // the bytes of the profile
+
+   inputs.length = 0;
+   addRobotProfileInputs(&inputs);
+   return hashBytes(h, inputs.bytes, inputs.length);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Looks up a plan in the hash table of a cache (linear probing).  A plan with the same key but other inputs is
+// passed over.
+// INPUTS:  cache: the cache, key: key of the plan, inputs, inputLength: the bytes the key was hashed from
+// RETURN:  index of the plan in cache->entries, or -1 if it isn't there
+int findPlanEntry(const PLAN_CACHE *cache, unsigned long long key, const char *inputs, size_t inputLength)
+{
+   int slot;   // slot counter
+
+   if(cache->nSlots == 0) return -1;
+   for(slot = (int)(key & (cache->nSlots - 1)); cache->slots[slot] >= 0; slot = (slot + 1) & (cache->nSlots - 1))
+   {
+      const PLAN_CACHE_ENTRY *entry = &cache->entries[cache->slots[slot]];   // plan in the slot
+      if(entry->key == key && entry->inputLength == inputLength &&
+         memcmp(cache->text + entry->inputStart, inputs, inputLength) == 0) return cache->slots[slot];
+   }
+   return -1;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Stores a plan (its key inputs and robot commands must already be in the cache's text).  The entries and the hash
+// table grow by doubling; the table is kept at most half full.
+// INPUTS:  cache: the cache, entry: the plan
+// RETURN:  false if out of memory
+bool addPlanEntry(PLAN_CACHE *cache, const PLAN_CACHE_ENTRY *entry)
+{
+   int e, slot, mask;   // entry and slot counters, slot mask of the hash table
+
+   if(findPlanEntry(cache, entry->key, cache->text + entry->inputStart, entry->inputLength) >= 0) return true;
+   if(cache->nEntries == cache->capacity)
+   {
+      int capacity = cache->capacity == 0 ? 1024 : 2 * cache->capacity;
+      PLAN_CACHE_ENTRY *entries = (PLAN_CACHE_ENTRY *)realloc(cache->entries, capacity * sizeof(PLAN_CACHE_ENTRY));
+      if(entries == NULL)
+      {
+         cache->bOutOfMemory = true;
+         return false;
+      }
+      cache->entries = entries;
+      cache->capacity = capacity;
+   }
+   if(2 * (cache->nEntries + 1) > cache->nSlots)   // rebuild the hash table twice as big
+   {
+      int nSlots = cache->nSlots == 0 ? 2048 : 2 * cache->nSlots;
+      int *slots = (int *)malloc(nSlots * sizeof(int));
+      if(slots == NULL)
+      {
+         cache->bOutOfMemory = true;
+         return false;
+      }
+      free(cache->slots);
+      cache->slots = slots;
+      cache->nSlots = nSlots;
+      for(slot = 0; slot < nSlots; slot++) slots[slot] = -1;
+      for(e = 0; e < cache->nEntries; e++)
+      {
+         for(slot = (int)(cache->entries[e].key & (nSlots - 1)); slots[slot] >= 0; slot = (slot + 1) & (nSlots - 1));
+         slots[slot] = e;
+      }
+   }
+
+   cache->entries[cache->nEntries] = *entry;
+   mask = cache->nSlots - 1;
+   for(slot = (int)(entry->key & mask); cache->slots[slot] >= 0; slot = (slot + 1) & mask);
+   cache->slots[slot] = cache->nEntries++;
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds robot commands or the inputs of a key to the text of a cache (grows by doubling)
+// INPUTS:  cache: the cache, text: the robot commands or inputs, length: number of characters
+// RETURN:  false if out of memory
+bool addPlanText(PLAN_CACHE *cache, const char *text, size_t length)
+{
+   if(cache->bOutOfMemory) return false;
+   if(cache->textLength + length > cache->textCapacity)
+   {
+      size_t capacity = cache->textCapacity == 0 ? 64 * 1024 : 2 * cache->textCapacity;
+      while(capacity < cache->textLength + length) capacity *= 2;
+      char *newText = (char *)realloc(cache->text, capacity);
+      if(newText == NULL)
+      {
+         cache->bOutOfMemory = true;
+         return false;
+      }
+      cache->text = newText;
+      cache->textCapacity = capacity;
+   }
+   memcpy(cache->text + cache->textLength, text, length);
+   cache->textLength += length;
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sends the robot commands of a stored plan, one line at a time, and keeps the run estimate (--estimate) as if they
+// had been planned
+// INPUTS:  text: the robot commands (each ending with \n), length: number of characters, robotModel: model the plan
+//          was made for (where HOME goes)
+// RETURN:  none
+void replayPlanText(const char *text, size_t length, int robotModel)
+{
+   SCARA_POSITION home = {};              // pose after HOME
+   char strCommand[MAX_COMMAND_LENGTH];   // one robot command
+   const char *end = text + length, *p;   // end of the text, end of the command
+   const char *setpointPrefix = "ROTATE_JOINT ANG1 ", *ang2 = " ANG2 ";  // how sendJointSetpoint writes a setpoint
+   char *pAng;                            // end of the first angle
+   size_t n;                              // length of the command
+   double theta1Deg, theta2Deg;           // joint angles of a ROTATE_JOINT
+
+   while(text < end)
+   {
+      p = (const char *)memchr(text, '\n', end - text);
+      p = p == NULL ? end : p + 1;
+      n = (size_t)(p - text) < MAX_COMMAND_LENGTH ? (size_t)(p - text) : MAX_COMMAND_LENGTH - 1;
+      memcpy(strCommand, text, n);
+      strCommand[n] = '\0';
+      text = p;
+
+      sendToRobot(strCommand);
+      if(pCommandOutput == NULL) continue;
+      if(strncmp(strCommand, setpointPrefix, strlen(setpointPrefix)) == 0)
+      {
+         theta1Deg = strtod(strCommand + strlen(setpointPrefix), &pAng);
+         if(strncmp(pAng, ang2, strlen(ang2)) != 0) continue;
+         theta2Deg = strtod(pAng + strlen(ang2), NULL);
+         addEstimatedMove(pCommandOutput, theta1Deg, theta2Deg);
+      }
+      else if(strcmp(strCommand, "HOME\n") == 0)
+      {
+         getHomePosition(robotModel, &home);
+         addEstimatedMove(pCommandOutput, home.theta1Deg, home.theta2Deg);
+      }
+   }
+   flushRobotStream();
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads a plan cache file.  A missing file, or one of another version, gives an empty cache.
+// INPUTS:  fileName: the file, cache: where to store the plans (empty)
+// RETURN:  false if the file could not be read (the cache is left empty)
+bool loadPlanCache(const char *fileName, PLAN_CACHE *cache)
+{
+   FILE *fi = NULL;                  // the file
+   char magic[sizeof(PLAN_CACHE_MAGIC)] = {};   // start of the file
+   int header[3] = {};               // version, size of an entry, number of entries
+   size_t textLength = 0;            // characters of robot commands
+   PLAN_CACHE_ENTRY entry;           // a plan
+   int e;                            // entry counter
+   bool bOk = true;
+
+   if(fopen_s(&fi, fileName, "rb") != 0 || fi == NULL) return true;
+   if(fread(magic, 1, sizeof(magic), fi) != sizeof(magic) || memcmp(magic, PLAN_CACHE_MAGIC, sizeof(magic)) != 0 ||
+      fread(header, sizeof(int), 3, fi) != 3 || header[0] != PLAN_CACHE_VERSION ||
+      header[1] != (int)sizeof(PLAN_CACHE_ENTRY) || fread(&textLength, sizeof(size_t), 1, fi) != 1)
+   {
+      fclose(fi);
+      return true;
+   }
+
+   // the text first, so the entries can be checked against it
+   if(textLength > 0)
+   {
+      cache->text = (char *)malloc(textLength);
+      bOk = cache->text != NULL && fread(cache->text, 1, textLength, fi) == textLength;
+      cache->textLength = cache->textCapacity = bOk ? textLength : 0;
+   }
+   for(e = 0; bOk && e < header[2]; e++)
+   {
+      bOk = fread(&entry, sizeof(entry), 1, fi) == 1 && entry.textStart <= textLength &&
+         entry.textLength <= textLength - entry.textStart && entry.inputStart <= textLength &&
+         entry.inputLength <= textLength - entry.inputStart && addPlanEntry(cache, &entry);
+   }
+   fclose(fi);
+   if(!bOk)
+   {
+      freePlanCache(cache);
+      printf("Sorry the plan cache %s could not be read, every command is planned again\n", fileName);
+   }
+   return bOk;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes a plan cache file: the magic, the version, the size of an entry, the number of entries and of characters of
+// robot commands, the robot commands (and key inputs) and the entries.  Only the plans used in this run are kept.
+// INPUTS:  fileName: the file, cache: the plans
+// RETURN:  false if the file could not be written
+bool savePlanCache(const char *fileName, const PLAN_CACHE *cache)
+{
+   FILE *fo = NULL;   // the file
+   int header[3] = {PLAN_CACHE_VERSION, (int)sizeof(PLAN_CACHE_ENTRY), cache->nEntries};
+   bool bOk;
+
+   if(fopen_s(&fo, fileName, "wb") != 0 || fo == NULL) return false;
+   bOk = fwrite(PLAN_CACHE_MAGIC, 1, sizeof(PLAN_CACHE_MAGIC), fo) == sizeof(PLAN_CACHE_MAGIC) &&
+      fwrite(header, sizeof(int), 3, fo) == 3 && fwrite(&cache->textLength, sizeof(size_t), 1, fo) == 1 &&
+      fwrite(cache->text, 1, cache->textLength, fo) == cache->textLength &&
+      fwrite(cache->entries, sizeof(PLAN_CACHE_ENTRY), cache->nEntries, fo) == (size_t)cache->nEntries;
+   if(fclose(fo) != 0) bOk = false;
+   return bOk;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Frees the memory of a plan cache and empties it
+// INPUTS:  cache: the cache
+// RETURN:  none
+void freePlanCache(PLAN_CACHE *cache)
+{
+   free(cache->entries);
+   free(cache->slots);
+   free(cache->text);
+   *cache = {};
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// This function is where already checked and cleaned input is sent and real action happens
+// arguments: the parsed command, actual state of the SCARA robot and the transform Matrix
+// return value: none
+void executeCommand(const PARSED_COMMAND *cmd, SCARA_STATE *state, double transformMatrix[3][3])
+{
+   char cmdStg[MAX_COMMAND_LENGTH] = {};  // local variable to change numbers to strings used for sprintf
+   double rotationMatrix[3][3];  // matrix to perform rotations
+   double translationMatrix[3][3];  // matrix to perform rotations
+   double scalingMatrix[3][3];  // matrix to perform rotations
+   double theta1Rad;   // variable for converting typed angle which is in degrees and convert to rad
+   double xs, ys;      // start of an arc (not used)
+   // one side of a rectangle or triangle, drawn as a line
+   PARSED_COMMAND side = {};
+   double corners[4][2];  // corners of a rectangle or triangle, in drawing order
+   int nCorners = 0, i;   // number of corners, corner
+   double tsCommand = traceNow();  // start of this command in the trace
+   const COMMAND_ARGUMENT *args = cmd->args;  // argument values of the command
+
+   switch(cmd->index)
+   {
+      // the keyword arguments hold the enum value of the word, so they map straight onto the state
+   case INDEX_MOTOR_SPEED:
+      if(state->robotModel == ROBOT_MODEL_PROFILE && !robotProfile.bSpeedSupported[args[0].iValue])
+      {
+         fprintf(messageFile(), "Motor speed %s is not supported by robot %s\n",
+            MOTOR_SPEED_KEYWORDS[args[0].iValue], robotProfile.name);
+         nRejectedCommands++;
+         break;
+      }
+      if(args[0].iValue == MOTOR_SPEED_HIGH) sendToRobot("MOTOR_SPEED HIGH\n");
+      else if(args[0].iValue == MOTOR_SPEED_MEDIUM) sendToRobot("MOTOR_SPEED MEDIUM\n");
+      else sendToRobot("MOTOR_SPEED LOW\n");
+      state->motorSpeed = args[0].iValue;
+      break;
+
+   case INDEX_PEN_POS:
+      sendToRobot(args[0].iValue == PEN_UP ? "PEN_UP\n" : "PEN_DOWN\n");
+      state->penPos = args[0].iValue;
+      break;
+
+   case INDEX_PEN_COLOR:
+      {
+         char *p = appendText(cmdStg, cmdStg + MAX_COMMAND_LENGTH - 1, "PEN_COLOR");
+         for(i = 0; i < 3; i++)
+         {
+            p = appendText(p, cmdStg + MAX_COMMAND_LENGTH - 1, " ");
+            p = appendInt(p, cmdStg + MAX_COMMAND_LENGTH - 1, args[i].iValue);
+         }
+         p = appendText(p, cmdStg + MAX_COMMAND_LENGTH - 1, "\n");
+         *p = '\0';
+         sendToRobot(cmdStg);
+      }
+      state->penColor.r = args[0].iValue;
+      state->penColor.g = args[1].iValue;
+      state->penColor.b = args[2].iValue;
+      break;
+
+   case INDEX_CYCLE_PEN_COLORS:
+      sendToRobot(args[0].iValue == CYCLE_PEN_COLORS_ON ? "CYCLE_PEN_COLOR ON\n" : "CYCLE_PEN_COLOR OFF\n");
+      state->cyclePenColors = args[0].iValue;
+      break;
+
+   case INDEX_CLEAR_TRACE:
+      sendToRobot("CLEAR_TRACE\n");
+      break;
+
+   case INDEX_CLEAR_REMOTE_COMMAND_LOG:
+      sendToRobot("CLEAR_REMOTE_COMMAND_LOG\n");
+      break;
+
+   case INDEX_SHUTDOWN_SIMULATION:
+      sendToRobot("SHUTDOWN_SIMULATION\n");
+      break;
+
+   case INDEX_HOME:
+      sendToRobot("HOME\n");
+      getHomePosition(state->robotModel, &state->currentPos);
+      if(pJointCapture != NULL)  // only recorded, not sent
+         sendJointSetpoint(state->currentPos.theta1Deg, state->currentPos.theta2Deg);
+      else if(pCommandOutput != NULL && !bDryRun)
+         addEstimatedMove(pCommandOutput, state->currentPos.theta1Deg, state->currentPos.theta2Deg);
+      break;
+
+   case INDEX_MOVE_TO:
+      drawStraightLine(cmd, transformMatrix, state);
+      state->currentPos.x = args[0].dValue;
+      state->currentPos.y = args[1].dValue;
+      break;
+
+   case INDEX_DRAW_LINE:
+      drawStraightLine(cmd, transformMatrix, state);
+      state->currentPos.x = args[2].dValue;
+      state->currentPos.y = args[3].dValue;
+      break;
+
+   case INDEX_DRAW_ARC:
+      drawArc(cmd, transformMatrix, state);
+      getPathEnds(cmd, &xs, &ys, &state->currentPos.x, &state->currentPos.y);
+      break;
+
+   case INDEX_DRAW_RECTANGLE:
+   case INDEX_DRAW_TRIANGLE:
+      nCorners = getShapeCorners(cmd, corners);
+      break;
+
+   case INDEX_ADD_ROTATION:
+      theta1Rad = degToRad(args[0].dValue);
+      rotationMatrix[0][0] = cos(theta1Rad);
+      rotationMatrix[0][1] = -sin(theta1Rad);
+      rotationMatrix[0][2] = 0.0;
+      rotationMatrix[1][0] = sin(theta1Rad);
+      rotationMatrix[1][1] = cos(theta1Rad);
+      rotationMatrix[1][2] = 0.0;
+      rotationMatrix[2][0] = 0.0;
+      rotationMatrix[2][1] = 0.0;
+      rotationMatrix[2][2] = 1.0;
+      transformMatrixMultiply(transformMatrix, rotationMatrix);
+      break;
+
+   case INDEX_ADD_TRANSLATION:
+      translationMatrix[0][0] = 1.0;
+      translationMatrix[0][1] = 0.0;
+      translationMatrix[0][2] = args[0].dValue;
+      translationMatrix[1][0] = 0.0;
+      translationMatrix[1][1] = 1.0;
+      translationMatrix[1][2] = args[1].dValue;
+      translationMatrix[2][0] = 0.0;
+      translationMatrix[2][1] = 0.0;
+      translationMatrix[2][2] = 1.0;
+      transformMatrixMultiply(transformMatrix, translationMatrix);
+      break;
+
+   case INDEX_ADD_SCALING:
+      scalingMatrix[0][0] = args[0].dValue;
+      scalingMatrix[0][1] = 0.0;
+      scalingMatrix[0][2] = 0.0;
+      scalingMatrix[1][0] = 0.0;
+      scalingMatrix[1][1] = args[1].dValue;
+      scalingMatrix[1][2] = 0.0;
+      scalingMatrix[2][0] = 0.0;
+      scalingMatrix[2][1] = 0.0;
+      scalingMatrix[2][2] = 1.0;
+      transformMatrixMultiply(transformMatrix, scalingMatrix);
+      break;
+
+   case INDEX_RESET_TRANSFORMATION_MATRIX:
+      resetTransformMatrix(transformMatrix);
+      break;
+
+   case INDEX_QUERY_STATE:
+      {
+         char strState[4 * MAX_MESSAGE_LENGTH];  // state report
+         formatState(state, strState, sizeof(strState));
+         fprintf(messageFile(), "%s", strState);
+         if(pReplyClient != NULL) serverQueueReply(pReplyClient, strState);  // server mode answers the client
+      }
+      break;
+
+   case INDEX_TRACE:
+      if(args[0].iValue == TRACE_ON)
+      {
+         char traceFileName[MAX_FILENAME_LENGTH];  // each robot cell writes its own trace
+         if(activeCellId < 0) strcpy_s(traceFileName, TRACE_FILENAME);
+         else sprintf_s(traceFileName, "cell%d_%s", activeCellId, TRACE_FILENAME);
+         if(!traceOpen(traceFileName))
+         {
+            fprintf(messageFile(), "Sorry the trace file %s could not be open\n", traceFileName);
+            nRejectedCommands++;
+         }
+      }
+      else
+      {
+         traceClose();
+      }
+      break;
+
+   case INDEX_KINEMATICS_PRECISION:
+      state->kinematicsPrecision = args[0].iValue;
+      break;
+
+   case INDEX_PRECISION_REPORT:
+      precisionReport(state);
+      break;
+
+   case INDEX_ROBOT_MODEL:
+      if(args[0].iValue == ROBOT_MODEL_PROFILE && !robotProfile.bLoaded)
+      {
+         fprintf(messageFile(), "No robot profile was loaded from %s\n", ROBOT_PROFILE_FILENAME);
+         nRejectedCommands++;
+         break;
+      }
+      state->robotModel = args[0].iValue;
+      break;
+
+   case INDEX_JOINT_DECIMALS:
+      jointDecimals = args[0].iValue;
+      break;
+
+   case INDEX_DRAW_POINTS:
+      drawPoints(cmd, transformMatrix, state);
+      break;
+
+   case INDEX_DRAW_QUAD_BEZIER:
+   case INDEX_DRAW_CUBIC_BEZIER:
+   case INDEX_DRAW_SPLINE:
+      drawCurve(cmd, transformMatrix, state);
+      getPathEnds(cmd, &xs, &ys, &state->currentPos.x, &state->currentPos.y);
+      break;
+
+   case INDEX_IMPORT_DRAWING:
+      importDrawing(cmd, transformMatrix, state);
+      break;
+
+   case INDEX_AUTO_FIT:
+      autoFit(cmd, transformMatrix, state);
+      break;
+
+   case INDEX_SINGULARITY_GUARD:
+      state->bSingularityGuard = args[0].iValue == SINGULARITY_GUARD_ON;
+      break;
+
+   case INDEX_CONTINUOUS_PATH:
+      state->bContinuousPath = args[0].iValue == CONTINUOUS_PATH_ON;
+      state->blendToleranceDeg = args[1].dValue;
+      break;
+   }
+
+   // rectangles and triangles are drawn side by side as lines (the command itself is left as it was parsed).  In
+   // continuous path mode each side continues the one before it and its corners are blended into the next side
+   if(nCorners > 0)
+   {
+      const PARSED_COMMAND *pAfter = pNextSegment;   // command drawn after the shape
+      PARSED_COMMAND nextSide;                       // side drawn after the current one
+
+      side.index = INDEX_DRAW_LINE;
+      side.lineNumber = cmd->lineNumber;
+      side.nArgs = SCARA_COMMANDS[INDEX_DRAW_LINE].nArgs;
+      side.args[4] = args[SCARA_COMMANDS[cmd->index].nArgs - 1];  // resolution
+      nextSide = side;
+      for(i = 0; i < nCorners; i++)
+      {
+         side.args[0].dValue = corners[i][0];
+         side.args[1].dValue = corners[i][1];
+         side.args[2].dValue = corners[(i + 1) % nCorners][0];
+         side.args[3].dValue = corners[(i + 1) % nCorners][1];
+         nextSide.args[0] = side.args[2];
+         nextSide.args[1] = side.args[3];
+         nextSide.args[2].dValue = corners[(i + 2) % nCorners][0];
+         nextSide.args[3].dValue = corners[(i + 2) % nCorners][1];
+         pNextSegment = i + 1 < nCorners ? &nextSide : pAfter;
+         drawStraightLine(&side, transformMatrix, state);
+      }
+      pNextSegment = pAfter;
+      state->currentPos.x = corners[0][0];
+      state->currentPos.y = corners[0][1];
+   }
+
+   flushRobotStream();
+   traceSpan(SCARA_COMMANDS[cmd->index].cmdName, "command", tsCommand, -1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets the corners of a drawRectangle or drawTriangle in drawing order.  The sides are drawn as lines between them.
+// INPUTS:  cmd: the parsed command, corners: where to store the corners
+// RETURN:  number of corners (0 if the command isn't a rectangle or triangle)
+int getShapeCorners(const PARSED_COMMAND *cmd, double corners[4][2])
+{
+   const COMMAND_ARGUMENT *args = cmd->args;   // argument values of the command
+   int i;                                      // corner
+
+   if(cmd->index == INDEX_DRAW_RECTANGLE)  // bottom left, top left, top right, bottom right
+   {
+      corners[0][0] = args[0].dValue;  corners[0][1] = args[1].dValue;
+      corners[1][0] = args[0].dValue;  corners[1][1] = args[3].dValue;
+      corners[2][0] = args[2].dValue;  corners[2][1] = args[3].dValue;
+      corners[3][0] = args[2].dValue;  corners[3][1] = args[1].dValue;
+      return 4;
+   }
+   if(cmd->index == INDEX_DRAW_TRIANGLE)  // bottom left, top, bottom right
+   {
+      for(i = 0; i < 3; i++)
+      {
+         corners[i][0] = args[2 * i].dValue;
+         corners[i][1] = args[2 * i + 1].dValue;
+      }
+      return 3;
+   }
+   return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// This function will be called from executeCommand to calculate the n intermediate points of a straight lines and then
+// call inverseKinematics to send the angles to the SCARA robot.  A first pass checks which arm can draw every point
+// (nothing is stored), then each point is interpolated, solved and sent in turn, so the memory used doesn't depend on
+// the number of points
+// arguments the parsed command (moveTo, drawLine or one side of a shape), the transformMatrix and the robot state
+// return value: none since we are sending pointers 
+void drawStraightLine(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   DRAW_STEPPER stepper;                     // works out and sends the points of the line one at a time
+   double tsPhase = traceNow();              // start of the current drawing phase in the trace
+
+   initDrawStepper(&stepper, cmd, transformMatrix, state);
+   traceSpan("inverseKinematics", "drawStraightLine", tsPhase, -1);
+   tsPhase = traceNow();
+
+   while(drawStep(&stepper, transformMatrix, state));
+   traceSpan("interpolate + robot.Send", "drawStraightLine", tsPhase, -1);
+}
+
+
+
+
+//----------------------------------------------------------------------------------------------------------------
+// This function computes the SCARA inverse solution for a given x,y position.
+// both right arm and left arm solutions are returned in the INVERSE_SOLUTION structure.
+// ARM is the arm geometry (link lengths and joint limits are compile-time constants) and REAL is the type used for 
+// the geometry after the transform (double, or float for the reduced precision path).
+// INPUTS:  The position coordinates x, y and the tranformMatrix
+// RETURN:  an INVERSE_SOLUTION structure containing joint angles for both left and 
+//          right arms.  RETURN ANGLES ARE IN DEGREES!!!!!!!!!!!!!!
+template<class ARM, class REAL>
+INVERSE_SOLUTION inverseKinematicsT(double x, double y, double transformMatrix[3][3])
+{
+   INVERSE_SOLUTION isol = {0.0, 0.0, 0.0, 0.0, false, false};  // structure for solution left/right arm angles
+   const REAL rPI = (REAL)PI, rL1 = (REAL)ARM::L1, rL2 = (REAL)ARM::L2;
+   const REAL rRadToDeg = (REAL)(180.0 / PI);
+   const REAL rLMAX2 = (REAL)(ARM_REACH<ARM>::LMAX * ARM_REACH<ARM>::LMAX);
+   REAL len2, len, beta, alfa, theta1, theta2;
+   // to calculate length, angles beta and alfa (from SCARA Robot and Theta1 and 2 in Rad a for both configuration
+
+   // x, y are the original (non-transformed) coordinates.  The transform is always done in double so that big 
+   // translations don't eat the float mantissa
+   REAL xt = (REAL)(x * transformMatrix[0][0] + y * transformMatrix[0][1] + transformMatrix[0][2]);
+   REAL yt = (REAL)(x * transformMatrix[1][0] + y * transformMatrix[1][1] + transformMatrix[1][2]);
+
+   len2 = xt * xt + yt * yt;
+   if(len2 > rLMAX2 || len2 == (REAL)0.0) return isol;  // beyond full extension or on the shoulder, can't reach it
+
+   len = sqrt(len2);
+   beta = atan2(yt, xt);
+   // rounding can take the cosine just past 1 at full extension (acos would give NaN)
+   alfa = (rL2 * rL2 - len2 - rL1 * rL1) / ((REAL)-2.0 * len * rL1);
+   alfa = acos(alfa > (REAL)1.0 ? (REAL)1.0 : (alfa < (REAL)-1.0 ? (REAL)-1.0 : alfa));
+
+   // right arm configuration
+   theta1 = beta - alfa;
+   theta2 = atan2(yt - rL1 * sin(theta1), xt - rL1 * cos(theta1)) - theta1;
+   if(theta2 <= -rPI) theta2 = theta2 + (REAL)2.0 * rPI;
+   else if(theta2 >= rPI) theta2 = (REAL)-2.0 * rPI + theta2;
+   isol.theta1DegRight = theta1 * rRadToDeg;
+   isol.theta2DegRight = theta2 * rRadToDeg;
+
+   if(isol.theta1DegRight >= -ARM::MAX_ABS_THETA1_DEG && isol.theta1DegRight <= ARM::MAX_ABS_THETA1_DEG &&
+      isol.theta2DegRight >= -ARM::MAX_ABS_THETA2_DEG && isol.theta2DegRight <= ARM::MAX_ABS_THETA2_DEG)
+   {
+      isol.bRight = true;
+   }
+
+   // left arm configuration
+   theta1 = beta + alfa;
+   theta2 = atan2(yt - rL1 * sin(theta1), xt - rL1 * cos(theta1)) - theta1;
+   if(theta2 <= -rPI) theta2 = theta2 + (REAL)2.0 * rPI;
+   else if(theta2 >= rPI) theta2 = (REAL)-2.0 * rPI + theta2;
+   isol.theta1DegLeft = theta1 * rRadToDeg;
+   isol.theta2DegLeft = theta2 * rRadToDeg;
+
+   if(isol.theta1DegLeft >= -ARM::MAX_ABS_THETA1_DEG && isol.theta1DegLeft <= ARM::MAX_ABS_THETA1_DEG &&
+      isol.theta2DegLeft >= -ARM::MAX_ABS_THETA2_DEG && isol.theta2DegLeft <= ARM::MAX_ABS_THETA2_DEG)
+   {
+      isol.bLeft = true;
+   }
+   return isol;
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Batch version of inverseKinematicsT (same formulas, same results for every point an arm reaches), used by 
+// drawPoints.  Each step is a plain loop over the batch arrays with no early return, so the compiler can run it with
+// vector instructions; points beyond full extension just end up with both flags false.
+// INPUTS:  batch: the points (x, y, n), transformMatrix
+// RETURN:  none (the joint angles and flags of every point are stored in batch)
+template<class ARM, class REAL>
+void inverseKinematicsBatchT(IK_BATCH *batch, double transformMatrix[3][3])
+{
+   const REAL rPI = (REAL)PI, rL1 = (REAL)ARM::L1, rL2 = (REAL)ARM::L2;
+   const REAL rRadToDeg = (REAL)(180.0 / PI);
+   const REAL rLMAX2 = (REAL)(ARM_REACH<ARM>::LMAX * ARM_REACH<ARM>::LMAX);
+   const double t1 = ARM::MAX_ABS_THETA1_DEG, t2 = ARM::MAX_ABS_THETA2_DEG;   // joint limits
+   REAL xt[POINTS_BATCH], yt[POINTS_BATCH];          // transformed points
+   REAL beta[POINTS_BATCH], alfa[POINTS_BATCH];      // angle of the point and angle between link 1 and the point
+   bool bReach[POINTS_BATCH];                        // point within full extension
+   REAL len2, len, theta1, theta2;
+   int i, n = batch->n;
+
+   // the transform is always done in double (see inverseKinematicsT)
+   for(i = 0; i < n; i++)
+   {
+      xt[i] = (REAL)(batch->x[i] * transformMatrix[0][0] + batch->y[i] * transformMatrix[0][1] + transformMatrix[0][2]);
+      yt[i] = (REAL)(batch->x[i] * transformMatrix[1][0] + batch->y[i] * transformMatrix[1][1] + transformMatrix[1][2]);
+   }
+
+   for(i = 0; i < n; i++)
+   {
+      len2 = xt[i] * xt[i] + yt[i] * yt[i];
+      len = sqrt(len2);
+      bReach[i] = len2 <= rLMAX2 && len2 > (REAL)0.0;
+      beta[i] = atan2(yt[i], xt[i]);
+      alfa[i] = (rL2 * rL2 - len2 - rL1 * rL1) / ((REAL)-2.0 * len * rL1);  // cosine, clamped as in inverseKinematicsT
+      alfa[i] = acos(alfa[i] > (REAL)1.0 ? (REAL)1.0 : (alfa[i] < (REAL)-1.0 ? (REAL)-1.0 : alfa[i]));
+   }
+
+   // right arm configuration
+   for(i = 0; i < n; i++)
+   {
+      theta1 = beta[i] - alfa[i];
+      theta2 = atan2(yt[i] - rL1 * sin(theta1), xt[i] - rL1 * cos(theta1)) - theta1;
+      theta2 = theta2 <= -rPI ? theta2 + (REAL)2.0 * rPI : (theta2 >= rPI ? (REAL)-2.0 * rPI + theta2 : theta2);
+      batch->theta1DegRight[i] = theta1 * rRadToDeg;
+      batch->theta2DegRight[i] = theta2 * rRadToDeg;
+      batch->bRight[i] = bReach[i] && batch->theta1DegRight[i] >= -t1 && batch->theta1DegRight[i] <= t1 &&
+         batch->theta2DegRight[i] >= -t2 && batch->theta2DegRight[i] <= t2;
+   }
+
+   // left arm configuration
+   for(i = 0; i < n; i++)
+   {
+      theta1 = beta[i] + alfa[i];
+      theta2 = atan2(yt[i] - rL1 * sin(theta1), xt[i] - rL1 * cos(theta1)) - theta1;
+      theta2 = theta2 <= -rPI ? theta2 + (REAL)2.0 * rPI : (theta2 >= rPI ? (REAL)-2.0 * rPI + theta2 : theta2);
+      batch->theta1DegLeft[i] = theta1 * rRadToDeg;
+      batch->theta2DegLeft[i] = theta2 * rRadToDeg;
+      batch->bLeft[i] = bReach[i] && batch->theta1DegLeft[i] >= -t1 && batch->theta1DegLeft[i] <= t1 &&
+         batch->theta2DegLeft[i] >= -t2 && batch->theta2DegLeft[i] <= t2;
+   }
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// This function computes the SCARA forward solution for a given pair of joint angles of the ARM geometry.
+// INPUTS:  The joint angles theta1Deg and theta2Deg (in DEGREES!!!!!!!!)
+// RETURN:  an FORWARD_SOLUTION structure containing coordinate position x,y corresponding to the input joint angles
+template<class ARM>
+FORWARD_SOLUTION forwardKinematicsT(double theta1Deg, double theta2Deg)
+{
+   FORWARD_SOLUTION fsol = {0.0, 0.0, true};
+
+   if(fabs(theta1Deg) > ARM::MAX_ABS_THETA1_DEG) fsol.bHasSolution = false;
+   if(fabs(theta2Deg) > ARM::MAX_ABS_THETA2_DEG) fsol.bHasSolution = false;
+
+   if(fsol.bHasSolution)
+   {
+      double theta1 = degToRad(theta1Deg), theta2 = degToRad(theta2Deg);
+      fsol.x = ARM::L1 * cos(theta1) + ARM::L2 * cos(theta1 + theta2);
+      fsol.y = ARM::L1 * sin(theta1) + ARM::L2 * sin(theta1 + theta2);
+   }
+
+   return fsol;
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Solves the inverse kinematics for the robot model and at the precision selected for the current job.  This is 
+// the only place the model setting is looked at; everything below it is specialised at compile time.
+// INPUTS:  The position coordinates x, y, the tranformMatrix and the robot state (robotModel, kinematicsPrecision)
+// RETURN:  the INVERSE_SOLUTION for that model and precision
+INVERSE_SOLUTION solveInverseKinematics(double x, double y, double transformMatrix[3][3], const SCARA_STATE *state)
+{
+   bool bFloat = state->kinematicsPrecision == PRECISION_FLOAT;
+
+   switch(state->robotModel)
+   {
+   case ROBOT_MODEL_SCARA450:
+      return bFloat ? inverseKinematicsT<ARM_SCARA450, float>(x, y, transformMatrix)
+                    : inverseKinematicsT<ARM_SCARA450, double>(x, y, transformMatrix);
+   case ROBOT_MODEL_SCARA800:
+      return bFloat ? inverseKinematicsT<ARM_SCARA800, float>(x, y, transformMatrix)
+                    : inverseKinematicsT<ARM_SCARA800, double>(x, y, transformMatrix);
+   case ROBOT_MODEL_PROFILE:
+      return bFloat ? inverseKinematicsT<ARM_PROFILE, float>(x, y, transformMatrix)
+                    : inverseKinematicsT<ARM_PROFILE, double>(x, y, transformMatrix);
+   default:
+      return bFloat ? inverseKinematicsT<ARM_SCARA600, float>(x, y, transformMatrix)
+                    : inverseKinematicsT<ARM_SCARA600, double>(x, y, transformMatrix);
+   }
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Batch version of solveInverseKinematics: solves a batch of points for the model and precision of the job.
+// INPUTS:  batch: the points, the tranformMatrix and the robot state (robotModel, kinematicsPrecision)
+// RETURN:  none (the solutions are stored in batch)
+void solveInverseKinematicsBatch(IK_BATCH *batch, double transformMatrix[3][3], const SCARA_STATE *state)
+{
+   bool bFloat = state->kinematicsPrecision == PRECISION_FLOAT;
+
+   switch(state->robotModel)
+   {
+   case ROBOT_MODEL_SCARA450:
+      if(bFloat) inverseKinematicsBatchT<ARM_SCARA450, float>(batch, transformMatrix);
+      else inverseKinematicsBatchT<ARM_SCARA450, double>(batch, transformMatrix);
+      break;
+   case ROBOT_MODEL_SCARA800:
+      if(bFloat) inverseKinematicsBatchT<ARM_SCARA800, float>(batch, transformMatrix);
+      else inverseKinematicsBatchT<ARM_SCARA800, double>(batch, transformMatrix);
+      break;
+   case ROBOT_MODEL_PROFILE:
+      if(bFloat) inverseKinematicsBatchT<ARM_PROFILE, float>(batch, transformMatrix);
+      else inverseKinematicsBatchT<ARM_PROFILE, double>(batch, transformMatrix);
+      break;
+   default:
+      if(bFloat) inverseKinematicsBatchT<ARM_SCARA600, float>(batch, transformMatrix);
+      else inverseKinematicsBatchT<ARM_SCARA600, double>(batch, transformMatrix);
+      break;
+   }
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Validation tool for the FLOAT kinematics of one arm geometry.  Sweeps both joints over their full range, and for
+// every reachable point compares the FLOAT inverse solution with the DOUBLE one.  Prints the maximum joint error and 
+// the maximum Cartesian (pen position) error, with the point where each happened.
+// INPUTS:  none
+// RETURN:  none
+template<class ARM>
+void precisionReportT()
+{
+   double identity[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};  // compare untransformed points
+   double theta1Deg, theta2Deg;          // joint angles of the sweep
+   double maxJointErr = 0.0, maxCartErr = 0.0;   // worst errors found (degrees, mm)
+   double xJoint = 0.0, yJoint = 0.0, xCart = 0.0, yCart = 0.0;  // where the worst errors were found
+   double err;                           // error of the current point
+   long nPoints = 0, nMismatch = 0;      // points compared, points where FLOAT and DOUBLE disagree on reachability
+   FORWARD_SOLUTION fsol, fsolD, fsolF;  // swept point, and pen positions from the DOUBLE and FLOAT angles
+   INVERSE_SOLUTION isolD, isolF;        // DOUBLE and FLOAT inverse solutions
+
+   for(theta1Deg = -ARM::MAX_ABS_THETA1_DEG; theta1Deg <= ARM::MAX_ABS_THETA1_DEG;
+      theta1Deg += PRECISION_REPORT_STEP_DEG)
+   {
+      for(theta2Deg = -ARM::MAX_ABS_THETA2_DEG; theta2Deg <= ARM::MAX_ABS_THETA2_DEG;
+         theta2Deg += PRECISION_REPORT_STEP_DEG)
+      {
+         fsol = forwardKinematicsT<ARM>(theta1Deg, theta2Deg);
+         if(!fsol.bHasSolution) continue;
+
+         isolD = inverseKinematicsT<ARM, double>(fsol.x, fsol.y, identity);
+         isolF = inverseKinematicsT<ARM, float>(fsol.x, fsol.y, identity);
+         nPoints++;
+
+         if(isolD.bLeft != isolF.bLeft || isolD.bRight != isolF.bRight) nMismatch++;
+
+         if(isolD.bRight && isolF.bRight)
+         {
+            err = fmax(fabs(isolD.theta1DegRight - isolF.theta1DegRight),
+               fabs(isolD.theta2DegRight - isolF.theta2DegRight));
+            if(err > maxJointErr) { maxJointErr = err; xJoint = fsol.x; yJoint = fsol.y; }
+
+            fsolD = forwardKinematicsT<ARM>(isolD.theta1DegRight, isolD.theta2DegRight);
+            fsolF = forwardKinematicsT<ARM>(isolF.theta1DegRight, isolF.theta2DegRight);
+            err = sqrt(pow(fsolD.x - fsolF.x, 2) + pow(fsolD.y - fsolF.y, 2));
+            if(err > maxCartErr) { maxCartErr = err; xCart = fsol.x; yCart = fsol.y; }
+         }
+         if(isolD.bLeft && isolF.bLeft)
+         {
+            err = fmax(fabs(isolD.theta1DegLeft - isolF.theta1DegLeft),
+               fabs(isolD.theta2DegLeft - isolF.theta2DegLeft));
+            if(err > maxJointErr) { maxJointErr = err; xJoint = fsol.x; yJoint = fsol.y; }
+
+            fsolD = forwardKinematicsT<ARM>(isolD.theta1DegLeft, isolD.theta2DegLeft);
+            fsolF = forwardKinematicsT<ARM>(isolF.theta1DegLeft, isolF.theta2DegLeft);
+            err = sqrt(pow(fsolD.x - fsolF.x, 2) + pow(fsolD.y - fsolF.y, 2));
+            if(err > maxCartErr) { maxCartErr = err; xCart = fsol.x; yCart = fsol.y; }
+         }
+      }
+   }
+
+   fprintf(messageFile(), "FLOAT kinematics vs DOUBLE over %ld workspace points (%.2lf deg joint steps)\n",
+      nPoints, PRECISION_REPORT_STEP_DEG);
+   fprintf(messageFile(), "Max joint error:     %.6lf deg at x: %.2lf y: %.2lf\n", maxJointErr, xJoint, yJoint);
+   fprintf(messageFile(), "Max Cartesian error: %.6lf mm at x: %.2lf y: %.2lf\n", maxCartErr, xCart, yCart);
+   fprintf(messageFile(), "Reachability mismatches: %ld\n", nMismatch);
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Runs the FLOAT vs DOUBLE validation for the robot model of the current job
+// INPUTS:  state: the robot state (robotModel)
+// RETURN:  none
+void precisionReport(const SCARA_STATE *state)
+{
+   fprintf(messageFile(), "Robot model: %s\n", state->robotModel == ROBOT_MODEL_PROFILE ? robotProfile.name :
+      STR_ROBOT_MODELS[state->robotModel]);
+
+   switch(state->robotModel)
+   {
+   case ROBOT_MODEL_SCARA450: precisionReportT<ARM_SCARA450>(); break;
+   case ROBOT_MODEL_SCARA800: precisionReportT<ARM_SCARA800>(); break;
+   case ROBOT_MODEL_PROFILE:  precisionReportT<ARM_PROFILE>(); break;
+   default:                   precisionReportT<ARM_SCARA600>(); break;
+   }
+}
+
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  calculate the x and y coordanates of the points across the arc and draw them.  A first pass checks
+//               which arm can draw every point (nothing is stored), then each point is worked out and sent in turn,
+//               so the memory used doesn't depend on the number of points
+// ARGUMENTS:    structure
+// RETURN VALUE: void since we are working with pointers adn passing info by referencing
+
+void drawArc(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   DRAW_STEPPER stepper;                     // works out and sends the points of the arc one at a time
+   double tsPhase = traceNow();              // start of the current drawing phase in the trace
+
+   initDrawStepper(&stepper, cmd, transformMatrix, state);
+   traceSpan("interpolate + inverseKinematics", "drawArc", tsPhase, -1);
+   tsPhase = traceNow();
+
+   while(drawStep(&stepper, transformMatrix, state));
+   traceSpan("robot.Send", "drawArc", tsPhase, -1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Draws a drawQuadBezier, drawCubicBezier or drawSpline.  The curve is tessellated to the flatness of its resolution
+// (see addCurvePieces) and each point is transformed, solved and sent as it is worked out, like drawArc.
+// INPUTS:  cmd: the parsed curve command, transformMatrix, state: transform and robot state
+// RETURN:  none
+void drawCurve(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   DRAW_STEPPER stepper;                     // works out and sends the points of the curve one at a time
+   double tsPhase = traceNow();              // start of the current drawing phase in the trace
+
+   initDrawStepper(&stepper, cmd, transformMatrix, state);
+   traceSpan("tessellate + inverseKinematics", "drawCurve", tsPhase, -1);
+   tsPhase = traceNow();
+
+   while(drawStep(&stepper, transformMatrix, state));
+   traceSpan("robot.Send", "drawCurve", tsPhase, -1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Opens a point file for drawPoints.  Files ending in STR_POINTS_BINARY_EXTENSION hold pairs of doubles x, y (in the
+// byte order of this machine); any other file is text with one point "x, y" per line (blank and comment lines are
+// skipped).
+// INPUTS:  pf: the point file to set up, fileName: its name
+// RETURN:  true if the file was opened
+bool openPointFile(POINT_FILE *pf, const char *fileName)
+{
+   const char *ext = strrchr(fileName, '.');  // file name extension
+
+   pf->fi = NULL;
+   pf->bBinary = ext != NULL && _stricmp(ext, STR_POINTS_BINARY_EXTENSION) == 0;
+   pf->lineNumber = 0;
+   return fopen_s(&pf->fi, fileName, pf->bBinary ? "rb" : "r") == 0 && pf->fi != NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads the next points of a point file.  Text lines that aren't a valid point are reported (with their line number)
+// and skipped.
+// INPUTS:  pf: the point file, x, y: where to store the points, maxPoints: room in x and y
+// RETURN:  number of points read, 0 at the end of the file
+int readPoints(POINT_FILE *pf, double *x, double *y, int maxPoints)
+{
+   double xy[2 * POINTS_BATCH];           // points of a binary file, as stored
+   char strLine[MAX_COMMAND_LENGTH];      // line of a text file
+   char *p, *pEnd;                        // for strtod
+   int n = 0, i;                          // number of points read, point
+
+   if(pf->bBinary)
+   {
+      if(maxPoints > POINTS_BATCH) maxPoints = POINTS_BATCH;
+      n = (int)fread(xy, 2 * sizeof(double), maxPoints, pf->fi);
+      for(i = 0; i < n; i++)
+      {
+         x[i] = xy[2 * i];
+         y[i] = xy[2 * i + 1];
+      }
+      return n;
+   }
+
+   while(n < maxPoints && fgets(strLine, MAX_COMMAND_LENGTH, pf->fi) != NULL)
+   {
+      pf->lineNumber++;
+      if(isBlankLine(strLine) || isCommentLine(strLine)) continue;
+
+      x[n] = strtod(strLine, &p);
+      if(p != strLine)
+      {
+         p += strspn(p, " \t,;");
+         y[n] = strtod(p, &pEnd);
+         if(pEnd != p && isBlankLine(pEnd))
+         {
+            n++;
+            continue;
+         }
+      }
+      fprintf(messageFile(), "Sorry line %d of the point file is not a point x, y (skipped)\n", pf->lineNumber);
+   }
+   return n;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// qsort comparison for the SERPENTINE point order: rows POINTS_ROW_HEIGHT high from the bottom up, even rows left to
+// right and odd rows right to left, so the pen never travels back across the drawing between rows.
+// INPUTS:  a, b: two points (double[2] x, y)
+// RETURN:  < 0 if a comes first, > 0 if b comes first, 0 if it doesn't matter
+int comparePointsSerpentine(const void *a, const void *b)
+{
+   const double *pa = (const double *)a, *pb = (const double *)b;
+   double rowA = floor(pa[1] / POINTS_ROW_HEIGHT), rowB = floor(pb[1] / POINTS_ROW_HEIGHT);
+
+   if(rowA != rowB) return rowA < rowB ? -1 : 1;
+   if(pa[0] == pb[0]) return 0;
+   return (pa[0] < pb[0]) == (fmod(rowA, 2.0) == 0.0) ? -1 : 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Stipples the points of a point file: one pen dot (move with the pen up, PEN_DOWN, PEN_UP) per point.  The points
+// are read, transformed and solved POINTS_BATCH at a time, so a file of any size needs the same memory, except with
+// the SERPENTINE order which reads the whole file first to sort it.  Each dot keeps the arm of the previous dot if
+// it can, so the arm only flips where it has to.  Points no arm can reach are skipped and counted.
+// INPUTS:  cmd: the drawPoints command (order, file name), transformMatrix, state: transform and robot state
+// RETURN:  none
+void drawPoints(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   POINT_FILE pf;                  // the point file
+   static thread_local IK_BATCH batch;  // points being solved (too big for the stack of the worker threads)
+   double (*points)[2] = NULL;     // every point of the file, SERPENTINE order only
+   int nPoints = 0, capacity = 0;  // number of points and room in points
+   int next = 0;                   // next point of points to solve
+   int nDots = 0, nSkipped = 0;    // points drawn, points no arm reaches
+   int arm, i;                     // arm of the dot, point of the batch
+   double tsPhase = traceNow();    // start of the current phase in the trace
+
+   if(!openPointFile(&pf, cmd->strPath))
+   {
+      fprintf(messageFile(), "Sorry the point file %s could not be open\n", cmd->strPath);
+      nRejectedCommands++;
+      return;
+   }
+
+   if(cmd->args[0].iValue == POINT_ORDER_SERPENTINE)
+   {
+      while((batch.n = readPoints(&pf, batch.x, batch.y, POINTS_BATCH)) > 0)
+      {
+         if(nPoints + batch.n > capacity)  // grow by doubling
+         {
+            int newCapacity = capacity == 0 ? 4 * POINTS_BATCH : 2 * capacity;
+            double (*newPoints)[2] = (double (*)[2])realloc(points, newCapacity * sizeof(points[0]));
+            if(newPoints == NULL)
+            {
+               fprintf(messageFile(), "Sorry there isn't enough memory for the points of %s\n", cmd->strPath);
+               nRejectedCommands++;
+               free(points);
+               fclose(pf.fi);
+               return;
+            }
+            points = newPoints;
+            capacity = newCapacity;
+         }
+         for(i = 0; i < batch.n; i++)
+         {
+            points[nPoints + i][0] = batch.x[i];
+            points[nPoints + i][1] = batch.y[i];
+         }
+         nPoints += batch.n;
+      }
+      if(nPoints > 0) qsort(points, nPoints, sizeof(points[0]), comparePointsSerpentine);
+      traceSpan("read + sort", "drawPoints", tsPhase, -1);
+      tsPhase = traceNow();
+   }
+
+   if(state->penPos == PEN_DOWN)
+   {
+      sendToRobot("PEN_UP\n");
+      state->penPos = PEN_UP;
+   }
+
+   while(true)
+   {
+      if(cmd->args[0].iValue == POINT_ORDER_SERPENTINE)
+      {
+         batch.n = nPoints - next < POINTS_BATCH ? nPoints - next : POINTS_BATCH;
+         for(i = 0; i < batch.n; i++)
+         {
+            batch.x[i] = points[next + i][0];
+            batch.y[i] = points[next + i][1];
+         }
+         next += batch.n;
+      }
+      else batch.n = readPoints(&pf, batch.x, batch.y, POINTS_BATCH);
+      if(batch.n == 0) break;
+
+      solveInverseKinematicsBatch(&batch, transformMatrix, state);
+
+      for(i = 0; i < batch.n; i++)
+      {
+         if(!batch.bLeft[i] && !batch.bRight[i])
+         {
+            nSkipped++;
+            continue;
+         }
+         arm = (state->currentPos.armPos == RIGHT_ARM && batch.bRight[i]) || !batch.bLeft[i] ? RIGHT_ARM : LEFT_ARM;
+         state->currentPos.theta1Deg = arm == RIGHT_ARM ? batch.theta1DegRight[i] : batch.theta1DegLeft[i];
+         state->currentPos.theta2Deg = arm == RIGHT_ARM ? batch.theta2DegRight[i] : batch.theta2DegLeft[i];
+         state->currentPos.x = batch.x[i];
+         state->currentPos.y = batch.y[i];
+         state->currentPos.armPos = arm;
+         sendJointSetpoint(state->currentPos.theta1Deg, state->currentPos.theta2Deg);
+         sendToRobot("PEN_DOWN\n");
+         sendToRobot("PEN_UP\n");
+         nDots++;
+      }
+   }
+   traceSpan("inverseKinematics + robot.Send", "drawPoints", tsPhase, -1);
+
+   free(points);
+   fclose(pf.fi);
+   fprintf(messageFile(), "drawPoints: %d dot(s) drawn from %s", nDots, cmd->strPath);
+   if(nSkipped > 0) fprintf(messageFile(), ", %d point(s) no arm can reach were skipped", nSkipped);
+   fprintf(messageFile(), "\n");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Draws a G-code or SVG file.  The file is read a line (G-code) or a few characters (SVG) at a time and turned into
+// moveTo, drawLine, drawArc and Bezier commands that go through the lookahead queue of the streaming mode, so
+// segments joined end to end are drawn as one path and the memory used doesn't depend on the size of the file.
+// Commands that end out of reach of the robot are skipped and reported.
+// INPUTS:  cmd: the importDrawing command (resolution, file name), transformMatrix, state: transform and robot state
+// RETURN:  none
+void importDrawing(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   IMPORTER imp = {};               // the file being imported
+   const char *ext = strrchr(cmd->strPath, '.');  // file name extension
+   bool bSvg = ext != NULL && _stricmp(ext, STR_SVG_EXTENSION) == 0;  // SVG or G-code
+   double tsPhase = traceNow();     // start of the import in the trace
+
+   if(fopen_s(&imp.fi, cmd->strPath, "r") != 0 || imp.fi == NULL)
+   {
+      fprintf(messageFile(), "Sorry the drawing file %s could not be open\n", cmd->strPath);
+      nRejectedCommands++;
+      return;
+   }
+   imp.fileName = cmd->strPath;
+   imp.lineNumber = 1;
+   imp.resolution = cmd->args[0].iValue;
+   imp.x = imp.xStart = state->currentPos.x;
+   imp.y = imp.yStart = state->currentPos.y;
+
+   if(bSvg) importSvg(&imp, transformMatrix, state);
+   else importGcode(&imp, transformMatrix, state);
+
+   while(lookaheadHeadReady(&imp.queue, state, true)) lookaheadRunHead(&imp.queue, state, transformMatrix);
+   state->pathArm = NO_ARM;
+   fclose(imp.fi);
+   traceSpan(cmd->strPath, "importDrawing", tsPhase, -1);
+
+   fprintf(messageFile(), "importDrawing: %d command(s) drawn from %s", imp.nCommands, cmd->strPath);
+   if(imp.nSkipped > 0) fprintf(messageFile(), ", %d out of reach were skipped", imp.nSkipped);
+   fprintf(messageFile(), "\n");
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Hands one imported drawing command to the lookahead queue, unless it goes out of reach of the robot.  The argument
+// values are followed by the resolution of the import.
+// INPUTS:  imp: the import, index: command index, values: its number arguments, nValues: how many,
+//          transformMatrix, state: transform and robot state
+// RETURN:  none
+void importCommand(IMPORTER *imp, int index, const double *values, int nValues, double transformMatrix[3][3],
+   SCARA_STATE *state)
+{
+   PARSED_COMMAND cmd = {};   // the drawing command
+   int i;                     // argument
+
+   cmd.index = index;
+   cmd.lineNumber = imp->lineNumber;
+   cmd.nArgs = nValues + 1;
+   for(i = 0; i < nValues; i++) cmd.args[i].dValue = values[i];
+   cmd.args[nValues].iValue = imp->resolution;
+
+   if(!isCommandInReach(&cmd, transformMatrix, state))
+   {
+      fprintf(messageFile(), "Sorry line %d of %s goes out of reach of the robot (skipped)\n", imp->lineNumber,
+         imp->fileName);
+      imp->nSkipped++;
+      return;
+   }
+
+   if(imp->queue.count == LOOKAHEAD_DEPTH) lookaheadRunHead(&imp->queue, state, transformMatrix);
+   lookaheadPush(&imp->queue, &cmd);
+   while(lookaheadHeadReady(&imp->queue, state, false)) lookaheadRunHead(&imp->queue, state, transformMatrix);
+   imp->nCommands++;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Imports a line or circular arc from the current point to (x, y).  The arc is given by its centre offset from the
+// current point (G-code I, J) if bCentre is true, otherwise by its radius r (G-code R or an SVG arc) with bLargeArc
+// choosing the longer of the two possible arcs.  bPositive is the direction (counter clockwise for G3 or an SVG
+// sweep flag of 1).  The current point moves to (x, y).
+// INPUTS:  imp: the import, x, y: end point, bCentre, i, j, r, bLargeArc: the circle, bPositive: the direction,
+//          transformMatrix, state: transform and robot state
+// RETURN:  none
+void importArc(IMPORTER *imp, double x, double y, bool bCentre, double i, double j, double r, bool bLargeArc,
+   bool bPositive, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   double xc, yc;               // centre
+   double dx, dy, d2, k;        // half chord, its square length, distance of the centre from the chord's middle
+   double thetaStart, thetaEnd; // angles of the ends (radians)
+   double values[5];            // arguments of drawArc
+
+   if(bCentre)
+   {
+      xc = imp->x + i;
+      yc = imp->y + j;
+      r = hypot(imp->x - xc, imp->y - yc);
+   }
+   else
+   {
+      dx = (imp->x - x) / 2.0;
+      dy = (imp->y - y) / 2.0;
+      d2 = dx * dx + dy * dy;
+      r = fabs(r);
+      if(d2 == 0.0 || r == 0.0)  // nothing to draw, or a line
+      {
+         if(d2 > 0.0) importLine(imp, x, y, transformMatrix, state);
+         return;
+      }
+      if(r * r < d2) r = sqrt(d2);  // too small to reach the end: the smallest circle that does
+      k = sqrt((r * r - d2) / d2) * (bLargeArc == bPositive ? -1.0 : 1.0);
+      xc = (imp->x + x) / 2.0 + k * dy;
+      yc = (imp->y + y) / 2.0 - k * dx;
+   }
+   if(r == 0.0) return;
+
+   thetaStart = atan2(imp->y - yc, imp->x - xc);
+   thetaEnd = atan2(y - yc, x - xc);
+   if(bPositive && thetaEnd <= thetaStart) thetaEnd += 2.0 * PI;    // also a full circle when the ends meet
+   if(!bPositive && thetaEnd >= thetaStart) thetaEnd -= 2.0 * PI;
+
+   values[0] = xc;
+   values[1] = yc;
+   values[2] = r;
+   values[3] = radToDeg(thetaStart);
+   values[4] = radToDeg(thetaEnd);
+   importCommand(imp, INDEX_DRAW_ARC, values, 5, transformMatrix, state);
+   imp->x = x;
+   imp->y = y;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Imports a straight line from the current point to (x, y) (nothing if they are the same).  The current point moves
+// to (x, y).
+// INPUTS:  imp: the import, x, y: end point, transformMatrix, state: transform and robot state
+// RETURN:  none
+void importLine(IMPORTER *imp, double x, double y, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   double values[4] = {imp->x, imp->y, x, y};   // arguments of drawLine
+
+   if(x != imp->x || y != imp->y) importCommand(imp, INDEX_DRAW_LINE, values, 4, transformMatrix, state);
+   imp->x = x;
+   imp->y = y;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Imports a G-code file a line at a time.  G0 moves with the pen up, G1 draws a line and G2/G3 draw clockwise/counter
+// clockwise arcs (centre I, J or radius R).  G20/G21 (inches/mm) and G90/G91 (absolute/relative) are followed; other
+// words (Z, F, M, ...) and comments in ( ) or after ; are ignored.
+// INPUTS:  imp: the import, transformMatrix, state: transform and robot state
+// RETURN:  none
+void importGcode(IMPORTER *imp, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   char strLine[MAX_COMMAND_LENGTH];   // line of the file
+   char *p, *pEnd;                     // for reading the words of the line
+   int motion = 0;                     // G0, G1, G2 or G3 (modal)
+   double scale = 1.0;                 // mm per unit of the file
+   bool bRelative = false;             // G91
+   double x, y, i, j, r, value;        // values of the line
+   bool bX, bY, bIJ, bR, bBad;         // words found on the line
+   int c;                              // letter of a word, or character
+
+   for(; fgets(strLine, MAX_COMMAND_LENGTH, imp->fi) != NULL; imp->lineNumber++)
+   {
+      if(strchr(strLine, '\n') == NULL && !feof(imp->fi))
+      {
+         fprintf(messageFile(), "Sorry line %d of %s is too long (skipped)\n", imp->lineNumber, imp->fileName);
+         while((c = fgetc(imp->fi)) != EOF && c != '\n');
+         continue;
+      }
+
+      // comments
+      if((p = strchr(strLine, ';')) != NULL) *p = '\0';
+      while((p = strchr(strLine, '(')) != NULL)
+      {
+         pEnd = strchr(p, ')');
+         if(pEnd == NULL) *p = '\0';
+         else memmove(p, pEnd + 1, strlen(pEnd + 1) + 1);
+      }
+
+      bX = bY = bIJ = bR = bBad = false;
+      x = y = i = j = r = 0.0;
+      for(p = strLine; *p != '\0' && !bBad; p = pEnd)
+      {
+         if(isspace((unsigned char)*p))
+         {
+            pEnd = p + 1;
+            continue;
+         }
+         c = toupper((unsigned char)*p);
+         value = strtod(p + 1, &pEnd);
+         if(!isalpha(c) || pEnd == p + 1)
+         {
+            bBad = true;
+            break;
+         }
+         switch(c)
+         {
+         case 'G':
+            if(value == 0.0 || value == 1.0 || value == 2.0 || value == 3.0) motion = (int)value;
+            else if(value == 20.0) scale = MM_PER_INCH;
+            else if(value == 21.0) scale = 1.0;
+            else if(value == 90.0) bRelative = false;
+            else if(value == 91.0) bRelative = true;
+            break;
+         case 'X': x = value; bX = true; break;
+         case 'Y': y = value; bY = true; break;
+         case 'I': i = value; bIJ = true; break;
+         case 'J': j = value; bIJ = true; break;
+         case 'R': r = value; bR = true; break;
+         }
+      }
+      if(bBad)
+      {
+         fprintf(messageFile(), "Sorry line %d of %s is not valid G-code (skipped)\n", imp->lineNumber, imp->fileName);
+         continue;
+      }
+      if(!bX && !bY && !(motion >= 2 && bIJ)) continue;  // no move on this line
+
+      // the X and Y read are in file units (relative ones are offsets): work out the end point in mm
+      x = bX ? x * scale + (bRelative ? imp->x : 0.0) : imp->x;
+      y = bY ? y * scale + (bRelative ? imp->y : 0.0) : imp->y;
+
+      if(motion == 0)
+      {
+         imp->x = x;
+         imp->y = y;
+      }
+      else if(motion == 1) importLine(imp, x, y, transformMatrix, state);
+      else if(bR && !bIJ)  // G2/G3 R: a negative radius is the longer arc
+         importArc(imp, x, y, false, 0.0, 0.0, r * scale, r < 0.0, motion == 3, transformMatrix, state);
+      else importArc(imp, x, y, true, i * scale, j * scale, 0.0, false, motion == 3, transformMatrix, state);
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads a character of an imported file, counting the lines.
+// INPUTS:  imp: the import
+// RETURN:  the character, or EOF
+int importGetc(IMPORTER *imp)
+{
+   int c = fgetc(imp->fi);
+
+   if(c == '\n') imp->lineNumber++;
+   return c;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Puts back the last character read by importGetc.
+// INPUTS:  imp: the import, c: the character
+// RETURN:  none
+void importUngetc(IMPORTER *imp, int c)
+{
+   if(c == EOF) return;
+   if(c == '\n') imp->lineNumber--;
+   ungetc(c, imp->fi);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads an SVG file up to the path data of the next <path> element (the value of its d attribute).
+// INPUTS:  imp: the import, pQuote: where to store the quote character that ends the path data
+// RETURN:  true if path data was found, false at the end of the file
+bool svgFindPathData(IMPORTER *imp, int *pQuote)
+{
+   char strName[8];   // start of an element or attribute name
+   size_t n;          // characters of the name
+   int c;             // character read
+
+   while((c = importGetc(imp)) != EOF)
+   {
+      if(c != '<') continue;
+
+      // element name: only <path> is drawn
+      for(n = 0; (c = importGetc(imp)) != EOF && isalnum(c); n++)
+      {
+         if(n < sizeof(strName) - 1) strName[n] = (char)c;
+      }
+      strName[n < sizeof(strName) - 1 ? n : sizeof(strName) - 1] = '\0';
+      importUngetc(imp, c);
+      if(_stricmp(strName, "path") != 0 || n != 4) continue;
+
+      // attributes, up to the end of the tag
+      while(true)
+      {
+         while((c = importGetc(imp)) != EOF && isspace(c));
+         if(c == EOF || c == '>') break;
+         if(c == '/') continue;
+         for(n = 0; c != EOF && c != '=' && c != '>' && !isspace(c); n++, c = importGetc(imp))
+         {
+            if(n < sizeof(strName) - 1) strName[n] = (char)c;
+         }
+         strName[n < sizeof(strName) - 1 ? n : sizeof(strName) - 1] = '\0';
+         while(c != EOF && isspace(c)) c = importGetc(imp);
+         if(c != '=')  // attribute without a value
+         {
+            importUngetc(imp, c);
+            continue;
+         }
+         while((c = importGetc(imp)) != EOF && isspace(c));
+         if(c != '"' && c != '\'') break;  // not valid XML, look for the next element
+         if(strcmp(strName, "d") == 0 && n == 1)
+         {
+            *pQuote = c;
+            return true;
+         }
+         *pQuote = c;
+         while((c = importGetc(imp)) != EOF && c != *pQuote);  // skip the value
+      }
+   }
+   return false;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads the next item of SVG path data: a command letter or a number (commas and blanks between items are skipped).
+// INPUTS:  imp: the import, quote: the character that ends the path data, pValue: where to store a number
+// RETURN:  the command letter, 0 for a number, or EOF at the end of the path data (or if it isn't valid)
+int svgReadItem(IMPORTER *imp, int quote, double *pValue)
+{
+   char strNumber[MAX_NUMBER_LENGTH];   // characters of a number
+   size_t n = 0;                        // characters in strNumber
+   bool bDot = false, bExponent = false;   // number has a decimal point, an exponent
+   int c;                               // character read
+
+   while((c = importGetc(imp)) != EOF && (isspace(c) || c == ','));
+   if(c == EOF || c == quote) return EOF;
+   if(isalpha(c) && c != 'e' && c != 'E') return c;
+
+   // number: sign, digits, one decimal point, exponent.  "1.5.5" is 1.5 then .5 and "1-2" is 1 then -2
+   while(c != EOF && n < MAX_NUMBER_LENGTH - 1)
+   {
+      if(isdigit(c)) ;
+      else if((c == '-' || c == '+') && (n == 0 || strNumber[n - 1] == 'e' || strNumber[n - 1] == 'E')) ;
+      else if(c == '.' && !bDot && !bExponent) bDot = true;
+      else if((c == 'e' || c == 'E') && !bExponent && n > 0) bExponent = true;
+      else break;
+      strNumber[n++] = (char)c;
+      c = importGetc(imp);
+   }
+   importUngetc(imp, c);
+   strNumber[n] = '\0';
+   if(n == 0)
+   {
+      importGetc(imp);  // not part of any item: drop it so the next call moves on
+      return EOF;
+   }
+   *pValue = strtod(strNumber, NULL);
+   return 0;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Imports the path data of every <path> element of an SVG file: M, L, H, V, C, S, Q, T, A and Z, absolute (upper case)
+// or relative (lower case).  Curves become drawCubicBezier/drawQuadBezier and circular arcs drawArc; an elliptical
+// arc is drawn as a line to its end.  Other elements and the transform attribute are ignored (use the transform
+// commands instead).
+// INPUTS:  imp: the import, quote: the character that ends the path data, transformMatrix, state: transform and
+//          robot state
+// RETURN:  none
+void svgImportPath(IMPORTER *imp, int quote, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   double values[8];               // numbers of the command (absolute), then drawing command arguments
+   double xCtrl = 0, yCtrl = 0;    // last control point of the previous curve (for S and T)
+   double value;                   // number read
+   int item, command = 0;          // item read, current command letter
+   int lastCommand = 0;            // previous command (upper case)
+   int nNeeded = 0, n = 0;         // numbers the command takes, numbers read
+   int k, upper;                   // number, upper case command
+   bool bEllipseReported = false;  // elliptical arcs are reported once per path
+
+   imp->x = imp->y = imp->xStart = imp->yStart = 0.0;  // every path starts at the origin
+   while((item = svgReadItem(imp, quote, &value)) != EOF)
+   {
+      if(item != 0)  // new command
+      {
+         command = item;
+         upper = toupper(command);
+         nNeeded = upper == 'M' || upper == 'L' || upper == 'T' ? 2 : upper == 'H' || upper == 'V' ? 1 :
+            upper == 'C' ? 6 : upper == 'S' || upper == 'Q' ? 4 : upper == 'A' ? 7 : 0;
+         n = 0;
+         if(upper == 'Z')
+         {
+            importLine(imp, imp->xStart, imp->yStart, transformMatrix, state);
+            lastCommand = 'Z';
+         }
+         else if(nNeeded == 0)
+         {
+            fprintf(messageFile(), "Sorry line %d of %s has an unknown path command %c (rest of the path skipped)\n",
+               imp->lineNumber, imp->fileName, command);
+            while((item = importGetc(imp)) != EOF && item != quote);
+            return;
+         }
+         continue;
+      }
+      if(nNeeded == 0) continue;  // number without a command
+
+      // relative coordinates: x values are offsets from the current x, y values from the current y
+      upper = toupper(command);
+      if(command != upper)
+      {
+         if(upper == 'H') value += imp->x;
+         else if(upper == 'V') value += imp->y;
+         else if(upper == 'A') value += n == 5 ? imp->x : n == 6 ? imp->y : 0.0;
+         else value += n % 2 == 0 ? imp->x : imp->y;
+      }
+      values[n++] = value;
+      if(n < nNeeded) continue;
+      n = 0;  // the command repeats with the next numbers
+
+      switch(upper)
+      {
+      case 'M':
+         imp->x = imp->xStart = values[0];
+         imp->y = imp->yStart = values[1];
+         command = command == 'M' ? 'L' : 'l';  // more pairs after a move are lines
+         break;
+      case 'L': importLine(imp, values[0], values[1], transformMatrix, state); break;
+      case 'H': importLine(imp, values[0], imp->y, transformMatrix, state); break;
+      case 'V': importLine(imp, imp->x, values[0], transformMatrix, state); break;
+      case 'C':
+      case 'S':
+         if(upper == 'S')  // first control point: the previous one reflected, or the current point
+         {
+            for(k = 5; k >= 2; k--) values[k] = values[k - 2];
+            values[0] = lastCommand == 'C' || lastCommand == 'S' ? 2.0 * imp->x - xCtrl : imp->x;
+            values[1] = lastCommand == 'C' || lastCommand == 'S' ? 2.0 * imp->y - yCtrl : imp->y;
+         }
+         xCtrl = values[2];
+         yCtrl = values[3];
+         for(k = 7; k >= 2; k--) values[k] = values[k - 2];
+         values[0] = imp->x;
+         values[1] = imp->y;
+         importCommand(imp, INDEX_DRAW_CUBIC_BEZIER, values, 8, transformMatrix, state);
+         imp->x = values[6];
+         imp->y = values[7];
+         break;
+      case 'Q':
+      case 'T':
+         if(upper == 'T')  // control point: the previous one reflected, or the current point
+         {
+            values[2] = values[0];
+            values[3] = values[1];
+            values[0] = lastCommand == 'Q' || lastCommand == 'T' ? 2.0 * imp->x - xCtrl : imp->x;
+            values[1] = lastCommand == 'Q' || lastCommand == 'T' ? 2.0 * imp->y - yCtrl : imp->y;
+         }
+         xCtrl = values[0];
+         yCtrl = values[1];
+         for(k = 5; k >= 2; k--) values[k] = values[k - 2];
+         values[0] = imp->x;
+         values[1] = imp->y;
+         importCommand(imp, INDEX_DRAW_QUAD_BEZIER, values, 6, transformMatrix, state);
+         imp->x = values[4];
+         imp->y = values[5];
+         break;
+      case 'A':  // rx ry rotation large-arc-flag sweep-flag x y
+         if(values[0] != 0.0 && fabs(fabs(values[0]) - fabs(values[1])) <= 1e-9 * fabs(values[0]))
+         {
+            importArc(imp, values[5], values[6], false, 0.0, 0.0, values[0], values[3] != 0.0, values[4] != 0.0,
+               transformMatrix, state);
+         }
+         else
+         {
+            if(!bEllipseReported && values[0] != 0.0 && values[1] != 0.0)
+            {
+               fprintf(messageFile(), "Sorry line %d of %s has an elliptical arc (drawn as a line)\n", imp->lineNumber,
+                  imp->fileName);
+               bEllipseReported = true;
+            }
+            importLine(imp, values[5], values[6], transformMatrix, state);
+         }
+         break;
+      }
+      lastCommand = upper;
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Imports an SVG file one <path> element at a time.
+// INPUTS:  imp: the import, transformMatrix, state: transform and robot state
+// RETURN:  none
+void importSvg(IMPORTER *imp, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   int quote;   // character that ends the path data
+
+   while(svgFindPathData(imp, &quote))
+   {
+      svgImportPath(imp, quote, transformMatrix, state);
+   }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Works out where to put a job so the robot can draw all of it, and loads that placement into the transform matrix
+// (the job's own transform commands still apply on top of it when the job is run).  Every point the job draws is
+// collected in one pass over its command file, then candidate poses (the job's centre at AUTOFIT_RADIUS_STEPS
+// distances and every AUTOFIT_ANGLE_STEP_DEG around the shoulder, turned every AUTOFIT_ROTATION_STEP_DEG) are
+// checked on several threads.  A pose fits if every point is AUTOFIT_REACH_MARGIN inside LMIN/LMAX and one arm can
+// reach all of them within its joint limits; the fitting pose that keeps furthest inside the reach wins.  With SCALE
+// the job is shrunk AUTOFIT_SCALE_STEP at a time until a pose fits.  The poses are laid out for jobs without
+// transform commands of their own; with them a pose is still only loaded if it fits.
+// INPUTS:  cmd: the autoFit command (FIXED / SCALE, job file), transformMatrix, state: transform and robot state
+// RETURN:  none
+void autoFit(const PARSED_COMMAND *cmd, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   FIT_JOB job = {};                               // points of the job
+   FIT_POSE best[AUTOFIT_MAX_THREADS];             // best pose found by each thread
+   std::thread workers[AUTOFIT_MAX_THREADS];       // threads checking the poses
+   int nThreads = (int)std::thread::hardware_concurrency();  // number of threads
+   double scale, minScale;                         // scale being tried, smallest one
+   int bestThread = -1, t;                         // thread that found the best pose, thread
+   double tsPhase = traceNow();                    // start of the current phase in the trace
+
+   if(nThreads < 1) nThreads = 1;
+   if(nThreads > AUTOFIT_MAX_THREADS) nThreads = AUTOFIT_MAX_THREADS;
+
+   if(!readFitJob(cmd->strPath, &job))
+   {
+      nRejectedCommands++;
+      free(job.points);
+      free(job.segments);
+      return;
+   }
+   traceSpan("read job", "autoFit", tsPhase, -1);
+   tsPhase = traceNow();
+   if(job.nPoints == 0)
+   {
+      fprintf(messageFile(), "Sorry %s doesn't draw anything to place\n", cmd->strPath);
+      nRejectedCommands++;
+      free(job.points);
+      free(job.segments);
+      return;
+   }
+
+   minScale = cmd->args[0].iValue == AUTOFIT_SCALE ? AUTOFIT_SCALE_STEP : 1.0;
+   for(scale = 1.0; bestThread < 0 && scale >= minScale - 1e-9; scale -= AUTOFIT_SCALE_STEP)
+   {
+      for(t = 0; t < nThreads; t++)
+      {
+         workers[t] = std::thread(autoFitWorker, &job, state, scale, t, nThreads, &best[t]);
+      }
+      for(t = 0; t < nThreads; t++)
+      {
+         workers[t].join();
+         if(best[t].margin >= 0.0 && (bestThread < 0 || best[t].margin > best[bestThread].margin ||
+            (best[t].margin == best[bestThread].margin && best[t].candidate < best[bestThread].candidate)))
+            bestThread = t;
+      }
+   }
+   traceSpan("check poses", "autoFit", tsPhase, -1);
+
+   if(bestThread < 0)
+   {
+      fprintf(messageFile(), "Sorry no placement of %s fits in reach of the robot%s\n", cmd->strPath,
+         cmd->args[0].iValue == AUTOFIT_SCALE ? "" : " (try autoFit SCALE)");
+      nRejectedCommands++;
+   }
+   else
+   {
+      getFitTransform(&job, &best[bestThread], transformMatrix);
+      fprintf(messageFile(), "autoFit: %s is scaled by %.2f, rotated %.0f deg and centred on (%.1f, %.1f), %.1f mm "
+         "inside the reach, %s arm (%d point(s), %d thread(s))\n", cmd->strPath, best[bestThread].scale,
+         best[bestThread].rotationDeg, best[bestThread].x, best[bestThread].y, best[bestThread].margin,
+         best[bestThread].arm == LEFT_ARM ? "LEFT" : "RIGHT", job.nPoints, nThreads);
+   }
+   free(job.points);
+   free(job.segments);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads a job's command file and collects every point it draws (moveTo, lines, arcs, curves and the sides of
+// rectangles and triangles), with the job's own transform commands.  Points are kept once per AUTOFIT_GRID_MM cell
+// and sorted furthest from the centre of the job first.  drawPoints and importDrawing files are not read.
+// INPUTS:  fileName: the job's command file, job: where to store the points (its arrays must be freed)
+// RETURN:  false if the file could not be read or there wasn't enough memory
+bool readFitJob(const char *fileName, FIT_JOB *job)
+{
+   FILE *fi = NULL;                            // the job file
+   char strCommand[MAX_COMMAND_LENGTH];        // line of the file
+   char strErrorMsg[MAX_MESSAGE_LENGTH] = {};  // error message of parseCommand
+   PARSED_COMMAND cmd;                         // the parsed command
+   PARSED_COMMAND side = {};                   // side of a shape
+   SHAPE_POINTS shape;                         // points of a drawing command
+   SCARA_STATE unused = {};                    // executeCommand needs a state for the transform commands
+   double TM[3][3];                            // the job's own transform
+   double corners[4][2];                       // corners of a rectangle or triangle
+   double x, y, xMin = DBL_MAX, xMax = -DBL_MAX, yMin = DBL_MAX, yMax = -DBL_MAX;  // point, bounding box
+   bool bPlaced = true;                        // false after the job resets its transform
+   int lineNumber = 0, nCorners, i, k;         // line of the file, corners, point, side
+
+   if(fopen_s(&fi, fileName, "r") != 0 || fi == NULL)
+   {
+      fprintf(messageFile(), "Sorry the job file %s could not be open\n", fileName);
+      return false;
+   }
+   side.index = INDEX_DRAW_LINE;
+   side.nArgs = SCARA_COMMANDS[INDEX_DRAW_LINE].nArgs;
+   resetTransformMatrix(TM);
+   if(!addFitSegment(job, TM, bPlaced))
+   {
+      fclose(fi);
+      return false;
+   }
+
+   while(fgets(strCommand, MAX_COMMAND_LENGTH, fi) != NULL)
+   {
+      lineNumber++;
+      if(isBlankLine(strCommand) || isCommentLine(strCommand)) continue;
+      if(parseCommand(strCommand, &cmd, strErrorMsg, lineNumber) == -1) continue;  // reported when the job runs
+
+      switch(cmd.index)
+      {
+      case INDEX_RESET_TRANSFORMATION_MATRIX:
+         bPlaced = false;
+         // fall through
+      case INDEX_ADD_ROTATION:
+      case INDEX_ADD_TRANSLATION:
+      case INDEX_ADD_SCALING:
+         executeCommand(&cmd, &unused, TM);
+         if(!addFitSegment(job, TM, bPlaced))
+         {
+            fclose(fi);
+            return false;
+         }
+         continue;
+
+      case INDEX_DRAW_POINTS:
+      case INDEX_IMPORT_DRAWING:
+         fprintf(messageFile(), "autoFit: line %d of %s (%s) is not checked\n", lineNumber, fileName,
+            SCARA_COMMANDS[cmd.index].cmdName);
+         continue;
+      }
+
+      nCorners = getShapeCorners(&cmd, corners);
+      for(k = 0; k < (nCorners > 0 ? nCorners : 1); k++)
+      {
+         if(nCorners > 0)
+         {
+            side.args[0].dValue = corners[k][0];
+            side.args[1].dValue = corners[k][1];
+            side.args[2].dValue = corners[(k + 1) % nCorners][0];
+            side.args[3].dValue = corners[(k + 1) % nCorners][1];
+            side.args[4] = cmd.args[cmd.nArgs - 1];  // resolution
+            initShapePoints(&shape, &side);
+         }
+         else if(isPathCommand(cmd.index)) initShapePoints(&shape, &cmd);
+         else break;
+
+         for(i = 0; i < shape.nPoints; i++)
+         {
+            getShapePoint(&shape, i, &x, &y);
+            if(!addFitPoint(job, x, y))
+            {
+               fprintf(messageFile(), "Sorry there isn't enough memory for the points of %s\n", fileName);
+               fclose(fi);
+               return false;
+            }
+         }
+      }
+   }
+   fclose(fi);
+
+   // one point per cell, then the centre of the placed points and the order they are checked in
+   packFitPoints(job);
+   for(i = 0; i < job->nPoints; i++)
+   {
+      if(!job->segments[job->points[i].segment].bPlaced) continue;
+      if(job->points[i].x < xMin) xMin = job->points[i].x;
+      if(job->points[i].x > xMax) xMax = job->points[i].x;
+      if(job->points[i].y < yMin) yMin = job->points[i].y;
+      if(job->points[i].y > yMax) yMax = job->points[i].y;
+   }
+   job->xc = xMin <= xMax ? (xMin + xMax) / 2.0 : 0.0;
+   job->yc = yMin <= yMax ? (yMin + yMax) / 2.0 : 0.0;
+   for(i = 0; i < job->nPoints; i++)
+   {
+      job->points[i].d = hypot(job->points[i].x - job->xc, job->points[i].y - job->yc);
+   }
+   qsort(job->points, job->nPoints, sizeof(FIT_POINT), compareFitPointDistance);
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Starts a new part of a job being placed by autoFit (its transform commands changed).
+// INPUTS:  job: the job, TM: the job's own transform from now on, bPlaced: false if the placement no longer applies
+// RETURN:  false if there wasn't enough memory
+bool addFitSegment(FIT_JOB *job, double TM[3][3], bool bPlaced)
+{
+   FIT_SEGMENT *segments;   // grown array
+
+   if(job->nSegments == job->segmentCapacity)
+   {
+      segments = (FIT_SEGMENT *)realloc(job->segments, (job->segmentCapacity * 2 + 8) * sizeof(FIT_SEGMENT));
+      if(segments == NULL) return false;
+      job->segments = segments;
+      job->segmentCapacity = job->segmentCapacity * 2 + 8;
+   }
+   memcpy(job->segments[job->nSegments].TM, TM, sizeof(job->segments[0].TM));
+   job->segments[job->nSegments].bPlaced = bPlaced;
+   job->nSegments++;
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds a point to the last part of a job being placed by autoFit.  When the points fill their array they are packed
+// (see packFitPoints) before it is made bigger, so the memory used grows with the area the job covers, not with the
+// number of points it draws.
+// INPUTS:  job: the job, x, y: the point
+// RETURN:  false if there wasn't enough memory
+bool addFitPoint(FIT_JOB *job, double x, double y)
+{
+   FIT_POINT *points;   // grown array
+   int capacity;        // size of the grown array
+
+   if(job->nPoints == job->pointCapacity)
+   {
+      packFitPoints(job);
+      if(job->nPoints > job->pointCapacity / 2 || job->pointCapacity == 0)
+      {
+         capacity = job->pointCapacity == 0 ? 4096 : job->pointCapacity * 2;
+         points = (FIT_POINT *)realloc(job->points, capacity * sizeof(FIT_POINT));
+         if(points == NULL) return false;
+         job->points = points;
+         job->pointCapacity = capacity;
+      }
+   }
+   job->points[job->nPoints].x = x;
+   job->points[job->nPoints].y = y;
+   job->points[job->nPoints].d = 0.0;
+   job->points[job->nPoints].segment = job->nSegments - 1;
+   job->nPoints++;
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Keeps one point of a job per AUTOFIT_GRID_MM cell (and part of the job).
+// INPUTS:  job: the job
+// RETURN:  none
+void packFitPoints(FIT_JOB *job)
+{
+   int i, n = 0;   // point, points kept
+
+   if(job->nPoints == 0) return;
+   qsort(job->points, job->nPoints, sizeof(FIT_POINT), compareFitPointCells);
+   for(i = 1; i < job->nPoints; i++)
+   {
+      if(compareFitPointCells(&job->points[i], &job->points[n]) != 0) job->points[++n] = job->points[i];
+   }
+   job->nPoints = n + 1;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// qsort comparison of job points by part of the job, then AUTOFIT_GRID_MM cell.
+// INPUTS:  a, b: two FIT_POINT
+// RETURN:  < 0 if a comes first, > 0 if b comes first, 0 if they are in the same cell
+int compareFitPointCells(const void *a, const void *b)
+{
+   const FIT_POINT *pa = (const FIT_POINT *)a, *pb = (const FIT_POINT *)b;
+   double cxA = floor(pa->x / AUTOFIT_GRID_MM), cxB = floor(pb->x / AUTOFIT_GRID_MM);
+   double cyA = floor(pa->y / AUTOFIT_GRID_MM), cyB = floor(pb->y / AUTOFIT_GRID_MM);
+
+   if(pa->segment != pb->segment) return pa->segment < pb->segment ? -1 : 1;
+   if(cxA != cxB) return cxA < cxB ? -1 : 1;
+   if(cyA != cyB) return cyA < cyB ? -1 : 1;
+   return 0;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// qsort comparison of job points, furthest from the centre of the job first (they are the likeliest to be out of
+// reach, so a pose that doesn't fit is found out quickly).
+// INPUTS:  a, b: two FIT_POINT
+// RETURN:  < 0 if a comes first, > 0 if b comes first, 0 if it doesn't matter
+int compareFitPointDistance(const void *a, const void *b)
+{
+   const FIT_POINT *pa = (const FIT_POINT *)a, *pb = (const FIT_POINT *)b;
+
+   if(pa->d == pb->d) return 0;
+   return pa->d > pb->d ? -1 : 1;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Works out the transform matrix of a placement: scale and rotate about the centre of the job, then move the centre.
+// INPUTS:  job: the job, pose: the placement, TM: where to store the transform
+// RETURN:  none
+void getFitTransform(const FIT_JOB *job, const FIT_POSE *pose, double TM[3][3])
+{
+   double c = cos(degToRad(pose->rotationDeg)) * pose->scale;   // scaled rotation
+   double s = sin(degToRad(pose->rotationDeg)) * pose->scale;
+
+   TM[0][0] = c;    TM[0][1] = -s;   TM[0][2] = pose->x - c * job->xc + s * job->yc;
+   TM[1][0] = s;    TM[1][1] = c;    TM[1][2] = pose->y - s * job->xc - c * job->yc;
+   TM[2][0] = 0.0;  TM[2][1] = 0.0;  TM[2][2] = 1.0;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks if a job fits the robot with a placement.  First every point is checked against LMIN/LMAX (cheap), then
+// one arm must reach every point within its joint limits.
+// INPUTS:  job: the job, state: robot state (model and precision), pose: the placement, where the margin and arm are
+//          stored
+// RETURN:  true if it fits
+bool checkFitPose(const FIT_JOB *job, const SCARA_STATE *state, FIT_POSE *pose)
+{
+   double F[3][3], identity[3][3];        // the placement, no transform
+   double lMin, lMax;                     // reach of the robot
+   double x, y, xp, yp, d;                // point placed, after the job's own transform, its distance
+   bool bLeft = true, bRight = true;      // arms that reach every point
+   INVERSE_SOLUTION isol;                 // joint angles of a point
+   const FIT_POINT *p;                    // point of the job
+   const FIT_SEGMENT *seg;                // its part of the job
+   int i, pass;                           // point, reach check or joint check
+
+   getReach(state->robotModel, &lMin, &lMax);
+   getFitTransform(job, pose, F);
+   resetTransformMatrix(identity);
+   pose->margin = lMax;
+
+   for(pass = 0; pass < 2; pass++)
+   {
+      for(i = 0; i < job->nPoints; i++)
+      {
+         p = &job->points[i];
+         seg = &job->segments[p->segment];
+         xp = seg->bPlaced ? F[0][0] * p->x + F[0][1] * p->y + F[0][2] : p->x;
+         yp = seg->bPlaced ? F[1][0] * p->x + F[1][1] * p->y + F[1][2] : p->y;
+         x = seg->TM[0][0] * xp + seg->TM[0][1] * yp + seg->TM[0][2];
+         y = seg->TM[1][0] * xp + seg->TM[1][1] * yp + seg->TM[1][2];
+
+         if(pass == 0)
+         {
+            d = hypot(x, y);
+            if(d - lMin < pose->margin) pose->margin = d - lMin;
+            if(lMax - d < pose->margin) pose->margin = lMax - d;
+            if(pose->margin < AUTOFIT_REACH_MARGIN) return false;
+         }
+         else
+         {
+            isol = solveInverseKinematics(x, y, identity, state);
+            bLeft = bLeft && isol.bLeft;
+            bRight = bRight && isol.bRight;
+            if(!bLeft && !bRight) return false;
+         }
+      }
+   }
+   pose->arm = bLeft ? LEFT_ARM : RIGHT_ARM;
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Thread of autoFit: checks every step-th candidate pose at one scale, starting with candidate first.
+// INPUTS:  job: the job, state: robot state, scale: scale of the poses, first, step: candidates to check,
+//          best: where to store the best pose that fits (margin -1 if none does)
+// RETURN:  none
+void autoFitWorker(const FIT_JOB *job, const SCARA_STATE *state, double scale, int first, int step, FIT_POSE *best)
+{
+   const int nAngles = (int)(360.0 / AUTOFIT_ANGLE_STEP_DEG + 0.5);        // directions around the shoulder
+   const int nRotations = (int)(360.0 / AUTOFIT_ROTATION_STEP_DEG + 0.5);  // rotations of the job
+   const int nCandidates = (AUTOFIT_RADIUS_STEPS + 1) * nAngles * nRotations;
+   double lMin, lMax, radius, angle;   // reach of the robot, where the centre of the job goes
+   FIT_POSE pose;                      // candidate pose
+   int k;                              // candidate
+
+   getReach(state->robotModel, &lMin, &lMax);
+   best->margin = -1.0;
+   for(k = first; k < nCandidates; k += step)
+   {
+      radius = lMax * (k / (nAngles * nRotations)) / AUTOFIT_RADIUS_STEPS;
+      angle = degToRad(AUTOFIT_ANGLE_STEP_DEG * ((k / nRotations) % nAngles));
+      if(radius == 0.0 && (k / nRotations) % nAngles != 0) continue;  // every direction is the same at the shoulder
+
+      pose.scale = scale;
+      pose.rotationDeg = AUTOFIT_ROTATION_STEP_DEG * (k % nRotations);
+      if(pose.rotationDeg > 180.0) pose.rotationDeg -= 360.0;
+      pose.x = radius * cos(angle);
+      pose.y = radius * sin(angle);
+      pose.candidate = k;
+      if(checkFitPose(job, state, &pose) && pose.margin > best->margin) *best = pose;
+   }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//This function will get x and y coordinates and check that the whole path can be drawn
+//Arguments, the x and y coordinates of every point
+//Return Value, true if its inside the range or false if not.
+bool checkPad(double x, double y)
+{
+
+   return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Starts a chrome trace-event timeline of the job.  The file can be opened in Perfetto (ui.perfetto.dev) or 
+// chrome://tracing.  If a trace is already running it is left alone.
+// INPUTS:  fileName: name of the trace file (overwritten)
+// RETURN:  true if the trace is running, false if the file could not be opened
+bool traceOpen(const char *fileName)
+{
+   if(traceWriter.fo != NULL) return true;  // already tracing
+
+   if(fopen_s(&traceWriter.fo, fileName, "w") != 0 || traceWriter.fo == NULL)
+   {
+      traceWriter.fo = NULL;
+      return false;
+   }
+
+   traceWriter.used = 0;
+   traceWriter.bFirstEvent = true;
+   fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", traceWriter.fo);
+   return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes whatever is left in the trace buffer, terminates the JSON and closes the trace file.  Does nothing if no
+// trace is running.
+// INPUTS:  none
+// RETURN:  none
+void traceClose()
+{
+   if(traceWriter.fo == NULL) return;
+
+   fwrite(traceWriter.buffer, 1, traceWriter.used, traceWriter.fo);
+   fputs("\n]}\n", traceWriter.fo);
+   fclose(traceWriter.fo);
+   traceWriter.fo = NULL;
+   traceWriter.used = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets the current trace timestamp.  Trace-event timestamps are in microseconds from an arbitrary origin.
+// INPUTS:  none
+// RETURN:  the timestamp in microseconds
+double traceNow()
+{
+   using namespace std::chrono;
+   return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Records one complete ("X") span from tsStart to now.  Spans that finish inside another span are drawn nested under 
+// it by the viewer, so callers only need to remember when they started.  Does nothing if no trace is running.
+// INPUTS:  name: span name (must not contain quotes), category: group shown by the viewer, tsStart: from traceNow,
+//          lineNumber: script line number stored with the span or -1 for none
+// RETURN:  none
+void traceSpan(const char *name, const char *category, double tsStart, int lineNumber)
+{
+   char strEvent[TRACE_MAX_EVENT_LENGTH];  // the formatted event
+   int len;                                // number of characters in strEvent
+
+   if(traceWriter.fo == NULL) return;
+
+   double tsEnd = traceNow();
+
+   if(lineNumber >= 0)
+   {
+      len = sprintf_s(strEvent, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3lf,\"dur\":%.3lf,"
+         "\"pid\":1,\"tid\":1,\"args\":{\"line\":%d}}", traceWriter.bFirstEvent ? "" : ",\n", name, category,
+         tsStart, tsEnd - tsStart, lineNumber);
+   }
+   else
+   {
+      len = sprintf_s(strEvent, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3lf,\"dur\":%.3lf,"
+         "\"pid\":1,\"tid\":1}", traceWriter.bFirstEvent ? "" : ",\n", name, category, tsStart, tsEnd - tsStart);
+   }
+   if(len <= 0) return;
+   traceWriter.bFirstEvent = false;
+
+   // flush a full buffer in one write, then append
+   if(traceWriter.used + (size_t)len > TRACE_BUFFER_SIZE)
+   {
+      fwrite(traceWriter.buffer, 1, traceWriter.used, traceWriter.fo);
+      traceWriter.used = 0;
+   }
+   memcpy(traceWriter.buffer + traceWriter.used, strEvent, (size_t)len);
+   traceWriter.used += (size_t)len;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets the joint angles and pen position the robot is at after a HOME command (the zero pose, full extension along
+// +x, for the built-in models)
+// INPUTS:  robotModel: one of ROBOT_MODEL, pos: where to store the home pose (armPos is left as it is)
+// RETURN:  none
+void getHomePosition(int robotModel, SCARA_POSITION *pos)
+{
+   pos->y = pos->theta1Deg = pos->theta2Deg = 0.0;
+   switch(robotModel)
+   {
+   case ROBOT_MODEL_SCARA450: pos->x = ARM_REACH<ARM_SCARA450>::LMAX; break;
+   case ROBOT_MODEL_SCARA800: pos->x = ARM_REACH<ARM_SCARA800>::LMAX; break;
+   case ROBOT_MODEL_PROFILE:
+      pos->theta1Deg = robotProfile.homeDeg[0];
+      pos->theta2Deg = robotProfile.homeDeg[1];
+      pos->x = robotProfile.xHome;
+      pos->y = robotProfile.yHome;
+      break;
+   default:                   pos->x = ARM_REACH<ARM_SCARA600>::LMAX; break;
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets the reach of a robot model: the pen can only be between LMIN and LMAX from the shoulder.
+// INPUTS:  robotModel: one of ROBOT_MODEL, pLMin/pLMax: where to store the reach
+// RETURN:  none
+void getReach(int robotModel, double *pLMin, double *pLMax)
+{
+   switch(robotModel)
+   {
+   case ROBOT_MODEL_SCARA450: *pLMin = ARM_REACH<ARM_SCARA450>::LMIN; *pLMax = ARM_REACH<ARM_SCARA450>::LMAX; break;
+   case ROBOT_MODEL_SCARA800: *pLMin = ARM_REACH<ARM_SCARA800>::LMIN; *pLMax = ARM_REACH<ARM_SCARA800>::LMAX; break;
+   case ROBOT_MODEL_PROFILE:  *pLMin = robotProfile.LMIN; *pLMax = robotProfile.LMAX; break;
+   default:                   *pLMin = ARM_REACH<ARM_SCARA600>::LMIN; *pLMax = ARM_REACH<ARM_SCARA600>::LMAX; break;
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks the ends of a path command against the LMIN/LMAX reach of the robot, after the transform.  A line is also
+// checked where it passes closest to the shoulder.  (Points in reach may still be beyond the joint limits; the
+// drawing checks every point before it starts.)
+// INPUTS:  cmd: a path command, transformMatrix, state: transform and robot state
+// RETURN:  true if the ends are in reach
+bool isCommandInReach(const PARSED_COMMAND *cmd, double transformMatrix[3][3], const SCARA_STATE *state)
+{
+   double xs, ys, xe, ye;   // ends of the command
+   double ends[2][2];       // ends after the transform
+   double lMin, lMax;       // reach of the robot
+   double dx, dy, t;        // direction of a line, position of its closest point
+   int k;                   // end
+
+   getReach(state->robotModel, &lMin, &lMax);
+   getPathEnds(cmd, &xs, &ys, &xe, &ye);
+   for(k = 0; k < 2; k++)
+   {
+      ends[k][0] = transformMatrix[0][0] * (k == 0 ? xs : xe) + transformMatrix[0][1] * (k == 0 ? ys : ye) +
+         transformMatrix[0][2];
+      ends[k][1] = transformMatrix[1][0] * (k == 0 ? xs : xe) + transformMatrix[1][1] * (k == 0 ? ys : ye) +
+         transformMatrix[1][2];
+      if(hypot(ends[k][0], ends[k][1]) > lMax || hypot(ends[k][0], ends[k][1]) < lMin) return false;
+   }
+
+   if(cmd->index == INDEX_DRAW_LINE)
+   {
+      dx = ends[1][0] - ends[0][0];
+      dy = ends[1][1] - ends[0][1];
+      t = dx == 0.0 && dy == 0.0 ? 0.0 : -(ends[0][0] * dx + ends[0][1] * dy) / (dx * dx + dy * dy);
+      if(t > 0.0 && t < 1.0 && hypot(ends[0][0] + t * dx, ends[0][1] + t * dy) < lMin) return false;
+   }
+   return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads a robot profile file into robotProfile.  Each line has one or more "key values" groups and the file uses the
+// same blank/comment line rules as command files, i.e.
+//    name       MYARM
+//    L1         350          L2 250
+//    maxTheta1  150          maxTheta2 170          (degrees, CW or CCW)
+//    home       0 0                                 (joint angles after HOME, degrees)
+//    maxVelocity      180 240                       (deg/s, joint 1 then joint 2)
+//    maxAcceleration  720 960                       (deg/s^2)
+//    speed      LOW 0.25     (one group per supported MOTOR_SPEED and its fraction of max velocity)
+// Anything left on a line that isn't a key is an error.  Only name, L1, L2, maxTheta1 and maxTheta2 are required.
+// Must be called before any command runs.
+// INPUTS:  fileName: the profile file, strErrorMsg: where the error message is stored
+// RETURN:  true if there is no profile file or it was read correctly, false if the file has an error
+bool loadRobotProfile(const char *fileName, char *strErrorMsg)
+{
+   FILE *fi = NULL;                         // the profile file
+   char strLine[MAX_COMMAND_LENGTH];        // one line of the file
+   char *tok = NULL, *nextTok = NULL;       // for tokenizing strLine
+   const char *seps = " \t\n\r,;:";         // separators between key and values
+   char *pGarbage = NULL;                   // will store if there is any trailing garbage
+   ROBOT_PROFILE profile = {};  // filled in here and only copied to robotProfile if the whole file is good
+   const char *keys[] = {"L1", "L2", "maxTheta1", "maxTheta2", "home", "maxVelocity", "maxAcceleration"};
+   double *values[] = {&profile.L1, &profile.L2, &profile.maxAbsTheta1Deg, &profile.maxAbsTheta2Deg,
+      profile.homeDeg, profile.maxVelocityDeg, profile.maxAccelerationDeg};  // where each key's values go
+   const int nValues[] = {1, 1, 1, 1, 2, 2, 2};  // number of values after each key
+   const int NUM_KEYS = 7;
+   bool bHasName = false, bHasHome = false, bHasSpeeds = false;
+   int lineNumber = 0, k, i, speed;
+
+   if(fopen_s(&fi, fileName, "r") != 0 || fi == NULL) return true;  // no profile, keep the built-in models
+
+   while(fgets(strLine, MAX_COMMAND_LENGTH, fi) != NULL)
+   {
+      lineNumber++;
+      if(isBlankLine(strLine) || isCommentLine(strLine)) continue;
+
+      tok = strtok_s(strLine, seps, &nextTok);
+      while(tok != NULL)  // one "key values" group after another until the end of the line
+      {
+         if(_stricmp(tok, "name") == 0)
+         {
+            tok = strtok_s(NULL, seps, &nextTok);
+            if(tok == NULL || strlen(tok) >= MAX_ARG_STRING_LENGTH)
+            {
+               sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "robot profile: bad name (line %d)", lineNumber);
+               fclose(fi);
+               return false;
+            }
+            strcpy_s(profile.name, MAX_ARG_STRING_LENGTH, tok);
+            bHasName = true;
+         }
+         else if(_stricmp(tok, "speed") == 0)
+         {
+            tok = strtok_s(NULL, seps, &nextTok);
+            if(tok != NULL && _stricmp(tok, STR_MOTOR_SPEED_LOW) == 0) speed = MOTOR_SPEED_LOW;
+            else if(tok != NULL && _stricmp(tok, STR_MOTOR_SPEED_MEDIUM) == 0) speed = MOTOR_SPEED_MEDIUM;
+            else if(tok != NULL && _stricmp(tok, STR_MOTOR_SPEED_HIGH) == 0) speed = MOTOR_SPEED_HIGH;
+            else
+            {
+               sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "robot profile: speed must be %s, %s or %s (line %d)",
+                  STR_MOTOR_SPEED_LOW, STR_MOTOR_SPEED_MEDIUM, STR_MOTOR_SPEED_HIGH, lineNumber);
+               fclose(fi);
+               return false;
+            }
+            tok = strtok_s(NULL, seps, &nextTok);
+            profile.speedScale[speed] = tok == NULL ? 0.0 : strtod(tok, &pGarbage);
+            if(tok == NULL || *pGarbage != '\0' || profile.speedScale[speed] <= 0.0 || profile.speedScale[speed] > 1.0)
+            {
+               sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
+                  "robot profile: speed needs a fraction of max velocity in (0, 1] (line %d)", lineNumber);
+               fclose(fi);
+               return false;
+            }
+            profile.bSpeedSupported[speed] = true;
+            bHasSpeeds = true;
+         }
+         else
+         {
+            for(k = 0; k < NUM_KEYS; k++)
+            {
+               if(_stricmp(tok, keys[k]) == 0) break;
+            }
+            if(k == NUM_KEYS)
+            {
+               sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "robot profile: %s is not a valid key (line %d)", tok,
+                  lineNumber);
+               fclose(fi);
+               return false;
+            }
+
+            for(i = 0; i < nValues[k]; i++)
+            {
+               tok = strtok_s(NULL, seps, &nextTok);
+               if(tok == NULL)
+               {
+                  sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "robot profile: %s expects %d value(s) (line %d)",
+                     keys[k], nValues[k], lineNumber);
+                  fclose(fi);
+                  return false;
+               }
+               values[k][i] = strtod(tok, &pGarbage);
+               if(*pGarbage != '\0')
+               {
+                  sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "robot profile: trailing garbage after %s (line %d)",
+                     keys[k], lineNumber);
+                  fclose(fi);
+                  return false;
+               }
+            }
+            if(k == 4) bHasHome = true;
+         }
+         tok = strtok_s(NULL, seps, &nextTok);
+      }
+   }
+   fclose(fi);
+
+   // check the geometry makes sense before anything is planned with it
+   if(!bHasName || profile.L1 <= 0.0 || profile.L2 <= 0.0 ||
+      profile.maxAbsTheta1Deg <= 0.0 || profile.maxAbsTheta1Deg > 180.0 ||
+      profile.maxAbsTheta2Deg <= 0.0 || profile.maxAbsTheta2Deg > 180.0)
+   {
+      sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH,
+         "robot profile: name, L1, L2, maxTheta1 and maxTheta2 are required and must be positive");
+      return false;
+   }
+
+   profile.LMAX = profile.L1 + profile.L2;
+   profile.LMIN = sqrt(profile.L1 * profile.L1 + profile.L2 * profile.L2 -
+      2.0 * profile.L1 * profile.L2 * cos(PI - degToRad(profile.maxAbsTheta2Deg)));
+   if(!bHasHome) profile.homeDeg[0] = profile.homeDeg[1] = 0.0;
+   if(fabs(profile.homeDeg[0]) > profile.maxAbsTheta1Deg || fabs(profile.homeDeg[1]) > profile.maxAbsTheta2Deg)
+   {
+      sprintf_s(strErrorMsg, MAX_MESSAGE_LENGTH, "robot profile: home is beyond maxTheta1/maxTheta2");
+      return false;
+   }
+   profile.xHome = profile.L1 * cos(degToRad(profile.homeDeg[0])) +
+      profile.L2 * cos(degToRad(profile.homeDeg[0] + profile.homeDeg[1]));
+   profile.yHome = profile.L1 * sin(degToRad(profile.homeDeg[0])) +
+      profile.L2 * sin(degToRad(profile.homeDeg[0] + profile.homeDeg[1]));
+   if(!bHasSpeeds)  // no speed table means every speed is supported at the usual fractions
+   {
+      for(speed = MOTOR_SPEED_LOW; speed <= MOTOR_SPEED_HIGH; speed++)
+      {
+         profile.bSpeedSupported[speed] = true;
+         profile.speedScale[speed] = (speed + 1) / 3.0;
+      }
+   }
+   profile.bLoaded = true;
+
+   robotProfile = profile;
+   return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets where the messages of the commands run by the current thread go: the job's report in the batch planner, so
+// they don't end up on the console mixed with the other jobs, or else the console
+// INPUTS:  none
+// RETURN:  the report file or stdout
+FILE *messageFile()
+{
+   return pJobReport != NULL ? pJobReport : stdout;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sends one command string to the robot driven by the current thread (the global robot, or the cell's robot in
+// multi-robot mode).  Every command to the robot goes through here.  Commands that repeat what the robot was last
+// told are left out (after a plan cache has recorded them, so a reused plan is filtered the same way).  A PEN_UP
+// while the pen is down is held back: if PEN_DOWN comes next, with no move between them, both are left out.  The next
+// command that isn't left out sends it first (so does flushRobotStream, at the end of every command).
+// INPUTS:  strCommand: the command, including the trailing \n
+// RETURN:  none
+void sendToRobot(const char *strCommand)
+{
+   bool bPenDown;   // true if the robot was last told PEN_DOWN
+
+   if(bDryRun) return;
+   if(pPlanCapture != NULL) addPlanText(pPlanCapture, strCommand, strlen(strCommand));
+   if(bPeephole)
+   {
+      if(robotStream.held[0] != '\0' && strcmp(strCommand, "PEN_DOWN\n") == 0)
+      {
+         robotStream.held[0] = '\0';  // the pen stays down
+         strcpy_s(robotStream.pen, MAX_COMMAND_LENGTH, strCommand);
+         robotStream.nRemoved += 2;
+         nRedundantCommands += 2;
+         return;
+      }
+      bPenDown = strcmp(robotStream.pen, "PEN_DOWN\n") == 0;
+      if(isRedundantCommand(&robotStream, strCommand))
+      {
+         nRedundantCommands++;
+         return;
+      }
+      flushRobotStream();
+      if(bPenDown && strcmp(strCommand, "PEN_UP\n") == 0 && strcmp(robotStream.cycle, "CYCLE_PEN_COLOR ON\n") != 0)
+      {
+         strcpy_s(robotStream.held, MAX_COMMAND_LENGTH, strCommand);  // colors don't cycle, so nothing is lost
+         return;
+      }
+   }
+   writeRobotCommand(strCommand);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sends the PEN_UP the peephole filter of sendToRobot is holding back, if there is one.  Called when a command ends,
+// so a robot is never left with the pen down when it was told to lift it.
+// INPUTS:  none
+// RETURN:  none
+void flushRobotStream()
+{
+   char strCommand[MAX_COMMAND_LENGTH];   // the held command
+
+   if(robotStream.held[0] == '\0') return;
+   strcpy_s(strCommand, robotStream.held);
+   robotStream.held[0] = '\0';
+   writeRobotCommand(strCommand);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sends a command that got through the peephole filter to the robot of the current thread, or to the compiled
+// command file (--output and the batch planner)
+// INPUTS:  strCommand: the command, including the trailing \n
+// RETURN:  none
+void writeRobotCommand(const char *strCommand)
+{
+   if(pCommandOutput != NULL)  // batch planner or --output: compiled into a command file (or only counted)
+   {
+      if(pCommandOutput->pEncoder != NULL) encodeRobotCommand(pCommandOutput->pEncoder, pCommandOutput->fo, strCommand);
+      else if(pCommandOutput->fo != NULL) fputs(strCommand, pCommandOutput->fo);
+      countRobotCommand(pCommandOutput, strCommand);
+      return;
+   }
+   pActiveRobot->Send(strCommand);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Peephole filter of sendToRobot.  Keeps track of the pen, motor speed, pen color, color cycling and joint setpoint
+// the robot was last told, and finds the commands that would not change them: a PEN_UP while the pen is up, the
+// speed it already has, the same color again, or a setpoint it is already at.  HOME moves the joints; commands that
+// don't set any of these (the CLEAR_ commands) change nothing, any other forgets everything.  While colors are cycled
+// a pen move or PEN_COLOR may change the color, so none of them is left out.
+// INPUTS:  stream: what the robot was last told, strCommand: the command about to be sent
+// RETURN:  true if the command changes nothing (stream->nRemoved is counted), false if it must be sent
+bool isRedundantCommand(ROBOT_STREAM *stream, const char *strCommand)
+{
+   bool bCycling = strcmp(stream->cycle, "CYCLE_PEN_COLOR ON\n") == 0;   // colors change as the pen moves
+   char *last;                                                            // what the command sets
+
+   if(strncmp(strCommand, "ROTATE_JOINT", strlen("ROTATE_JOINT")) == 0) last = stream->joints;
+   else if(strncmp(strCommand, "PEN_UP", strlen("PEN_UP")) == 0 ||
+      strncmp(strCommand, "PEN_DOWN", strlen("PEN_DOWN")) == 0) last = stream->pen;
+   else if(strncmp(strCommand, "MOTOR_SPEED", strlen("MOTOR_SPEED")) == 0) last = stream->speed;
+   else if(strncmp(strCommand, "PEN_COLOR", strlen("PEN_COLOR")) == 0) last = stream->color;
+   else if(strncmp(strCommand, "CYCLE_PEN_COLOR", strlen("CYCLE_PEN_COLOR")) == 0)
+   {
+      last = stream->cycle;
+      stream->color[0] = '\0';  // the color cycling left the pen with
+   }
+   else if(strncmp(strCommand, "HOME", strlen("HOME")) == 0)
+   {
+      stream->joints[0] = '\0';
+      return false;
+   }
+   else if(strncmp(strCommand, "CLEAR_", strlen("CLEAR_")) == 0) return false;
+   else
+   {
+      stream->pen[0] = stream->speed[0] = stream->color[0] = stream->cycle[0] = stream->joints[0] = '\0';
+      return false;
+   }
+
+   if(bCycling && (last == stream->pen || last == stream->color)) stream->color[0] = '\0';
+   else if(strcmp(last, strCommand) == 0)
+   {
+      stream->nRemoved++;
+      return true;
+   }
+   strcpy_s(last, MAX_COMMAND_LENGTH, strCommand);
+   return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Counts a robot command that was written (or planned) instead of sent, and adds the pen moves and speed changes to
+// the run estimate.  Joint moves are added by addEstimatedMove.
+// INPUTS:  output: the counts, strCommand: the command
+// RETURN:  none
+void countRobotCommand(COMMAND_OUTPUT *output, const char *strCommand)
+{
+   const char *speedPrefix = "MOTOR_SPEED ";   // start of a speed change
+   int speed;                                  // speed counter
+
+   output->nCommands++;
+   if(strncmp(strCommand, "ROTATE_JOINT", strlen("ROTATE_JOINT")) == 0) output->nSetpoints++;
+   else if(strncmp(strCommand, "PEN_UP", strlen("PEN_UP")) == 0 ||
+      strncmp(strCommand, "PEN_DOWN", strlen("PEN_DOWN")) == 0)
+   {
+      output->nPenMoves++;
+      output->seconds += ESTIMATE_PEN_SECONDS;
+   }
+   else if(strncmp(strCommand, speedPrefix, strlen(speedPrefix)) == 0)
+   {
+      for(speed = MOTOR_SPEED_LOW; speed <= MOTOR_SPEED_HIGH; speed++)
+      {
+         const char *keyword = MOTOR_SPEED_KEYWORDS[speed];
+         const char *end = strCommand + strlen(speedPrefix) + strlen(keyword);
+         if(strncmp(strCommand + strlen(speedPrefix), keyword, strlen(keyword)) == 0 && (*end == '\n' || *end == '\0'))
+         {
+            output->motorSpeed = speed;
+         }
+      }
+   }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds one joint move of the robot to the run estimate.  Each joint accelerates, cruises and brakes (a trapezoid, or
+// a triangle for short moves) at the limits of the robot profile, or the usual ones if the profile has none, scaled
+// by the motor speed.  The joints move together, so the move takes as long as the slower one.
+// INPUTS:  output: the counts, theta1Deg, theta2Deg: the joint angles moved to (DEGREES)
+// RETURN:  none
+void addEstimatedMove(COMMAND_OUTPUT *output, double theta1Deg, double theta2Deg)
+{
+   double delta[2] = {fabs(theta1Deg - output->theta1Deg), fabs(theta2Deg - output->theta2Deg)};  // joint moves
+   double scale = robotProfile.bLoaded ? robotProfile.speedScale[output->motorSpeed] : (output->motorSpeed + 1) / 3.0;
+   double v, a, t, tMove = 0.0;   // joint velocity, acceleration, time, and time of the move
+   int j;                         // joint counter
+
+   if(scale <= 0.0) scale = 1.0;  // a speed the profile doesn't support is refused before anything is sent
+   for(j = 0; j < 2; j++)
+   {
+      v = (robotProfile.bLoaded && robotProfile.maxVelocityDeg[j] > 0.0 ?
+         robotProfile.maxVelocityDeg[j] : ESTIMATE_MAX_VELOCITY_DEG[j]) * scale;
+      a = robotProfile.bLoaded && robotProfile.maxAccelerationDeg[j] > 0.0 ?
+         robotProfile.maxAccelerationDeg[j] : ESTIMATE_MAX_ACCELERATION_DEG[j];
+      t = delta[j] < v * v / a ? 2.0 * sqrt(delta[j] / a) : delta[j] / v + v / a;
+      if(t > tMove) tMove = t;
+      output->travelDeg[j] += delta[j];
+   }
+   output->seconds += tMove;
+   output->theta1Deg = theta1Deg;
+   output->theta2Deg = theta2Deg;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Copies text to the end of a robot command being built.  Nothing is written if it doesn't fit.
+// INPUTS:  p: where to write, end: end of the buffer, text: the text
+// RETURN:  the end of the command
+char *appendText(char *p, char *end, const char *text)
+{
+   size_t len = strlen(text);   // length of the text
+
+   if(len > (size_t)(end - p)) return p;
+   memcpy(p, text, len);
+   return p + len;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes an integer at the end of a robot command being built.  Nothing is written if it doesn't fit.
+// INPUTS:  p: where to write, end: end of the buffer, value: the number
+// RETURN:  the end of the command
+char *appendInt(char *p, char *end, int value)
+{
+   std::to_chars_result result = std::to_chars(p, end, value);
+
+   return result.ec == std::errc() ? result.ptr : p;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes a number with a fixed number of decimal places at the end of a robot command being built (the same text
+// as printf's "%.*lf", but without the locale and varargs handling).  Nothing is written if it doesn't fit.
+// INPUTS:  p: where to write, end: end of the buffer, value: the number, decimals: number of decimal places
+// RETURN:  the end of the command
+char *appendFixed(char *p, char *end, double value, int decimals)
+{
+   std::to_chars_result result = std::to_chars(p, end, value, std::chars_format::fixed, decimals);
+
+   return result.ec == std::errc() ? result.ptr : p;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes the header of a command file in the joint delta encoding (--encode) and gets the encoder ready for it.
+// INPUTS:  encoder: the encoder, fo: the file (opened in binary)
+// RETURN:  none
+void startJointStream(JOINT_ENCODER *encoder, FILE *fo)
+{
+   *encoder = {};
+   encoder->nSinceKeyframe = -1;
+   fwrite(JOINT_STREAM_MAGIC, 1, sizeof(JOINT_STREAM_MAGIC), fo);
+   fputc(JOINT_STREAM_VERSION, fo);
+   encoder->nEncodedBytes = sizeof(JOINT_STREAM_MAGIC) + 1;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes one robot command to a command file in the joint delta encoding.  A ROTATE_JOINT is a keyframe (its decimal
+// places and both angles) or a delta (the change of both angles), each angle a zigzag varint in units of its last
+// decimal place.  PEN_UP and PEN_DOWN are one byte.  Any other command is its length and text.
+// INPUTS:  encoder: the encoder, fo: the file, strCommand: the command, including the trailing \n
+// RETURN:  none
+void encodeRobotCommand(JOINT_ENCODER *encoder, FILE *fo, const char *strCommand)
+{
+   unsigned char record[1 + 3 * 10 + MAX_COMMAND_LENGTH];  // tag and varints (at most 10 bytes each), or text
+   size_t n = 1, len = strlen(strCommand);                 // bytes of the record, of the text
+   long long q[2], v;                                      // the setpoint, a value written
+   int decimals, j;                                        // its decimal places, joint
+
+   if(parseSetpoint(strCommand, q, &decimals))
+   {
+      bool bKeyframe = encoder->nSinceKeyframe < 0 || encoder->nSinceKeyframe >= JOINT_KEYFRAME_INTERVAL ||
+         decimals != encoder->decimals;   // true to write the angles, not their change
+      record[0] = (unsigned char)(bKeyframe ? JOINT_RECORD_KEYFRAME : JOINT_RECORD_DELTA);
+      if(bKeyframe) n += putVarint(record + n, (unsigned long long)decimals);
+      for(j = 0; j < 2; j++)
+      {
+         v = bKeyframe ? q[j] : q[j] - encoder->q[j];
+         n += putVarint(record + n, ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));  // zigzag
+         encoder->q[j] = q[j];
+      }
+      encoder->decimals = decimals;
+      encoder->nSinceKeyframe = bKeyframe ? 1 : encoder->nSinceKeyframe + 1;
+   }
+   else if(strcmp(strCommand, "PEN_UP\n") == 0) record[0] = (unsigned char)JOINT_RECORD_PEN_UP;
+   else if(strcmp(strCommand, "PEN_DOWN\n") == 0) record[0] = (unsigned char)JOINT_RECORD_PEN_DOWN;
+   else
+   {
+      if(len >= MAX_COMMAND_LENGTH) len = MAX_COMMAND_LENGTH - 1;
+      record[0] = (unsigned char)JOINT_RECORD_TEXT;
+      n += putVarint(record + n, (unsigned long long)len);
+      memcpy(record + n, strCommand, len);
+      n += len;
+   }
+   fwrite(record, 1, n, fo);
+   encoder->nTextBytes += (long long)strlen(strCommand);
+   encoder->nEncodedBytes += (long long)n;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets the angles of a ROTATE_JOINT as whole numbers of their last decimal place (72.038229 with 6 decimals is
+// 72038229).  Only setpoints that formatSetpoint writes back exactly the same are taken, so decoding is lossless.
+// INPUTS:  strCommand: the command, q: where to store the angles, pDecimals: where to store their decimal places
+// RETURN:  true if the command is such a setpoint
+bool parseSetpoint(const char *strCommand, long long q[2], int *pDecimals)
+{
+   const char *prefix[2] = {"ROTATE_JOINT ANG1 ", " ANG2 "};   // text before each angle
+   const char *p = strCommand;                                // character being read
+   char strCheck[MAX_COMMAND_LENGTH];                         // the setpoint written back
+   int decimals = 0, j;                                       // decimal places of an angle, joint
+   bool bNegative, bPoint;                                    // sign, decimal point seen
+
+   for(j = 0; j < 2; j++)
+   {
+      if(strncmp(p, prefix[j], strlen(prefix[j])) != 0) return false;
+      p += strlen(prefix[j]);
+      bNegative = *p == '-';
+      if(bNegative) p++;
+      for(q[j] = 0, decimals = 0, bPoint = false; isdigit((unsigned char)*p) || (*p == '.' && !bPoint); p++)
+      {
+         if(*p == '.') bPoint = true;
+         else if(q[j] >= 100000000000000000ll) return false;   // too many digits
+         else
+         {
+            q[j] = 10 * q[j] + (*p - '0');
+            if(bPoint) decimals++;
+         }
+      }
+      if(bNegative) q[j] = -q[j];
+      if(j == 1 && decimals != *pDecimals) return false;
+      *pDecimals = decimals;
+   }
+   formatSetpoint(strCheck, sizeof(strCheck), q, decimals);
+   return strcmp(strCheck, strCommand) == 0;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes a ROTATE_JOINT from its angles in units of their last decimal place (the same text as sendJointSetpoint).
+// INPUTS:  strCommand: where to write the command, size: its size, q: the angles, decimals: their decimal places
+// RETURN:  none
+void formatSetpoint(char *strCommand, size_t size, const long long q[2], int decimals)
+{
+   char *end = strCommand + size - 1;       // room left for the '\0'
+   char *p;                                 // end of the command so far
+
+   p = appendText(strCommand, end, "ROTATE_JOINT ANG1 ");
+   p = appendQuantised(p, end, q[0], decimals);
+   p = appendText(p, end, " ANG2 ");
+   p = appendQuantised(p, end, q[1], decimals);
+   p = appendText(p, end, "\n");
+   *p = '\0';
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes a whole number of a decimal place (q / 10^decimals) at the end of a robot command being built, with all of
+// its decimal places.  Nothing is written if it doesn't fit.
+// INPUTS:  p: where to write, end: end of the buffer, q: the number, decimals: its decimal places
+// RETURN:  the end of the command
+char *appendQuantised(char *p, char *end, long long q, int decimals)
+{
+   char digits[32];                                                  // the digits, last one first
+   unsigned long long u = q < 0 ? 0ull - (unsigned long long)q : q;  // size of the number
+   int n = 0, i;                                                     // number of digits, digit
+
+   do
+   {
+      digits[n++] = (char)('0' + u % 10);
+      u /= 10;
+   }
+   while(u > 0 || n <= decimals);   // at least one digit before the decimal point
+   if((q < 0) + n + (decimals > 0) > end - p) return p;
+
+   if(q < 0) *p++ = '-';
+   for(i = n - 1; i >= 0; i--)
+   {
+      *p++ = digits[i];
+      if(i == decimals && decimals > 0) *p++ = '.';
+   }
+   return p;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Packs a number as a varint: 7 bits per byte, low bits first, the top bit set on every byte but the last.
+// INPUTS:  p: where to write (10 bytes at most are written), value: the number
+// RETURN:  number of bytes written
+int putVarint(unsigned char *p, unsigned long long value)
+{
+   int n = 0;   // bytes written
+
+   while(value >= 0x80)
+   {
+      p[n++] = (unsigned char)(value | 0x80);
+      value >>= 7;
+   }
+   p[n++] = (unsigned char)value;
+   return n;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads a varint written by putVarint.
+// INPUTS:  fi: the file, pValue: where to store the number
+// RETURN:  false at the end of the file or if the varint is too long
+bool getVarint(FILE *fi, unsigned long long *pValue)
+{
+   int c, shift;   // byte read, position of its bits
+
+   *pValue = 0;
+   for(shift = 0; shift < 64; shift += 7)
+   {
+      if((c = fgetc(fi)) == EOF) return false;
+      *pValue |= (unsigned long long)(c & 0x7f) << shift;
+      if((c & 0x80) == 0) return true;
+   }
+   return false;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Stand-in decoder of the joint delta encoding (--decode), for testing encoded command files: writes the commands of
+// an encoded file back as the text commands they were encoded from.
+// INPUTS:  fileName: the encoded file, outputName: the text file to write (NULL or "-" for stdout)
+// RETURN:  false (with a message printed) if a file could not be opened or the encoded file is damaged
+bool decodeCommandFile(const char *fileName, const char *outputName)
+{
+   FILE *fi = NULL, *fo = stdout;            // the encoded file, the text commands
+   JOINT_ENCODER decoder = {};               // the setpoint being decoded
+   char magic[sizeof(JOINT_STREAM_MAGIC)];   // start of the file
+   char strCommand[MAX_COMMAND_LENGTH];      // a decoded command
+   unsigned long long value[3];              // varints of a record
+   int tag, j;                               // record tag, joint
+   bool bOk = true;                          // false once the file is found to be damaged
+
+   if(fopen_s(&fi, fileName, "rb") != 0 || fi == NULL)
+   {
+      printf("Sorry the file %s could not be opened\n", fileName);
+      return false;
+   }
+   if(fread(magic, 1, sizeof(magic), fi) != sizeof(magic) || memcmp(magic, JOINT_STREAM_MAGIC, sizeof(magic)) != 0 ||
+      fgetc(fi) != JOINT_STREAM_VERSION)
+   {
+      printf("Sorry %s is not a command file in the joint delta encoding\n", fileName);
+      fclose(fi);
+      return false;
+   }
+   if(outputName != NULL && strcmp(outputName, "-") != 0 && (fopen_s(&fo, outputName, "w") != 0 || fo == NULL))
+   {
+      printf("Sorry the output file %s could not be opened\n", outputName);
+      fclose(fi);
+      return false;
+   }
+
+   decoder.nSinceKeyframe = -1;
+   while(bOk && (tag = fgetc(fi)) != EOF)
+   {
+      if(tag == JOINT_RECORD_TEXT)
+      {
+         bOk = getVarint(fi, &value[0]) && value[0] < MAX_COMMAND_LENGTH &&
+            fread(strCommand, 1, (size_t)value[0], fi) == value[0];
+         if(!bOk) break;
+         strCommand[value[0]] = '\0';
+         fputs(strCommand, fo);
+         continue;
+      }
+      if(tag == JOINT_RECORD_PEN_UP || tag == JOINT_RECORD_PEN_DOWN)
+      {
+         fputs(tag == JOINT_RECORD_PEN_UP ? "PEN_UP\n" : "PEN_DOWN\n", fo);
+         continue;
+      }
+      if(tag == JOINT_RECORD_KEYFRAME)
+      {
+         bOk = getVarint(fi, &value[0]) && value[0] <= JOINT_DECIMALS_MAX;
+         decoder.decimals = (int)value[0];
+         decoder.nSinceKeyframe = 0;
+      }
+      else bOk = tag == JOINT_RECORD_DELTA && decoder.nSinceKeyframe >= 0;   // a delta needs a keyframe before it
+      for(j = 1; j <= 2 && bOk; j++)
+      {
+         bOk = getVarint(fi, &value[j]);
+         long long v = (long long)(value[j] >> 1) ^ -(long long)(value[j] & 1);   // undo the zigzag
+         decoder.q[j - 1] = tag == JOINT_RECORD_KEYFRAME ? v :
+            (long long)((unsigned long long)decoder.q[j - 1] + (unsigned long long)v);   // (wraps if damaged)
+      }
+      if(!bOk) break;
+      decoder.nSinceKeyframe++;
+      formatSetpoint(strCommand, sizeof(strCommand), decoder.q, decoder.decimals);
+      fputs(strCommand, fo);
+   }
+   if(!bOk) printf("Sorry %s is damaged after byte %ld\n", fileName, ftell(fi));
+   fclose(fi);
+   if(fo != stdout) fclose(fo);
+   return bOk;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sends a ROTATE_JOINT command and, if a joint capture is running on this thread, records the setpoint.  A capture
+// of HOME passes through here with bDryRun set, so nothing extra is sent.
+// INPUTS:  theta1Deg, theta2Deg: the joint angles (DEGREES)
+// RETURN:  none
+void sendJointSetpoint(double theta1Deg, double theta2Deg)
+{
+   char commandString[MAX_COMMAND_LENGTH];  // the formatted command
+   char *end = commandString + MAX_COMMAND_LENGTH - 1;  // room left for the '\0'
+   char *p;                                 // end of the command so far
+
+   // sent for every point, so it is built without sprintf (same text as "ROTATE_JOINT ANG1 %lf ANG2 %lf\n")
+   p = appendText(commandString, end, "ROTATE_JOINT ANG1 ");
+   p = appendFixed(p, end, theta1Deg, jointDecimals);
+   p = appendText(p, end, " ANG2 ");
+   p = appendFixed(p, end, theta2Deg, jointDecimals);
+   p = appendText(p, end, "\n");
+   *p = '\0';
+   sendToRobot(commandString);
+   if(pCommandOutput != NULL && !bDryRun) addEstimatedMove(pCommandOutput, theta1Deg, theta2Deg);
+
+   JOINT_TRAJECTORY *traj = pJointCapture;
+   if(traj == NULL) return;
+   if(traj->n == traj->capacity)  // grow the capture by doubling
+   {
+      int capacity = traj->capacity == 0 ? 1024 : 2 * traj->capacity;
+      double (*theta)[2] = (double (*)[2])realloc(traj->theta, capacity * sizeof(traj->theta[0]));
+      if(theta == NULL) return;  // out of memory: the capture is cut short
+      traj->theta = theta;
+      traj->capacity = capacity;
+   }
+   traj->theta[traj->n][0] = theta1Deg;
+   traj->theta[traj->n][1] = theta2Deg;
+   traj->n++;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Multi-robot mode.  Asks for the number of robot cells and a manifest file (one job file name per line), unless
+// they are given, then gives every cell its own robot connection, state, transform matrix and command list and runs
+// it on its own thread.  Cells take the next job from the shared queue as soon as they finish one, so fast cells do
+// more jobs.
+// INPUTS:  initialState: state each cell's robot starts in, nRobots: number of cells (0 to ask the user),
+//          jobsPath: the manifest or job directory (NULL to ask the user)
+// RETURN:  none
+void runMultiRobotJobs(const SCARA_STATE *initialState, int nRobots, const char *jobsPath)
+{
+   char strInput[MAX_FILENAME_LENGTH] = {};   // user input
+   char *pGarbage = NULL;                     // will store if there is any trailing garbage
+   int nCells = nRobots, c;                   // number of cells, cell counter
+   JOB_QUEUE jobs;                            // shared job queue
+   SCARA_CELL *cells = NULL;                  // the robot cells (dynamic array)
+   std::thread workers[MAX_ROBOT_CELLS];      // one worker thread per cell
+
+   if(nCells == 0)
+   {
+      printf("How many robots (1 - %d)? ", MAX_ROBOT_CELLS);
+      if(fgets(strInput, MAX_FILENAME_LENGTH, stdin) == NULL) return;
+      nCells = (int)strtol(strInput, &pGarbage, 10);
+      if(pGarbage == strInput || nCells < 1 || nCells > MAX_ROBOT_CELLS)
+      {
+         printf("Sorry the number of robots must be between 1 and %d\n", MAX_ROBOT_CELLS);
+         return;
+      }
+   }
+
+   if(jobsPath == NULL)
+   {
+      printf("Please enter the name of the job manifest (one command file per line) or a directory of jobs: \n");
+      if(fgets(strInput, MAX_FILENAME_LENGTH, stdin) == NULL) return;
+      strInput[strcspn(strInput, "\r\n")] = '\0';
+      jobsPath = strInput;
+   }
+   if(!loadJobQueue(jobsPath, &jobs))
+   {
+      programExitCode = 1;
+      return;
+   }
+
+   // set up the cells.  Cell 0 uses the robot that is already connected
+   cells = (SCARA_CELL *)calloc(nCells, sizeof(SCARA_CELL));
+   if(cells == NULL)
+   {
+      free(jobs.fileNames);
+      return;
+   }
+   for(c = 0; c < nCells; c++)
+   {
+      cells[c].id = c;
+      cells[c].state = *initialState;
+      resetTransformMatrix(cells[c].transformMatrix);
+      cells[c].pRobot = c == 0 ? &robot : new CRobot;
+      if(c > 0 && !cells[c].pRobot->Initialize())
+      {
+         printf("Sorry robot %d could not be connected, running with %d robot(s)\n", c, c);
+         delete cells[c].pRobot;
+         break;
+      }
+   }
+   nCells = c;
+
+   printf("Running %d job(s) on %d robot(s)\n", jobs.nJobs, nCells);
+   for(c = 0; c < nCells; c++) workers[c] = std::thread(runCellWorker, &cells[c], &jobs);
+   for(c = 0; c < nCells; c++) workers[c].join();
+
+   for(c = 0; c < nCells; c++)
+   {
+      printf("Robot %d ran %d job(s)\n", c, cells[c].nJobsRun);
+      if(c > 0)
+      {
+         cells[c].pRobot->Close();
+         delete cells[c].pRobot;
+      }
+   }
+   free(cells);
+   free(jobs.fileNames);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Worker thread of one robot cell.  Claims jobs from the shared queue (lock free) and runs them on this cell's robot
+// until there are no jobs left.  Each job starts with an identity transform matrix.
+// INPUTS:  cell: the cell to run, jobs: the shared job queue
+// RETURN:  none
+void runCellWorker(SCARA_CELL *cell, JOB_QUEUE *jobs)
+{
+   int job;  // index of the claimed job
+
+   pActiveRobot = cell->pRobot;  // everything this thread sends goes to the cell's robot
+   activeCellId = cell->id;
+
+   while((job = jobs->nextJob.fetch_add(1)) < jobs->nJobs)
+   {
+      resetTransformMatrix(cell->transformMatrix);
+      printf("Robot %d: running %s\n", cell->id, jobs->fileNames[job]);
+      if(!runCommandFile(jobs->fileNames[job], &cell->state, cell->transformMatrix))
+         printf("Robot %d: sorry the file %s could not be open\n", cell->id, jobs->fileNames[job]);
+      else
+         cell->nJobsRun++;
+   }
+
+   traceClose();  // this thread's trace, if the jobs turned one on
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Loads a job queue.  path is either a directory (every file in it is a job, in name order) or a manifest with one
+// command file per line (blank and comment lines are skipped).  At most MAX_JOBS are loaded.
+// INPUTS:  path: the manifest or directory, jobs: the queue to fill (jobs->fileNames must be freed)
+// RETURN:  false if the path could not be read or there wasn't enough memory
+bool loadJobQueue(const char *path, JOB_QUEUE *jobs)
+{
+   FILE *fi = NULL;                  // the manifest file
+   bool bDirectory = false;          // true if path is a directory
+   size_t len = strlen(path);        // length of the directory name
+
+   jobs->fileNames = (char (*)[MAX_FILENAME_LENGTH])malloc(MAX_JOBS * MAX_FILENAME_LENGTH);
+   if(jobs->fileNames == NULL) return false;
+   jobs->nJobs = 0;
+   jobs->nextJob = 0;
+
+#ifdef _WIN32
+   WIN32_FIND_DATAA found;           // file found in the directory
+   HANDLE hFind;                     // directory search
+   char pattern[MAX_FILENAME_LENGTH];   // every file of the directory
+
+   sprintf_s(pattern, "%s\\*", path);
+   hFind = FindFirstFileA(pattern, &found);
+   if(hFind != INVALID_HANDLE_VALUE)
+   {
+      bDirectory = true;
+      do
+      {
+         if(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+         if(len + 1 + strlen(found.cFileName) >= MAX_FILENAME_LENGTH || jobs->nJobs == MAX_JOBS) continue;
+         sprintf_s(jobs->fileNames[jobs->nJobs++], "%s\\%s", path, found.cFileName);
+      }
+      while(FindNextFileA(hFind, &found));
+      FindClose(hFind);
+   }
+#else
+   DIR *dir = opendir(path);        // directory search
+   struct dirent *found;             // file found in the directory
+
+   if(dir != NULL)
+   {
+      bDirectory = true;
+      while((found = readdir(dir)) != NULL)
+      {
+         if(found->d_name[0] == '.' || found->d_type == DT_DIR) continue;
+         if(len + 1 + strlen(found->d_name) >= MAX_FILENAME_LENGTH || jobs->nJobs == MAX_JOBS) continue;
+         sprintf_s(jobs->fileNames[jobs->nJobs++], "%s/%s", path, found->d_name);
+      }
+      closedir(dir);
+   }
+#endif
+
+   if(bDirectory)
+   {
+      qsort(jobs->fileNames, jobs->nJobs, MAX_FILENAME_LENGTH, compareFileNames);  // same order every run
+      return true;
+   }
+
+   if(fopen_s(&fi, path, "r") != 0 || fi == NULL)
+   {
+      printf("Sorry the manifest %s could not be open\n", path);
+      free(jobs->fileNames);
+      return false;
+   }
+   while(jobs->nJobs < MAX_JOBS && fgets(jobs->fileNames[jobs->nJobs], MAX_FILENAME_LENGTH, fi) != NULL)
+   {
+      if(isBlankLine(jobs->fileNames[jobs->nJobs]) || isCommentLine(jobs->fileNames[jobs->nJobs])) continue;
+      jobs->fileNames[jobs->nJobs][strcspn(jobs->fileNames[jobs->nJobs], "\r\n")] = '\0';
+      jobs->nJobs++;
+   }
+   fclose(fi);
+   return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// qsort comparison of job file names
+// INPUTS:  a, b: two file names (char[MAX_FILENAME_LENGTH])
+// RETURN:  strcmp order
+int compareFileNames(const void *a, const void *b)
+{
+   return strcmp((const char *)a, (const char *)b);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Batch planner.  Asks for a job manifest or directory and an output directory (unless they are given), then plans
+// every job on a pool of threads without a robot: each job runs with its own state and transform matrix (starting
+// from initialState and the identity) and its robot commands are written to <output directory>/<job name>.robot,
+// with a <job name>.report.txt listing its invalid lines and the shapes no arm could draw.  Job file names (without
+// their extension) must be different, or their outputs overwrite each other.
+// INPUTS:  initialState: state each job starts in, jobsPath: the manifest or job directory, outDir: where the
+//          compiled jobs and reports go (NULL to ask the user for them)
+// RETURN:  none
+void runBatchPlanner(const SCARA_STATE *initialState, const char *jobsPath, const char *outDir)
+{
+   char strInput[MAX_FILENAME_LENGTH] = {};     // user input
+   char strOutDir[MAX_FILENAME_LENGTH] = {};    // the output directory typed by the user
+   JOB_QUEUE jobs;                              // the jobs
+   BATCH_WORKER workers[MAX_BATCH_THREADS] = {};   // per thread results
+   std::thread threads[MAX_BATCH_THREADS];      // the pool
+   int nThreads = (int)std::thread::hardware_concurrency();  // number of threads
+   int t, nPlanned = 0, nWithProblems = 0, nFailed = 0;      // thread, totals
+   double tsStart;                              // when planning started
+
+   if(jobsPath == NULL)
+   {
+      printf("Please enter the name of the job manifest (one command file per line) or a directory of jobs: \n");
+      if(fgets(strInput, MAX_FILENAME_LENGTH, stdin) == NULL) return;
+      strInput[strcspn(strInput, "\r\n")] = '\0';
+      jobsPath = strInput;
+   }
+   if(outDir == NULL)
+   {
+      printf("Please enter the directory for the compiled jobs and their reports: \n");
+      if(fgets(strOutDir, MAX_FILENAME_LENGTH, stdin) == NULL) return;
+      strOutDir[strcspn(strOutDir, "\r\n")] = '\0';
+      if(strOutDir[0] == '\0') strcpy_s(strOutDir, ".");
+      outDir = strOutDir;
+   }
+   if(!loadJobQueue(jobsPath, &jobs))
+   {
+      programExitCode = 1;
+      return;
+   }
+
+   if(nThreads < 1) nThreads = 1;
+   if(nThreads > MAX_BATCH_THREADS) nThreads = MAX_BATCH_THREADS;
+   if(nThreads > jobs.nJobs) nThreads = jobs.nJobs > 0 ? jobs.nJobs : 1;
+
+   printf("Planning %d job(s) on %d thread(s) into %s\n", jobs.nJobs, nThreads, outDir);
+   tsStart = traceNow();
+   for(t = 0; t < nThreads; t++)
+   {
+      workers[t].id = t;
+      threads[t] = std::thread(runBatchWorker, &workers[t], &jobs, initialState, outDir);
+   }
+   for(t = 0; t < nThreads; t++)
+   {
+      threads[t].join();
+      nPlanned += workers[t].nPlanned;
+      nWithProblems += workers[t].nWithProblems;
+      nFailed += workers[t].nFailed;
+   }
+
+   printf("Planned %d job(s) in %.2f s: %d clean, %d with problems (see their reports), %d failed\n",
+      nPlanned + nWithProblems + nFailed, (traceNow() - tsStart) / 1e6, nPlanned, nWithProblems, nFailed);
+   if(nFailed > 0) programExitCode = 1;
+   free(jobs.fileNames);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Worker thread of the batch planner.  Claims jobs from the shared queue (lock free, like runCellWorker) and plans
+// them until there are none left.
+// INPUTS:  worker: this thread's results, jobs: the shared job queue, initialState: state each job starts in,
+//          outDir: where the compiled jobs and reports go
+// RETURN:  none
+void runBatchWorker(BATCH_WORKER *worker, JOB_QUEUE *jobs, const SCARA_STATE *initialState, const char *outDir)
+{
+   int job, nProblems;  // index of the claimed job, what went wrong planning it
+
+   activeCellId = worker->id;  // each thread writes its own trace, if a job turns one on
+   while((job = jobs->nextJob.fetch_add(1)) < jobs->nJobs)
+   {
+      nProblems = runBatchJob(jobs->fileNames[job], outDir, initialState);
+      if(nProblems < 0) worker->nFailed++;
+      else if(nProblems > 0) worker->nWithProblems++;
+      else worker->nPlanned++;
+   }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Plans one job of the batch planner: runs it like runCommandFile, but the robot commands go to its compiled command
+// file, and the invalid lines, the shapes no arm could draw and every message of the commands (the ones that could
+// not be carried out, singularity guard reports, queryState) go to its report instead of the console.
+// INPUTS:  fileName: the job, outDir: where the compiled job and report go, initialState: state the job starts in
+// RETURN:  number of problems found (0 for a clean job), -1 if the job could not be read or its output written
+int runBatchJob(const char *fileName, const char *outDir, const SCARA_STATE *initialState)
+{
+   FILE *fi = NULL, *fr = NULL;                 // the job, its report
+   COMMAND_OUTPUT output = {};                  // its compiled commands
+   SCARA_STATE state = *initialState;           // state of the job's robot
+   double transformMatrix[3][3];                // the job's transform
+   char strCommand[MAX_COMMAND_LENGTH];         // line of the job
+   char strErrorMsg[MAX_MESSAGE_LENGTH] = {};   // error message of parseCommand
+   char baseName[MAX_FILENAME_LENGTH];          // job file name without its directory and extension
+   char outName[MAX_FILENAME_LENGTH], reportName[MAX_FILENAME_LENGTH];  // output file names
+   const char *p;                               // start of the name in fileName
+   PARSED_COMMAND cmd;                          // the parsed command
+   int lineNumber = 0, nRun = 0, nProblems = 0, nUnreachable;  // line, commands run, problems, shapes out of reach
+   int nRejected;                               // commands not carried out before the current one
+   double tsStart = traceNow();                 // when the job started
+   PLAN_CACHE oldCache = {}, newCache = {};     // plans of the last run of the job and of this one (--cache)
+   char cacheName[MAX_FILENAME_LENGTH];         // file the plans are kept in
+   JOINT_ENCODER encoder = {};                  // joint delta encoding of the compiled file (--encode)
+
+   p = strrchr(fileName, '/');
+   if(strrchr(fileName, '\\') != NULL && (p == NULL || strrchr(fileName, '\\') > p)) p = strrchr(fileName, '\\');
+   strcpy_s(baseName, p == NULL ? fileName : p + 1);
+   if(strrchr(baseName, '.') != NULL && strrchr(baseName, '.') != baseName) *strrchr(baseName, '.') = '\0';
+   sprintf_s(outName, "%s/%s%s", outDir, baseName, bJointEncoding ? STR_ENCODED_EXTENSION : STR_COMPILED_EXTENSION);
+   sprintf_s(reportName, "%s/%s%s", outDir, baseName, STR_REPORT_EXTENSION);
+   sprintf_s(cacheName, "%s/%s%s", outDir, baseName, STR_PLAN_CACHE_EXTENSION);
+
+   if(fopen_s(&fi, fileName, "r") != 0 || fi == NULL)
+   {
+      printf("Sorry the job %s could not be open\n", fileName);
+      return -1;
+   }
+   if(fopen_s(&output.fo, outName, bJointEncoding ? "wb" : "w") != 0 || output.fo == NULL ||
+      fopen_s(&fr, reportName, "w") != 0 || fr == NULL)
+   {
+      printf("Sorry the output of %s could not be written to %s\n", fileName, outDir);
+      if(output.fo != NULL) fclose(output.fo);
+      fclose(fi);
+      return -1;
+   }
+
+   resetTransformMatrix(transformMatrix);
+   jointDecimals = 6;  // thread settings a previous job may have changed
+   robotStream = {};   // each compiled file starts a robot of its own
+   if(bJointEncoding)
+   {
+      output.pEncoder = &encoder;
+      startJointStream(&encoder, output.fo);
+   }
+   if(bPlanCache) loadPlanCache(cacheName, &oldCache);
+   pCommandOutput = &output;
+   pJobReport = fr;
+   fprintf(fr, "Job %s\n", fileName);
+   while(fgets(strCommand, MAX_COMMAND_LENGTH, fi) != NULL)
+   {
+      lineNumber++;
+      if(isBlankLine(strCommand) || isCommentLine(strCommand)) continue;
+      if(parseCommand(strCommand, &cmd, strErrorMsg, lineNumber) == -1)
+      {
+         fprintf(fr, "%s\n", strErrorMsg);
+         nProblems++;
+         continue;
+      }
+      nUnreachable = output.nUnreachable;
+      nRejected = nRejectedCommands;
+      if(bPlanCache) executeCachedCommand(&cmd, &state, transformMatrix, &oldCache, &newCache);
+      else executeCommand(&cmd, &state, transformMatrix);
+      nRun++;
+      if(output.nUnreachable > nUnreachable)
+      {
+         fprintf(fr, "no arm can draw %s (line %d)\n", SCARA_COMMANDS[cmd.index].cmdName, lineNumber);
+         nProblems++;
+      }
+      if(nRejectedCommands > nRejected)  // its message is already in the report
+      {
+         fprintf(fr, "%s was not carried out (line %d)\n", SCARA_COMMANDS[cmd.index].cmdName, lineNumber);
+         nProblems++;
+      }
+   }
+   pCommandOutput = NULL;
+   pJobReport = NULL;
+   traceClose();
+
+   fprintf(fr, "%d line(s), %d command(s) run, %d problem(s)\n", lineNumber, nRun, nProblems);
+   fprintf(fr, "%d robot command(s) (%d joint setpoint(s)) written to %s in %.1f ms\n", output.nCommands,
+      output.nSetpoints, outName, (traceNow() - tsStart) / 1000.0);
+   if(robotStream.nRemoved > 0) fprintf(fr, "%d redundant robot command(s) left out\n", robotStream.nRemoved);
+   if(bJointEncoding)
+   {
+      fprintf(fr, "joint delta encoding: %lld bytes instead of %lld\n", encoder.nEncodedBytes, encoder.nTextBytes);
+   }
+   if(bPlanCache)
+   {
+      fprintf(fr, "%d of %d command(s) reused from the plan cache\n", newCache.nHits,
+         newCache.nHits + newCache.nMisses);
+      if(!savePlanCache(cacheName, &newCache)) fprintf(fr, "the plan cache %s could not be written\n", cacheName);
+      freePlanCache(&oldCache);
+      freePlanCache(&newCache);
+   }
+   fclose(fr);
+   fclose(output.fo);
+   fclose(fi);
+   return nProblems;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets the link lengths of a robot model
+// INPUTS:  robotModel: one of ROBOT_MODEL, pL1/pL2: where to store the inner and outer link lengths
+// RETURN:  none
+void getLinkLengths(int robotModel, double *pL1, double *pL2)
+{
+   switch(robotModel)
+   {
+   case ROBOT_MODEL_SCARA450: *pL1 = ARM_SCARA450::L1; *pL2 = ARM_SCARA450::L2; break;
+   case ROBOT_MODEL_SCARA800: *pL1 = ARM_SCARA800::L1; *pL2 = ARM_SCARA800::L2; break;
+   case ROBOT_MODEL_PROFILE:  *pL1 = robotProfile.L1;  *pL2 = robotProfile.L2;  break;
+   default:                   *pL1 = ARM_SCARA600::L1; *pL2 = ARM_SCARA600::L2; break;
+   }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets the joint limits of a robot model
+// INPUTS:  robotModel: one of ROBOT_MODEL, pMaxTheta1Deg/pMaxTheta2Deg: where to store the shoulder and elbow limits
+// RETURN:  none
+void getJointLimits(int robotModel, double *pMaxTheta1Deg, double *pMaxTheta2Deg)
+{
+   switch(robotModel)
+   {
+   case ROBOT_MODEL_SCARA450:
+      *pMaxTheta1Deg = ARM_SCARA450::MAX_ABS_THETA1_DEG; *pMaxTheta2Deg = ARM_SCARA450::MAX_ABS_THETA2_DEG; break;
+   case ROBOT_MODEL_SCARA800:
+      *pMaxTheta1Deg = ARM_SCARA800::MAX_ABS_THETA1_DEG; *pMaxTheta2Deg = ARM_SCARA800::MAX_ABS_THETA2_DEG; break;
+   case ROBOT_MODEL_PROFILE:
+      *pMaxTheta1Deg = robotProfile.maxAbsTheta1Deg; *pMaxTheta2Deg = robotProfile.maxAbsTheta2Deg; break;
+   default:
+      *pMaxTheta1Deg = ARM_SCARA600::MAX_ABS_THETA1_DEG; *pMaxTheta2Deg = ARM_SCARA600::MAX_ABS_THETA2_DEG; break;
+   }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Plans a command file without sending anything and records the joint setpoints it would send.  The first setpoint 
+// is the pose the robot starts in.
+// INPUTS:  fileName: the job, initialState: state the robot starts in, traj: where the setpoints are stored (empty)
+// RETURN:  false if the file could not be opened
+bool captureJointTrajectory(const char *fileName, const SCARA_STATE *initialState, JOINT_TRAJECTORY *traj)
+{
+   SCARA_STATE state = *initialState;
+   double transformMatrix[3][3];
+   bool bOk;
+
+   resetTransformMatrix(transformMatrix);
+
+   bDryRun = true;
+   pJointCapture = traj;
+   sendJointSetpoint(state.currentPos.theta1Deg, state.currentPos.theta2Deg);
+   bOk = runCommandFile(fileName, &state, transformMatrix);
+   pJointCapture = NULL;
+   bDryRun = false;
+
+   return bOk;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Works out where the two links of an arm are at one tick of its trajectory, in the shared workspace frame.  After
+// the end of the trajectory the arm stays at its last setpoint.
+// INPUTS:  traj: the arm's trajectory, tick: the tick, base: where the arm is, links: inner and outer link
+// RETURN:  none
+void getArmLinks(const JOINT_TRAJECTORY *traj, int tick, const ARM_BASE *base, LINK_CAPSULE links[2])
+{
+   double armL1, armL2;                     // link lengths
+   double c = cos(degToRad(base->rotDeg)), s = sin(degToRad(base->rotDeg));  // base rotation
+   double theta1, theta12;                  // absolute angles of the links (radians)
+   double xe, ye, xt, yt;                   // elbow and pen tip in the arm frame
+
+   if(tick >= traj->n) tick = traj->n - 1;
+   getLinkLengths(base->robotModel, &armL1, &armL2);
+   theta1 = degToRad(traj->theta[tick][0]);
+   theta12 = theta1 + degToRad(traj->theta[tick][1]);
+   xe = armL1 * cos(theta1);
+   ye = armL1 * sin(theta1);
+   xt = xe + armL2 * cos(theta12);
+   yt = ye + armL2 * sin(theta12);
+
+   links[0].x0 = base->x;
+   links[0].y0 = base->y;
+   links[0].x1 = links[1].x0 = base->x + c * xe - s * ye;
+   links[0].y1 = links[1].y0 = base->y + s * xe + c * ye;
+   links[1].x1 = base->x + c * xt - s * yt;
+   links[1].y1 = base->y + s * xt + c * yt;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Closest distance between two line segments (0 if they cross)
+// INPUTS:  a, b: the segments
+// RETURN:  the distance
+double segmentDistance(const LINK_CAPSULE *a, const LINK_CAPSULE *b)
+{
+   double ux = a->x1 - a->x0, uy = a->y1 - a->y0;   // direction of a
+   double vx = b->x1 - b->x0, vy = b->y1 - b->y0;   // direction of b
+   double wx = a->x0 - b->x0, wy = a->y0 - b->y0;
+   double d1, d2, d, best = 1.0e300, t, px, py, qx, qy;
+   const LINK_CAPSULE *seg[2] = {a, b};
+   int k;
+
+   // proper crossing
+   d = ux * vy - uy * vx;
+   if(d != 0.0)
+   {
+      d1 = (vx * wy - vy * wx) / d;
+      d2 = (ux * wy - uy * wx) / d;
+      if(d1 >= 0.0 && d1 <= 1.0 && d2 >= 0.0 && d2 <= 1.0) return 0.0;
+   }
+
+   // otherwise the closest pair includes an end point of one of them
+   for(k = 0; k < 4; k++)
+   {
+      const LINK_CAPSULE *from = seg[k / 2], *to = seg[1 - k / 2];
+      px = k % 2 == 0 ? from->x0 : from->x1;
+      py = k % 2 == 0 ? from->y0 : from->y1;
+      qx = to->x1 - to->x0;
+      qy = to->y1 - to->y0;
+      d = qx * qx + qy * qy;
+      t = d > 0.0 ? ((px - to->x0) * qx + (py - to->y0) * qy) / d : 0.0;
+      t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+      d = pow(px - (to->x0 + t * qx), 2) + pow(py - (to->y0 + t * qy), 2);
+      if(d < best) best = d;
+   }
+   return sqrt(best);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Bucket of a (time slice, cell) key in the capsule spatial hash
+// INPUTS:  slice, cx, cy: the key
+// RETURN:  the bucket index
+int capsuleHashBucket(int slice, int cx, int cy)
+{
+   unsigned int h = (unsigned int)slice * 73856093u ^ (unsigned int)cx * 19349663u ^ (unsigned int)cy * 83492791u;
+   return (int)(h & (COLLISION_HASH_BUCKETS - 1));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Files every link capsule of a trajectory in a spatial hash keyed by time slice and grid cell.  A capsule goes 
+// into every cell its bounding box (grown by the capsule radius) touches.
+// INPUTS:  traj: the trajectory, base: where its arm is, hash: the hash to build (freed with free())
+// RETURN:  false if out of memory
+bool buildCapsuleHash(const JOINT_TRAJECTORY *traj, const ARM_BASE *base, CAPSULE_HASH *hash)
+{
+   LINK_CAPSULE links[2];
+   int tick, link, cx, cy, cx0, cx1, cy0, cy1, b;
+
+   hash->traj = traj;
+   hash->base = *base;
+   hash->nEntries = hash->capacity = 0;
+   hash->entries = NULL;
+   hash->buckets = (int *)malloc(COLLISION_HASH_BUCKETS * sizeof(int));
+   if(hash->buckets == NULL) return false;
+   for(b = 0; b < COLLISION_HASH_BUCKETS; b++) hash->buckets[b] = -1;
+
+   for(tick = 0; tick < traj->n; tick++)
+   {
+      getArmLinks(traj, tick, base, links);
+      for(link = 0; link < 2; link++)
+      {
+         cx0 = (int)floor((fmin(links[link].x0, links[link].x1) - LINK_CAPSULE_RADIUS) / COLLISION_CELL_SIZE);
+         cx1 = (int)floor((fmax(links[link].x0, links[link].x1) + LINK_CAPSULE_RADIUS) / COLLISION_CELL_SIZE);
+         cy0 = (int)floor((fmin(links[link].y0, links[link].y1) - LINK_CAPSULE_RADIUS) / COLLISION_CELL_SIZE);
+         cy1 = (int)floor((fmax(links[link].y0, links[link].y1) + LINK_CAPSULE_RADIUS) / COLLISION_CELL_SIZE);
+         for(cx = cx0; cx <= cx1; cx++)
+         {
+            for(cy = cy0; cy <= cy1; cy++)
+            {
+               if(hash->nEntries == hash->capacity)
+               {
+                  int capacity = hash->capacity == 0 ? 4096 : 2 * hash->capacity;
+                  CAPSULE_HASH_ENTRY *entries =
+                     (CAPSULE_HASH_ENTRY *)realloc(hash->entries, capacity * sizeof(CAPSULE_HASH_ENTRY));
+                  if(entries == NULL) return false;
+                  hash->entries = entries;
+                  hash->capacity = capacity;
+               }
+               CAPSULE_HASH_ENTRY *e = &hash->entries[hash->nEntries];
+               e->slice = tick / COLLISION_SLICE_TICKS;
+               e->cx = cx;
+               e->cy = cy;
+               e->tick = tick;
+               e->link = link;
+               b = capsuleHashBucket(e->slice, cx, cy);
+               e->next = hash->buckets[b];
+               hash->buckets[b] = hash->nEntries++;
+            }
+         }
+      }
+   }
+   return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks the links of the other arm, at one tick, against the hashed arm within +/- COLLISION_TIME_MARGIN ticks.
+// Ticks past the end of the hashed trajectory check against its last pose (where the arm stays).
+// INPUTS:  hash: the hashed arm, links: the other arm's links, tick: when
+// RETURN:  true if any pair of capsules overlaps
+bool capsuleHashCollides(const CAPSULE_HASH *hash, const LINK_CAPSULE links[2], int tick)
+{
+   int lastTick = hash->traj->n - 1;
+   int t0 = tick - COLLISION_TIME_MARGIN, t1 = tick + COLLISION_TIME_MARGIN;  // ticks of the hashed arm to check
+   int link, cx, cy, cx0, cx1, cy0, cy1, slice, e;
+   LINK_CAPSULE hashed[2];
+
+   if(t0 > lastTick) t0 = t1 = lastTick;
+   else if(t1 > lastTick) t1 = lastTick;
+   if(t0 < 0) t0 = 0;
+
+   for(link = 0; link < 2; link++)
+   {
+      cx0 = (int)floor((fmin(links[link].x0, links[link].x1) - LINK_CAPSULE_RADIUS) / COLLISION_CELL_SIZE);
+      cx1 = (int)floor((fmax(links[link].x0, links[link].x1) + LINK_CAPSULE_RADIUS) / COLLISION_CELL_SIZE);
+      cy0 = (int)floor((fmin(links[link].y0, links[link].y1) - LINK_CAPSULE_RADIUS) / COLLISION_CELL_SIZE);
+      cy1 = (int)floor((fmax(links[link].y0, links[link].y1) + LINK_CAPSULE_RADIUS) / COLLISION_CELL_SIZE);
+      for(slice = t0 / COLLISION_SLICE_TICKS; slice <= t1 / COLLISION_SLICE_TICKS; slice++)
+      {
+         for(cx = cx0; cx <= cx1; cx++)
+         {
+            for(cy = cy0; cy <= cy1; cy++)
+            {
+               for(e = hash->buckets[capsuleHashBucket(slice, cx, cy)]; e != -1; e = hash->entries[e].next)
+               {
+                  const CAPSULE_HASH_ENTRY *entry = &hash->entries[e];
+                  if(entry->slice != slice || entry->cx != cx || entry->cy != cy) continue;  // other key, same bucket
+                  if(entry->tick < t0 || entry->tick > t1) continue;
+
+                  getArmLinks(hash->traj, entry->tick, &hash->base, hashed);
+                  if(segmentDistance(&links[link], &hashed[entry->link]) < 2.0 * LINK_CAPSULE_RADIUS) return true;
+               }
+            }
+         }
+      }
+   }
+   return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Schedules the second arm around the first (which never waits).  Before each setpoint of the second arm, it holds
+// its current pose while moving on would collide with the first arm and holding still doesn't.  If both collide, 
+// the conflict is counted and the second arm moves on anyway.
+// INPUTS:  first: the hashed first arm, second/secondBase: the second arm, schedule: the result (waitBefore is
+//          allocated here, one per setpoint of the second arm)
+// RETURN:  false if out of memory
+bool scheduleSharedWorkspace(const CAPSULE_HASH *first, const JOINT_TRAJECTORY *second, const ARM_BASE *secondBase,
+   SHARED_SCHEDULE *schedule)
+{
+   LINK_CAPSULE moveTo[2], hold[2];  // second arm at its next setpoint, and where it is now
+   int tick = 0, k, wait;            // current tick, setpoint of the second arm, ticks waited for it
+
+   schedule->nWaits = schedule->waitTicks = schedule->nConflicts = 0;
+   schedule->waitBefore = (int *)calloc(second->n > 0 ? second->n : 1, sizeof(int));
+   if(schedule->waitBefore == NULL) return false;
+
+   for(k = 0; k < second->n; k++, tick++)
+   {
+      getArmLinks(second, k, secondBase, moveTo);
+      getArmLinks(second, k > 0 ? k - 1 : 0, secondBase, hold);
+
+      wait = 0;
+      while(capsuleHashCollides(first, moveTo, tick) && wait < MAX_WAIT_TICKS)
+      {
+         if(k == 0 || capsuleHashCollides(first, hold, tick))
+         {
+            schedule->nConflicts++;  // waiting here doesn't help either
+            break;
+         }
+         wait++;
+         tick++;
+      }
+      if(wait > 0)
+      {
+         schedule->waitBefore[k] = wait;
+         schedule->nWaits++;
+         schedule->waitTicks += wait;
+      }
+   }
+
+   schedule->nTicks = tick > first->traj->n ? tick : first->traj->n;
+   return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Shared workspace planner.  Asks for the jobs of two arms and where the second arm's base is (relative to the 
+// first arm's base), unless they are given, plans both without moving the robots and records their joint
+// trajectories.  The links of each arm are swept over its trajectory, and the second arm is made to wait wherever
+// they would collide.  Both orders are tried (each arm gets priority once) and the schedule with the fewest unsolved
+// conflicts, then the fewest ticks, is reported.
+// INPUTS:  initialState: state both robots start in, jobsPath: manifest or directory of the two jobs (NULL to ask
+//          the user), strBase: "x y rotationDeg" of arm B (NULL to ask the user)
+// RETURN:  none
+void runSharedWorkspacePlanner(const SCARA_STATE *initialState, const char *jobsPath, const char *strBase)
+{
+   char fileName[2][MAX_FILENAME_LENGTH] = {};   // job of each arm
+   char strInput[MAX_COMMAND_LENGTH] = {};       // user input
+   JOINT_TRAJECTORY traj[2] = {};                // trajectory of each arm
+   ARM_BASE base[2] = {};                        // base of each arm
+   CAPSULE_HASH hash = {};                       // the arm with priority
+   SHARED_SCHEDULE schedule[2] = {};             // schedule with arm 0 first, with arm 1 first
+   JOB_QUEUE jobs;                               // the two jobs of --jobs
+   int a, k, best;
+
+   if(jobsPath != NULL)
+   {
+      if(!loadJobQueue(jobsPath, &jobs))
+      {
+         programExitCode = 1;
+         return;
+      }
+      if(jobs.nJobs != 2)
+      {
+         printf("Sorry %s has %d job(s), the shared mode needs 2 (arm A, then arm B)\n", jobsPath, jobs.nJobs);
+         free(jobs.fileNames);
+         programExitCode = 1;
+         return;
+      }
+      strcpy_s(fileName[0], jobs.fileNames[0]);
+      strcpy_s(fileName[1], jobs.fileNames[1]);
+      free(jobs.fileNames);
+   }
+   for(a = 0; a < 2; a++)
+   {
+      base[a].robotModel = initialState->robotModel;
+      if(jobsPath != NULL) continue;
+      printf("Please enter the name of the job file of arm %c: \n", 'A' + a);
+      if(fgets(fileName[a], MAX_FILENAME_LENGTH, stdin) == NULL) return;
+      fileName[a][strcspn(fileName[a], "\r\n")] = '\0';
+   }
+   if(strBase == NULL)
+   {
+      printf("Please enter the base of arm B relative to arm A (x y rotationDeg): ");
+      if(fgets(strInput, MAX_COMMAND_LENGTH, stdin) == NULL) return;
+      strBase = strInput;
+   }
+   if(sscanf_s(strBase, "%lf %lf %lf", &base[1].x, &base[1].y, &base[1].rotDeg) != 3)
+   {
+      printf("Sorry expecting 3 numbers\n");
+      programExitCode = 1;
+      return;
+   }
+
+   for(a = 0; a < 2; a++)
+   {
+      if(!captureJointTrajectory(fileName[a], initialState, &traj[a]))
+      {
+         printf("Sorry the file %s could not be open\n", fileName[a]);
+         programExitCode = 1;
+         free(traj[0].theta);
+         free(traj[1].theta);
+         return;
+      }
+      printf("Arm %c: %d setpoints\n", 'A' + a, traj[a].n);
+   }
+
+   // try both priorities: schedule[a] gives arm a priority and makes the other one wait
+   for(a = 0; a < 2; a++)
+   {
+      if(!buildCapsuleHash(&traj[a], &base[a], &hash) ||
+         !scheduleSharedWorkspace(&hash, &traj[1 - a], &base[1 - a], &schedule[a]))
+      {
+         printf("Sorry out of memory planning the shared workspace\n");
+         schedule[a].nConflicts = -1;
+      }
+      free(hash.buckets);
+      free(hash.entries);
+      hash.buckets = NULL;
+      hash.entries = NULL;
+   }
+
+   if(schedule[0].nConflicts < 0 && schedule[1].nConflicts < 0) best = -1;
+   else if(schedule[0].nConflicts < 0) best = 1;
+   else if(schedule[1].nConflicts < 0) best = 0;
+   else if(schedule[0].nConflicts != schedule[1].nConflicts)
+      best = schedule[0].nConflicts < schedule[1].nConflicts ? 0 : 1;
+   else best = schedule[0].nTicks <= schedule[1].nTicks ? 0 : 1;
+
+   if(best >= 0)
+   {
+      printf("Arm %c goes first, arm %c waits %d time(s) for %d tick(s).  Both done after %d ticks.\n",
+         'A' + best, 'B' - best, schedule[best].nWaits, schedule[best].waitTicks, schedule[best].nTicks);
+      for(k = 0; k < traj[1 - best].n; k++)
+      {
+         if(schedule[best].waitBefore[k] > 0)
+            printf("   arm %c waits %d tick(s) before setpoint %d\n", 'B' - best, schedule[best].waitBefore[k], k);
+      }
+      if(schedule[best].nConflicts > 0)
+         printf("WARNING: %d conflict(s) can't be solved by waiting.  Split these jobs by hand.\n",
+            schedule[best].nConflicts);
+   }
+
+   free(schedule[0].waitBefore);
+   free(schedule[1].waitBefore);
+   free(traj[0].theta);
+   free(traj[1].theta);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sets up the points of a moveTo, drawArc, curve or straight line command.  Any other command is a line from
+// (args[0], args[1]) to (args[2], args[3]) (drawRectangle and drawTriangle draw their sides that way).
+// The resolution is the last argument (the first one for drawSpline).
+// INPUTS:  shape: the points to set up, cmd: the parsed command
+// RETURN:  none
+void initShapePoints(SHAPE_POINTS *shape, const PARSED_COMMAND *cmd)
+{
+   const COMMAND_ARGUMENT *args = cmd->args;   // argument values of the command
+   int resolution = args[cmd->index == INDEX_DRAW_SPLINE ? 0 : cmd->nArgs - 1].iValue;  // (not for moveTo)
+   int n;            // number of intermediate points
+
+   shape->index = cmd->index;
+   if(isCurveCommand(cmd->index))
+   {
+      initCurvePoints(shape, cmd, resolution);
+   }
+   else if(cmd->index == INDEX_DRAW_ARC)
+   {
+      shape->xc = args[0].dValue;
+      shape->yc = args[1].dValue;
+      shape->radius = args[2].dValue;
+      shape->thetaStart = degToRad(args[3].dValue);
+      shape->thetaEnd = degToRad(args[4].dValue);
+      shape->nPoints = getN(fabs(shape->radius * (shape->thetaEnd - shape->thetaStart)), resolution);
+   }
+   else if(cmd->index != INDEX_MOVE_TO)
+   {
+      shape->x0 = args[0].dValue;
+      shape->y0 = args[1].dValue;
+      shape->x1 = args[2].dValue;
+      shape->y1 = args[3].dValue;
+      n = getN(sqrt(pow(shape->x1 - shape->x0, 2) + pow(shape->y1 - shape->y0, 2)), resolution);
+      shape->nPoints = n == 0 ? 1 : n + 2;  // just the first point when the line is too short
+   }
+   else  // moveTo
+   {
+      shape->x0 = shape->x1 = args[0].dValue;
+      shape->y0 = shape->y1 = args[1].dValue;
+      shape->nPoints = 1;
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Works out one point of a shape set up by initShapePoints.
+// INPUTS:  shape: the shape, i: point number (0 to nPoints - 1, in between for a point of the shape between two of
+//          its points), x, y: where to store the point
+// RETURN:  none
+void getShapePoint(const SHAPE_POINTS *shape, double i, double *x, double *y)
+{
+   double theta;   // angle of an arc point
+   int p, n;       // curve piece, its first point
+
+   if(isCurveCommand(shape->index))
+   {
+      for(p = 0; p < shape->nPieces - 1 && shape->pieceEnd[p] < i; p++);
+      n = p == 0 ? 0 : shape->pieceEnd[p - 1];  // first point of the piece
+      getCubicPoint(shape->piece[p], (double)(i - n) / (shape->pieceEnd[p] - n), x, y);
+   }
+   else if(shape->index == INDEX_DRAW_ARC)
+   {
+      theta = shape->nPoints > 1 ?
+         shape->thetaStart + (shape->thetaEnd - shape->thetaStart) * ((double)i / (shape->nPoints - 1.0)) :
+         shape->thetaStart;
+      *x = shape->xc + shape->radius * cos(theta);
+      *y = shape->yc + shape->radius * sin(theta);
+   }
+   else if(shape->nPoints > 1)
+   {
+      *x = shape->x0 + (shape->x1 - shape->x0) * (double)i / (shape->nPoints - 1.0);
+      *y = shape->y0 + (shape->y1 - shape->y0) * (double)i / (shape->nPoints - 1.0);
+   }
+   else
+   {
+      *x = shape->x0;
+      *y = shape->y0;
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sets up the pieces of a drawQuadBezier, drawCubicBezier or drawSpline.  Every curve is turned into cubic Bezier
+// spans: a quadratic is raised to the same curve as a cubic, and a spline is a Catmull-Rom curve through its points
+// (one span between each two points, the end points repeated for the end tangents).
+// INPUTS:  shape: the points to set up, cmd: the parsed curve command, resolution: RESOLUTION of the curve
+// RETURN:  none
+void initCurvePoints(SHAPE_POINTS *shape, const PARSED_COMMAND *cmd, int resolution)
+{
+   const COMMAND_ARGUMENT *args = cmd->args;   // argument values of the command
+   double span[4][2];                          // control points of a cubic span
+   double points[MAX_SPLINE_POINTS][2];        // points a spline goes through
+   int nSplinePoints, k, c;                    // number of spline points, point, coordinate
+
+   shape->nPieces = 0;
+   shape->nPoints = 1;  // the first point, then the points after it on each piece
+   if(cmd->index == INDEX_DRAW_SPLINE)
+   {
+      nSplinePoints = (cmd->nArgs - 1) / 2;
+      for(k = 0; k < nSplinePoints; k++)
+      {
+         points[k][0] = args[1 + 2 * k].dValue;
+         points[k][1] = args[2 + 2 * k].dValue;
+      }
+      for(k = 0; k < nSplinePoints - 1; k++)
+      {
+         for(c = 0; c < 2; c++)
+         {
+            span[0][c] = points[k][c];
+            span[1][c] = points[k][c] + (points[k + 1][c] - points[k > 0 ? k - 1 : 0][c]) / 6.0;
+            span[2][c] = points[k + 1][c] - (points[k + 2 < nSplinePoints ? k + 2 : k + 1][c] - points[k][c]) / 6.0;
+            span[3][c] = points[k + 1][c];
+         }
+         addCurvePieces(shape, span, CURVE_PIECES_PER_SPAN, resolution);
+      }
+   }
+   else
+   {
+      for(c = 0; c < 2; c++)
+      {
+         span[0][c] = args[c].dValue;
+         if(cmd->index == INDEX_DRAW_QUAD_BEZIER)
+         {
+            span[1][c] = args[c].dValue + 2.0 / 3.0 * (args[2 + c].dValue - args[c].dValue);
+            span[2][c] = args[4 + c].dValue + 2.0 / 3.0 * (args[2 + c].dValue - args[4 + c].dValue);
+            span[3][c] = args[4 + c].dValue;
+         }
+         else
+         {
+            span[1][c] = args[2 + c].dValue;
+            span[2][c] = args[4 + c].dValue;
+            span[3][c] = args[6 + c].dValue;
+         }
+      }
+      addCurvePieces(shape, span, CURVE_PIECES_PER_SPAN, resolution);
+   }
+
+   shape->x0 = shape->piece[0][0][0];
+   shape->y0 = shape->piece[0][0][1];
+   shape->x1 = shape->piece[shape->nPieces - 1][3][0];
+   shape->y1 = shape->piece[shape->nPieces - 1][3][1];
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds a cubic span to a curve as nPieces pieces (halved at t = 0.5 by de Casteljau), each with as few points as keep
+// it within CURVE_FLATNESS of its chords.  A cubic strays at most 3/4 of the furthest inner control point from its
+// chord, and splitting it in n shrinks that by about n^2, so n = sqrt(3/4 d / flatness) segments is tried first and
+// raised until the middle of every segment is close enough to its chord.  A piece is never given fewer points than
+// drawLine would give its chord, because the robot moves in a joint space arc between two points, not in a straight
+// line.
+// INPUTS:  shape: the curve, b: control points of the span, nPieces: pieces to split it into (power of 2),
+//          resolution: RESOLUTION of the curve
+// RETURN:  none
+void addCurvePieces(SHAPE_POINTS *shape, const double b[4][2], int nPieces, int resolution)
+{
+   double left[4][2], right[4][2];   // halves of the span
+   double chord, d, dMax = 0;        // length of the chord, distance of an inner control point from it
+   int n, nChord, c, k;              // number of segments, segments drawLine would use, coordinate, segment
+
+   if(nPieces > 1)
+   {
+      for(c = 0; c < 2; c++)
+      {
+         left[0][c] = b[0][c];
+         left[1][c] = (b[0][c] + b[1][c]) / 2.0;
+         left[2][c] = (b[0][c] + 2.0 * b[1][c] + b[2][c]) / 4.0;
+         left[3][c] = right[0][c] = (b[0][c] + 3.0 * b[1][c] + 3.0 * b[2][c] + b[3][c]) / 8.0;
+         right[1][c] = (b[1][c] + 2.0 * b[2][c] + b[3][c]) / 4.0;
+         right[2][c] = (b[2][c] + b[3][c]) / 2.0;
+         right[3][c] = b[3][c];
+      }
+      addCurvePieces(shape, left, nPieces / 2, resolution);
+      addCurvePieces(shape, right, nPieces / 2, resolution);
+      return;
+   }
+
+   chord = hypot(b[3][0] - b[0][0], b[3][1] - b[0][1]);
+   for(c = 1; c <= 2; c++)
+   {
+      if(chord > 0.0)
+         d = fabs((b[c][0] - b[0][0]) * (b[3][1] - b[0][1]) - (b[c][1] - b[0][1]) * (b[3][0] - b[0][0])) / chord;
+      else
+         d = hypot(b[c][0] - b[0][0], b[c][1] - b[0][1]);  // closed loop: distance from the end point
+      if(d > dMax) dMax = d;
+   }
+   n = (int)ceil(sqrt(0.75 * dMax / CURVE_FLATNESS[resolution]));
+   if(n < 1) n = 1;
+   for(k = 0; k < n; k++)
+   {
+      if(getCurveSegmentDeviation(b, (double)k / n, (k + 1.0) / n) > CURVE_FLATNESS[resolution])
+      {
+         n++;
+         k = -1;  // check every segment again
+      }
+   }
+   nChord = getN(chord, resolution);
+   if(n < nChord) n = nChord;
+
+   memcpy(shape->piece[shape->nPieces], b, sizeof(shape->piece[0]));
+   shape->nPoints += n;
+   shape->pieceEnd[shape->nPieces] = shape->nPoints - 1;
+   shape->nPieces++;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Works out a point of a cubic Bezier.
+// INPUTS:  b: control points, t: position along the curve (0 to 1), x, y: where to store the point
+// RETURN:  none
+void getCubicPoint(const double b[4][2], double t, double *x, double *y)
+{
+   double u = 1.0 - t;
+
+   *x = u * u * u * b[0][0] + 3.0 * u * u * t * b[1][0] + 3.0 * u * t * t * b[2][0] + t * t * t * b[3][0];
+   *y = u * u * u * b[0][1] + 3.0 * u * u * t * b[1][1] + 3.0 * u * t * t * b[2][1] + t * t * t * b[3][1];
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Distance between the middle of a segment of a cubic Bezier and the chord drawn for it.
+// INPUTS:  b: control points, t0, t1: start and end of the segment (0 to 1)
+// RETURN:  the distance
+double getCurveSegmentDeviation(const double b[4][2], double t0, double t1)
+{
+   double x0, y0, x1, y1, xm, ym;   // ends and middle of the segment
+   double chord;                    // length of the chord
+
+   getCubicPoint(b, t0, &x0, &y0);
+   getCubicPoint(b, t1, &x1, &y1);
+   getCubicPoint(b, (t0 + t1) / 2.0, &xm, &ym);
+   chord = hypot(x1 - x0, y1 - y0);
+   if(chord == 0.0) return hypot(xm - x0, ym - y0);
+   return fabs((xm - x0) * (y1 - y0) - (ym - y0) * (x1 - x0)) / chord;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks which arm can draw every point of a shape and adds up the joint angles of each arm over the points (the
+// same cost drawStraightLine/drawArc use to choose the arm).  The results are combined (and/sum) with the values
+// passed in so a whole path can be checked one shape at a time.  Stops as soon as neither arm can draw the shape.
+// The bounds of the shape are checked first: if they prove the arms still in the running can draw all of it, only
+// its two ends are solved.  The cost only matters when both arms can draw the whole path, and then the left arm's
+// sum is the smaller at every point short of full extension (by twice the angle at the pen of the triangle the
+// links make), so the ends choose the same arm as every point would.
+// INPUTS:  shape, transformMatrix, state: the shape, transform and robot state, pbLeft/pbRight: arm feasibility
+//          so far, pAdderLeft/pAdderRight: arm cost so far
+// RETURN:  none
+void probeShapeArms(const SHAPE_POINTS *shape, double transformMatrix[3][3], const SCARA_STATE *state,
+   bool *pbLeft, bool *pbRight, double *pAdderLeft, double *pAdderRight)
+{
+   INVERSE_SOLUTION isol;   // solution of one point
+   bool bLeftSafe, bRightSafe;  // arms the bounds of the shape prove can draw it
+   double x, y;             // point of the shape
+   int i;                   // point number
+
+   if(!*pbLeft && !*pbRight) return;
+   getSafeArms(shape, transformMatrix, state, &bLeftSafe, &bRightSafe);
+   if((bLeftSafe || !*pbLeft) && (bRightSafe || !*pbRight))
+   {
+      for(i = 0; i < shape->nPoints; i += shape->nPoints > 1 ? shape->nPoints - 1 : 1)  // first and last point
+      {
+         getShapePoint(shape, i, &x, &y);
+         isol = solveInverseKinematics(x, y, transformMatrix, state);
+         *pAdderLeft += isol.theta1DegLeft + isol.theta2DegLeft;
+         *pAdderRight += isol.theta1DegRight + isol.theta2DegRight;
+      }
+      return;
+   }
+
+   for(i = 0; i < shape->nPoints && (*pbLeft || *pbRight); i++)
+   {
+      getShapePoint(shape, i, &x, &y);
+      isol = solveInverseKinematics(x, y, transformMatrix, state);
+      *pbLeft = *pbLeft && isol.bLeft;
+      *pbRight = *pbRight && isol.bRight;
+      *pAdderLeft += isol.theta1DegLeft + isol.theta2DegLeft;
+      *pAdderRight += isol.theta1DegRight + isol.theta2DegRight;
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Works out which arms can draw every point of a shape from its bounds alone.  The pen stays between rMin and rMax
+// of the shoulder, so the elbow bends at most as much as at rMin, and the shoulder is the direction of the pen
+// (betaMin to betaMax) minus (right arm) or plus (left arm) the angle between link 1 and the pen, whose range over
+// rMin to rMax is known.  An arm is only given if all of that is inside the limits with BOUNDS_MARGIN_MM/DEG to
+// spare (covers the FLOAT kinematics); otherwise the points have to be checked.
+// INPUTS:  shape, transformMatrix, state: the shape, transform and robot state, pbLeftSafe/pbRightSafe: where to store
+//          the arms that can draw the whole shape
+// RETURN:  none
+void getSafeArms(const SHAPE_POINTS *shape, double transformMatrix[3][3], const SCARA_STATE *state,
+   bool *pbLeftSafe, bool *pbRightSafe)
+{
+   SHAPE_BOUNDS bounds;                      // region of the shape
+   double l1, l2, lMin, lMax;                // links and reach of the robot
+   double maxTheta1, maxTheta2;              // joint limits (deg)
+   double alpha, alphaMin = DBL_MAX, alphaMax = -DBL_MAX, elbow;  // angle between link 1 and the pen, elbow bend
+   double r, c;                              // distance from the shoulder, cosine of an angle
+   int k;                                    // distance tried
+
+   *pbLeftSafe = *pbRightSafe = false;
+   getReach(state->robotModel, &lMin, &lMax);
+   if(shape->nPoints == 0 || !getShapeBounds(shape, transformMatrix, &bounds)) return;
+   if(bounds.rMin <= 0.0 || bounds.rMax > lMax - BOUNDS_MARGIN_MM) return;
+
+   getLinkLengths(state->robotModel, &l1, &l2);
+   getJointLimits(state->robotModel, &maxTheta1, &maxTheta2);
+   c = (bounds.rMin * bounds.rMin - l1 * l1 - l2 * l2) / (2.0 * l1 * l2);
+   elbow = radToDeg(acos(c < -1.0 ? -1.0 : (c > 1.0 ? 1.0 : c)));
+   if(elbow > maxTheta2 - BOUNDS_MARGIN_DEG) return;
+
+   // the angle between link 1 and the pen is smallest at rMin or rMax and largest there or at sqrt(L1^2 - L2^2)
+   for(k = 0; k < 3; k++)
+   {
+      r = k == 0 ? bounds.rMin : (k == 1 ? bounds.rMax : sqrt(fmax(l1 * l1 - l2 * l2, 0.0)));
+      if(r < bounds.rMin || r > bounds.rMax) continue;
+      c = (r * r + l1 * l1 - l2 * l2) / (2.0 * r * l1);
+      alpha = radToDeg(acos(c < -1.0 ? -1.0 : (c > 1.0 ? 1.0 : c)));
+      if(alpha < alphaMin) alphaMin = alpha;
+      if(alpha > alphaMax) alphaMax = alpha;
+   }
+
+   maxTheta1 -= BOUNDS_MARGIN_DEG;
+   *pbRightSafe = radToDeg(bounds.betaMin) - alphaMax >= -maxTheta1 && radToDeg(bounds.betaMax) - alphaMin <= maxTheta1;
+   *pbLeftSafe = radToDeg(bounds.betaMin) + alphaMin >= -maxTheta1 && radToDeg(bounds.betaMax) + alphaMax <= maxTheta1;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Works out the region a shape stays in after the transform.  Each part of the shape is inside the convex hull of a
+// few points (the ends of a line, the control points of a curve piece, the ends of an arc piece and the corner where
+// their tangents meet), and the transform keeps it inside the hull of the transformed points.
+// INPUTS:  shape, transformMatrix: the shape and transform, bounds: where to store its region
+// RETURN:  false if the shape has no useful bounds (it goes round the shoulder or across the -180/180 deg direction)
+bool getShapeBounds(const SHAPE_POINTS *shape, double transformMatrix[3][3], SHAPE_BOUNDS *bounds)
+{
+   double hull[3][2];                        // hull of a line or arc piece
+   double theta, h, rCorner;                 // start and size of an arc piece, distance of its tangent corner
+   int p, nPieces;                           // piece, number of pieces
+
+   bounds->rMin = DBL_MAX;
+   bounds->rMax = 0.0;
+   bounds->betaMin = PI;
+   bounds->betaMax = -PI;
+
+   if(isCurveCommand(shape->index))
+   {
+      for(p = 0; p < shape->nPieces; p++)
+      {
+         if(!addHullBounds(shape->piece[p], 4, transformMatrix, bounds)) return false;
+      }
+   }
+   else if(shape->index == INDEX_DRAW_ARC)
+   {
+      nPieces = (int)ceil(fabs(shape->thetaEnd - shape->thetaStart) / degToRad(BOUNDS_ARC_STEP_DEG));
+      if(nPieces < 1) nPieces = 1;
+      h = (shape->thetaEnd - shape->thetaStart) / nPieces;
+      rCorner = shape->radius / cos(h / 2.0);
+      for(p = 0; p < nPieces; p++)
+      {
+         theta = shape->thetaStart + h * p;
+         hull[0][0] = shape->xc + shape->radius * cos(theta);
+         hull[0][1] = shape->yc + shape->radius * sin(theta);
+         hull[1][0] = shape->xc + rCorner * cos(theta + h / 2.0);
+         hull[1][1] = shape->yc + rCorner * sin(theta + h / 2.0);
+         hull[2][0] = shape->xc + shape->radius * cos(theta + h);
+         hull[2][1] = shape->yc + shape->radius * sin(theta + h);
+         if(!addHullBounds(hull, 3, transformMatrix, bounds)) return false;
+      }
+   }
+   else  // line (or just its first point) and moveTo
+   {
+      hull[0][0] = shape->x0;  hull[0][1] = shape->y0;
+      hull[1][0] = shape->x1;  hull[1][1] = shape->y1;
+      return addHullBounds(hull, shape->nPoints > 1 ? 2 : 1, transformMatrix, bounds);
+   }
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Widens the region of a shape to take in the convex hull of n points (after the transform).  The hull is furthest
+// from the shoulder at one of the points and, if the points are all within half a turn of each other as seen from
+// the shoulder, closest to it on one of the edges between them.
+// INPUTS:  hull, n: the points (1 to 4), transformMatrix, bounds: the region so far
+// RETURN:  false if there are no points or the hull goes round the shoulder or across the -180/180 deg direction
+bool addHullBounds(const double hull[][2], int n, double transformMatrix[3][3], SHAPE_BOUNDS *bounds)
+{
+   double p[4][2];                           // transformed points
+   double beta0, dBeta, dMin = 0.0, dMax = 0.0;  // direction of the first point, of the others relative to it
+   double dx, dy, t, d;                      // edge, its closest point to the shoulder and distance to it
+   int i, j;                                 // points
+
+   if(n < 1) return false;
+   for(i = 0; i < n; i++)
+   {
+      p[i][0] = transformMatrix[0][0] * hull[i][0] + transformMatrix[0][1] * hull[i][1] + transformMatrix[0][2];
+      p[i][1] = transformMatrix[1][0] * hull[i][0] + transformMatrix[1][1] * hull[i][1] + transformMatrix[1][2];
+      d = hypot(p[i][0], p[i][1]);
+      if(d > bounds->rMax) bounds->rMax = d;
+   }
+
+   beta0 = atan2(p[0][1], p[0][0]);
+   for(i = 1; i < n; i++)
+   {
+      dBeta = atan2(p[i][1], p[i][0]) - beta0;
+      if(dBeta > PI) dBeta -= 2.0 * PI;
+      else if(dBeta <= -PI) dBeta += 2.0 * PI;
+      if(dBeta < dMin) dMin = dBeta;
+      if(dBeta > dMax) dMax = dBeta;
+   }
+   if(dMax - dMin >= PI || beta0 + dMin <= -PI || beta0 + dMax >= PI) return false;
+   if(beta0 + dMin < bounds->betaMin) bounds->betaMin = beta0 + dMin;
+   if(beta0 + dMax > bounds->betaMax) bounds->betaMax = beta0 + dMax;
+
+   for(i = 0; i < n; i++)
+   {
+      for(j = i; j < n; j++)  // j == i: the point itself
+      {
+         dx = p[j][0] - p[i][0];
+         dy = p[j][1] - p[i][1];
+         t = dx == 0.0 && dy == 0.0 ? 0.0 : -(p[i][0] * dx + p[i][1] * dy) / (dx * dx + dy * dy);
+         t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+         d = hypot(p[i][0] + t * dx, p[i][1] + t * dy);
+         if(d < bounds->rMin) bounds->rMin = d;
+      }
+   }
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks if a command can be part of a path drawn without lifting the pen (moveTo, drawLine, drawArc and the curves).
+// INPUTS:  index: command index
+// RETURN:  true if it can
+bool isPathCommand(int index)
+{
+   return index == INDEX_MOVE_TO || index == INDEX_DRAW_LINE || index == INDEX_DRAW_ARC || isCurveCommand(index);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks if a command is a curve (drawQuadBezier, drawCubicBezier or drawSpline).
+// INPUTS:  index: command index
+// RETURN:  true if it is
+bool isCurveCommand(int index)
+{
+   return index == INDEX_DRAW_QUAD_BEZIER || index == INDEX_DRAW_CUBIC_BEZIER || index == INDEX_DRAW_SPLINE;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets the first and last point of a moveTo, drawLine, drawArc or curve command.
+// INPUTS:  cmd: the parsed command, xs, ys, xe, ye: where to store the start and end points
+// RETURN:  none
+void getPathEnds(const PARSED_COMMAND *cmd, double *xs, double *ys, double *xe, double *ye)
+{
+   const COMMAND_ARGUMENT *args = cmd->args;   // argument values of the command
+   int first = cmd->index == INDEX_DRAW_SPLINE ? 1 : 0;   // first point of a curve (after a spline's resolution)
+   int last = cmd->index == INDEX_DRAW_SPLINE ? cmd->nArgs - 2 : cmd->nArgs - 3;  // last point of a curve
+
+   if(cmd->index == INDEX_DRAW_ARC)
+   {
+      *xs = args[0].dValue + args[2].dValue * cos(degToRad(args[3].dValue));
+      *ys = args[1].dValue + args[2].dValue * sin(degToRad(args[3].dValue));
+      *xe = args[0].dValue + args[2].dValue * cos(degToRad(args[4].dValue));
+      *ye = args[1].dValue + args[2].dValue * sin(degToRad(args[4].dValue));
+   }
+   else if(isCurveCommand(cmd->index))
+   {
+      *xs = args[first].dValue;
+      *ys = args[first + 1].dValue;
+      *xe = args[last].dValue;
+      *ye = args[last + 1].dValue;
+   }
+   else if(cmd->index == INDEX_DRAW_LINE)
+   {
+      *xs = args[0].dValue;
+      *ys = args[1].dValue;
+      *xe = args[2].dValue;
+      *ye = args[3].dValue;
+   }
+   else
+   {
+      *xs = *xe = args[0].dValue;
+      *ys = *ye = args[1].dValue;
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds a parsed command to the end of the lookahead queue.  The queue must not be full.
+// INPUTS:  queue: the lookahead queue, cmd: the parsed command (copied)
+// RETURN:  none
+void lookaheadPush(LOOKAHEAD_QUEUE *queue, const PARSED_COMMAND *cmd)
+{
+   LOOKAHEAD_ENTRY *entry = &queue->entries[(queue->head + queue->count) % LOOKAHEAD_DEPTH];
+
+   entry->cmd = *cmd;
+   entry->tsQueued = traceNow();
+   queue->count++;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks if the oldest queued command should run now.  Commands that aren't part of a path and segments continuing
+// the path being drawn run straight away.  The first segment of a path waits until the queue shows where the path
+// ends, the queue is full or it has waited LOOKAHEAD_MAX_LATENCY_MS.
+// INPUTS:  queue: the lookahead queue, state: robot state, bFlush: true to run everything queued
+// RETURN:  true if the oldest command should run now
+bool lookaheadHeadReady(const LOOKAHEAD_QUEUE *queue, const SCARA_STATE *state, bool bFlush)
+{
+   const LOOKAHEAD_ENTRY *entry;   // queued command
+   double xs, ys, xe, ye;          // start and end of a path command
+   double xEnd, yEnd;              // end of the path so far
+   int k;                          // queue position
+
+   if(queue->count == 0) return false;
+   if(bFlush || queue->count == LOOKAHEAD_DEPTH) return true;
+
+   entry = &queue->entries[queue->head];
+   if(!isPathCommand(entry->cmd.index)) return true;
+
+   getPathEnds(&entry->cmd, &xs, &ys, &xEnd, &yEnd);
+   if(queue->bInPath && state->penPos == PEN_DOWN && fabs(xs - state->currentPos.x) <= PATH_JOIN_TOLERANCE &&
+      fabs(ys - state->currentPos.y) <= PATH_JOIN_TOLERANCE) return true;   // the path's arm is already chosen
+   if(traceNow() - entry->tsQueued >= LOOKAHEAD_MAX_LATENCY_MS * 1000.0) return true;
+
+   // the whole path is known once a queued command doesn't continue it
+   for(k = 1; k < queue->count; k++)
+   {
+      entry = &queue->entries[(queue->head + k) % LOOKAHEAD_DEPTH];
+      if(!isPathCommand(entry->cmd.index)) return true;
+      getPathEnds(&entry->cmd, &xs, &ys, &xe, &ye);
+      if(fabs(xs - xEnd) > PATH_JOIN_TOLERANCE || fabs(ys - yEnd) > PATH_JOIN_TOLERANCE) return true;
+      xEnd = xe;
+      yEnd = ye;
+   }
+   return false;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Runs the oldest queued command.  When it starts a path, the arm that can draw as much of the queued path as
+// possible (the cheapest one if both can) is kept for the whole path, and segments continuing the path are drawn
+// without lifting the pen and going back to their first point.
+// INPUTS:  queue: the lookahead queue (not empty), state, transformMatrix: as for executeCommand
+// RETURN:  none
+void lookaheadRunHead(LOOKAHEAD_QUEUE *queue, SCARA_STATE *state, double transformMatrix[3][3])
+{
+   LOOKAHEAD_ENTRY entry = queue->entries[queue->head];   // command to run
+   const LOOKAHEAD_ENTRY *next;                           // queued command after it
+   SHAPE_POINTS shape;                                    // points of a path command
+   bool bLeft = true, bRight = true, bLeftNext, bRightNext;      // arms that can draw the path
+   double adderLeft = 0, adderRight = 0, adderLeftNext, adderRightNext;   // cost of each arm over the path
+   double xs, ys, xe, ye, xEnd, yEnd;                     // start and end of path commands
+   bool bContinues;                                       // true if the command continues the path being drawn
+   int k;                                                 // queue position
+
+   queue->head = (queue->head + 1) % LOOKAHEAD_DEPTH;
+   queue->count--;
+
+   if(isPathCommand(entry.cmd.index))
+   {
+      getPathEnds(&entry.cmd, &xs, &ys, &xEnd, &yEnd);
+      bContinues = queue->bInPath && state->penPos == PEN_DOWN && fabs(xs - state->currentPos.x) <= PATH_JOIN_TOLERANCE
+         && fabs(ys - state->currentPos.y) <= PATH_JOIN_TOLERANCE;
+      if(!bContinues)
+      {
+         // new path: check the arms over the command and the queued commands that continue it
+         initShapePoints(&shape, &entry.cmd);
+         probeShapeArms(&shape, transformMatrix, state, &bLeft, &bRight, &adderLeft, &adderRight);
+         for(k = 0; k < queue->count && (bLeft || bRight); k++)
+         {
+            next = &queue->entries[(queue->head + k) % LOOKAHEAD_DEPTH];
+            if(!isPathCommand(next->cmd.index)) break;
+            getPathEnds(&next->cmd, &xs, &ys, &xe, &ye);
+            if(fabs(xs - xEnd) > PATH_JOIN_TOLERANCE || fabs(ys - yEnd) > PATH_JOIN_TOLERANCE) break;
+            bLeftNext = bLeft;
+            bRightNext = bRight;
+            adderLeftNext = adderLeft;
+            adderRightNext = adderRight;
+            initShapePoints(&shape, &next->cmd);
+            probeShapeArms(&shape, transformMatrix, state, &bLeftNext, &bRightNext, &adderLeftNext, &adderRightNext);
+            if(!bLeftNext && !bRightNext) break;  // neither arm can go further, the path will change arm here
+            bLeft = bLeftNext;
+            bRight = bRightNext;
+            adderLeft = adderLeftNext;
+            adderRight = adderRightNext;
+            xEnd = xe;
+            yEnd = ye;
+         }
+         if(bLeft && bRight) state->pathArm = adderLeft < adderRight ? LEFT_ARM : RIGHT_ARM;
+         else state->pathArm = bLeft ? LEFT_ARM : (bRight ? RIGHT_ARM : NO_ARM);
+      }
+      state->bJoinPath = bContinues;
+      queue->bInPath = true;
+   }
+   else
+   {
+      state->pathArm = NO_ARM;
+      queue->bInPath = false;
+   }
+
+   next = queue->count > 0 ? &queue->entries[queue->head] : NULL;
+   pNextSegment = next != NULL && isPathCommand(next->cmd.index) ? &next->cmd : NULL;  // its corner may be blended
+   executeCommand(&entry.cmd, state, transformMatrix);
+   pNextSegment = NULL;
+   state->bJoinPath = false;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Input thread of the streaming mode.  Reads lines from stdin into the line queue (waiting while it is full) until
+// the quit line or the end of the input.
+// INPUTS:  input: the line queue
+// RETURN:  none
+void readInputLines(INPUT_LINE_QUEUE *input)
+{
+   char strLine[MAX_COMMAND_LENGTH];   // line read
+   bool bQuit = false;                 // true after the quit line
+
+   while(!bQuit && fgets(strLine, MAX_COMMAND_LENGTH, stdin) != NULL)
+   {
+      bQuit = toupper(strLine[0]) == 'Q' && strlen(strLine) == 2;
+
+      std::unique_lock<std::mutex> lock(input->lock);
+      while(input->count == INPUT_QUEUE_DEPTH) input->cvChanged.wait(lock);
+      strcpy_s(input->lines[(input->head + input->count) % INPUT_QUEUE_DEPTH], MAX_COMMAND_LENGTH, strLine);
+      input->count++;
+      input->cvChanged.notify_all();
+   }
+
+   std::lock_guard<std::mutex> lock(input->lock);
+   input->bEnd = true;
+   input->cvChanged.notify_all();
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Runs commands typed or piped in, holding back up to LOOKAHEAD_DEPTH of them (never longer than
+// LOOKAHEAD_MAX_LATENCY_MS) so that lines and arcs joined end to end are drawn as one path: one arm for the whole
+// path and no pen lifts at the joints.  An empty line runs everything queued.
+// INPUTS:  state, transformMatrix: as for executeCommand
+// RETURN:  none
+void runStreamingCommands(SCARA_STATE *state, double transformMatrix[3][3])
+{
+   static INPUT_LINE_QUEUE input;               // lines read by the input thread
+   LOOKAHEAD_QUEUE queue = {};                  // commands held back
+   char strCommand[MAX_COMMAND_LENGTH];         // line being handled
+   char strErrorMsg[MAX_MESSAGE_LENGTH] = {};   // error message of parseCommand
+   PARSED_COMMAND cmd;                          // the parsed command
+   int index;                                   // index of the parsed command
+   bool bLine, bEnd = false, bFlush;            // line taken from the queue, end of input, run everything queued
+   double waitUs;                               // time left before the oldest queued command must run
+
+   input.head = input.count = 0;
+   input.bEnd = false;
+   std::thread reader(readInputLines, &input);
+
+   printf("Streaming mode: commands wait up to %.0f ms so joined lines and arcs are drawn as one path.\n",
+      LOOKAHEAD_MAX_LATENCY_MS);
+   printf("Please enter commands with argument values (type Q to quit, H for help or an empty line to run all)\n");
+
+   while(!bEnd)
+   {
+      bLine = false;
+      {
+         std::unique_lock<std::mutex> lock(input.lock);
+         if(input.count == 0 && !input.bEnd)
+         {
+            if(queue.count > 0)
+            {
+               waitUs = queue.entries[queue.head].tsQueued + LOOKAHEAD_MAX_LATENCY_MS * 1000.0 - traceNow();
+               if(waitUs > 0) input.cvChanged.wait_for(lock, std::chrono::microseconds((long long)waitUs));
+            }
+            else input.cvChanged.wait(lock);
+         }
+         if(input.count > 0)
+         {
+            strcpy_s(strCommand, MAX_COMMAND_LENGTH, input.lines[input.head]);
+            input.head = (input.head + 1) % INPUT_QUEUE_DEPTH;
+            input.count--;
+            input.cvChanged.notify_all();
+            bLine = true;
+         }
+         else bEnd = input.bEnd;
+      }
+
+      bFlush = bEnd;
+      if(bLine)
+      {
+         if(toupper(strCommand[0]) == 'Q' && strlen(strCommand) == 2) bFlush = bEnd = true;
+         else if(toupper(strCommand[0]) == 'H' && strlen(strCommand) == 2) help();
+         else if(isBlankLine(strCommand)) bFlush = true;
+         else if(!isCommentLine(strCommand))
+         {
+            index = parseCommand(strCommand, &cmd, strErrorMsg, -1);
+            if(index == -1) printf("%s\n", strErrorMsg);
+            else
+            {
+               printf("%s is a valid command! (index = %d)\n", strCommand, index);
+               if(queue.count == LOOKAHEAD_DEPTH) lookaheadRunHead(&queue, state, transformMatrix);
+               lookaheadPush(&queue, &cmd);
+            }
+         }
+      }
+
+      while(lookaheadHeadReady(&queue, state, bFlush)) lookaheadRunHead(&queue, state, transformMatrix);
+   }
+
+   reader.join();
+   state->pathArm = NO_ARM;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes the robot state report of queryState (position, angles, arm configuration and robot model).
+// INPUTS:  state: robot state, strState: where to write the report, size: size of strState
+// RETURN:  none
+void formatState(const SCARA_STATE *state, char *strState, size_t size)
+{
+   const char *strArm;   // name of the arm configuration
+
+   if(state->currentPos.armPos == LEFT_ARM) strArm = "LEFT_ARM";
+   else if(state->currentPos.armPos == RIGHT_ARM) strArm = "RIGHT_ARM";
+   else strArm = "NO_ARM";
+
+   sprintf_s(strState, size, "Current Position x: %.2lf y: %.2lf\n"
+      "Current Angles Theta1: %.2lf Theta2: %.2lf\n"
+      "Current Arm Configuration: %s\n"
+      "Robot Model: %s\n",
+      state->currentPos.x, state->currentPos.y, state->currentPos.theta1Deg, state->currentPos.theta2Deg, strArm,
+      state->robotModel == ROBOT_MODEL_PROFILE ? robotProfile.name : STR_ROBOT_MODELS[state->robotModel]);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Opens the non-blocking listening socket of the server mode on 127.0.0.1 (only local programs can connect).
+// INPUTS:  port: TCP port
+// RETURN:  the socket, or INVALID_SOCKET if it could not be opened
+SOCKET_HANDLE serverOpen(unsigned short port)
+{
+   SOCKET_HANDLE sock;         // listening socket
+   sockaddr_in address = {};   // 127.0.0.1:port
+   int reuse = 1;              // lets the server restart straight away on the same port
+
+#ifdef _WIN32
+   WSADATA wsaData;
+   if(WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return INVALID_SOCKET;
+#endif
+
+   sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+   if(sock == INVALID_SOCKET) return INVALID_SOCKET;
+   setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+
+   address.sin_family = AF_INET;
+   address.sin_port = htons(port);
+   address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   if(bind(sock, (sockaddr *)&address, sizeof(address)) != 0 || listen(sock, MAX_SERVER_CLIENTS) != 0)
+   {
+      closeSocket(sock);
+      return INVALID_SOCKET;
+   }
+   return sock;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Adds a reply to the send buffer of a client.  The buffer is sent when the socket can take it.  Replies that don't
+// fit are cut (clients aren't read while their buffer is over SERVER_REPLY_HIGH_WATER, so this doesn't happen to a
+// client that reads its replies).
+// INPUTS:  client: the connection, strReply: the text to send
+// RETURN:  none
+void serverQueueReply(SERVER_CLIENT *client, const char *strReply)
+{
+   size_t len = strlen(strReply);   // length of the reply
+
+   if(client->sock == INVALID_SOCKET || client->bBroken) return;
+   if(len > SERVER_REPLY_BUFFER - client->outUsed) len = SERVER_REPLY_BUFFER - client->outUsed;
+   memcpy(client->outBuf + client->outUsed, strReply, len);
+   client->outUsed += len;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Checks if a line is just a keyword (any case), with nothing but whitespace around it.
+// INPUTS:  strLine: the line, keyword: the keyword
+// RETURN:  true if it is
+bool isKeywordLine(const char *strLine, const char *keyword)
+{
+   size_t len = strlen(keyword);   // length of the keyword
+
+   while(isspace((unsigned char)*strLine)) strLine++;
+   if(_strnicmp(strLine, keyword, len) != 0) return false;
+   return isBlankLine(strLine + len);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Splits the received bytes of a client into lines and queues the commands.  Lines can arrive in any number of
+// pieces; an incomplete line stays in the buffer until the rest arrives.  Stops when the server queue is full (the
+// rest is handled once the queue has room).  Invalid commands are answered with ERROR straight away, and so is
+// queryState (it reports the robot as it is, even part way through a shape).
+// INPUTS:  clients: the connections, c: slot of the client, state: robot state,
+//          queue: server queue, pbStop: set to true when the client asks the server to stop, pbCancel: set to
+//          true when the client asks to stop drawing
+// RETURN:  none
+void serverReadLines(SERVER_CLIENT *clients, int c, const SCARA_STATE *state,
+   SERVER_QUEUE *queue, bool *pbStop, bool *pbCancel)
+{
+   SERVER_CLIENT *client = &clients[c];         // the client
+   char strLine[MAX_COMMAND_LENGTH];            // a complete line
+   char strReply[2 * MAX_MESSAGE_LENGTH];       // answer to an invalid line
+   char strErrorMsg[MAX_MESSAGE_LENGTH] = {};   // error message of parseCommand
+   char *pEnd;                                  // end of the first line in the buffer
+   size_t len;                                  // length of the line, including '\n'
+   SERVER_JOB *job;                             // queued command (parsed straight into the queue)
+   int index;                                   // index of the parsed command
+
+   while(queue->count < SERVER_QUEUE_DEPTH && !client->bQuit &&
+      (pEnd = (char *)memchr(client->inBuf, '\n', client->inUsed)) != NULL)
+   {
+      len = pEnd - client->inBuf + 1;
+      if(client->bDiscarding)  // rest of a line that was too long
+      {
+         client->bDiscarding = false;
+         memmove(client->inBuf, client->inBuf + len, client->inUsed - len);
+         client->inUsed -= len;
+         continue;
+      }
+
+      client->lineNumber++;
+      if(len < MAX_COMMAND_LENGTH)
+      {
+         memcpy(strLine, client->inBuf, len);
+         strLine[len] = '\0';
+      }
+      else strLine[0] = '\0';  // the line doesn't fit a command, answered below
+      memmove(client->inBuf, client->inBuf + len, client->inUsed - len);
+      client->inUsed -= len;
+      if(len >= 2 && strLine[len - 2] == '\r')  // lines from windows programs end with \r\n
+      {
+         strLine[len - 2] = '\n';
+         strLine[len - 1] = '\0';
+      }
+
+      if(len >= MAX_COMMAND_LENGTH)
+      {
+         sprintf_s(strReply, "ERROR %d line is too long\n", client->lineNumber);
+         serverQueueReply(client, strReply);
+      }
+      else if(isBlankLine(strLine) || isCommentLine(strLine)) continue;
+      else if(isKeywordLine(strLine, STR_SERVER_QUIT)) client->bQuit = true;
+      else if(isKeywordLine(strLine, STR_SERVER_STOP))
+      {
+         *pbStop = true;
+         client->bQuit = true;
+      }
+      else if(isKeywordLine(strLine, STR_SERVER_CANCEL)) *pbCancel = true;
+      else
+      {
+         job = &queue->jobs[(queue->head + queue->count) % SERVER_QUEUE_DEPTH];
+         index = parseCommand(strLine, &job->cmd, strErrorMsg, client->lineNumber);
+         if(index == -1)
+         {
+            sprintf_s(strReply, "ERROR %d %s\n", client->lineNumber, strErrorMsg);
+            serverQueueReply(client, strReply);
+         }
+         else if(index == INDEX_QUERY_STATE)
+         {
+            formatState(state, strReply, sizeof(strReply));
+            serverQueueReply(client, strReply);
+            sprintf_s(strReply, "OK %d %s\n", client->lineNumber, SCARA_COMMANDS[index].cmdName);
+            serverQueueReply(client, strReply);
+         }
+         else
+         {
+            job->client = c;
+            queue->count++;
+            client->nQueued++;
+         }
+      }
+   }
+
+   // a full buffer without a line end: the line is too long, skip it up to its end
+   if(client->inUsed == SERVER_INPUT_BUFFER && memchr(client->inBuf, '\n', client->inUsed) == NULL)
+   {
+      client->bDiscarding = true;
+      client->inUsed = 0;
+      client->lineNumber++;
+      sprintf_s(strReply, "ERROR %d line is too long\n", client->lineNumber);
+      serverQueueReply(client, strReply);
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Server mode.  Other programs connect to 127.0.0.1:SERVER_PORT and send commands, one per line, exactly as they
+// would be typed.  Every command is answered on its connection: "OK <line> <command>" once it has run (queryState
+// sends the state report first), "ERROR <line> <message>" as soon as it is found to be invalid, or
+// "CANCELLED <line> <command>" if it was stopped.  A line "Q" closes the connection, "STOP" stops the shape being
+// drawn (lifting the pen) and drops every queued command, and "STOP_SERVER" ends the server mode once every queued
+// command has run.
+// The sockets are multiplexed with select (available on both Winsock and POSIX).  At most SERVER_QUEUE_DEPTH
+// commands wait to run; while the queue is full (or a client doesn't read its replies) the clients aren't read, so
+// TCP flow control makes the senders wait.  Shapes are drawn with a DRAW_STEPPER that gets SERVER_STEP_CREDIT robot
+// commands per pass, so the connections are served (queryState answered, STOP seen) while a shape is drawn.
+// INPUTS:  state, transformMatrix: as for executeCommand
+// RETURN:  none
+void runServerCommands(SCARA_STATE *state, double transformMatrix[3][3])
+{
+   static SERVER_CLIENT clients[MAX_SERVER_CLIENTS];   // connections (static: the buffers are big)
+   static SERVER_QUEUE queue;                  // commands waiting to run
+   SOCKET_HANDLE listenSock, sock;             // listening socket, new connection
+   fd_set readSet, writeSet;                   // sockets to wait for
+   timeval timeout;                            // how long select waits
+   SERVER_JOB job, drawJob;                    // command being run, shape being drawn
+   DRAW_STEPPER stepper;                       // draws drawJob
+   bool bDrawing = false;                      // true while a shape is being drawn
+   char strReply[2 * MAX_MESSAGE_LENGTH];      // answer to a command
+   bool bStop = false, bCancel = false;        // true once a client asked the server to stop, or to stop drawing
+   int c, k, nClients, maxSock, n;             // client slot, credit used, open connections, for select, bytes
+
+   listenSock = serverOpen(SERVER_PORT);
+   if(listenSock == INVALID_SOCKET)
+   {
+      printf("Sorry the server could not listen on port %d\n", SERVER_PORT);
+      return;
+   }
+   for(c = 0; c < MAX_SERVER_CLIENTS; c++) clients[c].sock = INVALID_SOCKET;
+   queue.head = queue.count = 0;
+   printf("Server mode: listening on 127.0.0.1:%d (send %s to stop the server)\n", SERVER_PORT, STR_SERVER_STOP);
+
+   nClients = 0;
+   while(!bStop || queue.count > 0 || bDrawing || nClients > 0)
+   {
+      FD_ZERO(&readSet);
+      FD_ZERO(&writeSet);
+      maxSock = 0;
+      if(!bStop && nClients < MAX_SERVER_CLIENTS)
+      {
+         FD_SET(listenSock, &readSet);
+         maxSock = (int)listenSock;
+      }
+      for(c = 0; c < MAX_SERVER_CLIENTS; c++)
+      {
+         if(clients[c].sock == INVALID_SOCKET) continue;
+         // backpressure: don't read while the queue is full or the client isn't reading its replies
+         if(!clients[c].bQuit && !clients[c].bEndOfStream && queue.count < SERVER_QUEUE_DEPTH &&
+            clients[c].outUsed < SERVER_REPLY_HIGH_WATER && clients[c].inUsed < SERVER_INPUT_BUFFER)
+            FD_SET(clients[c].sock, &readSet);
+         if(clients[c].outUsed > 0) FD_SET(clients[c].sock, &writeSet);
+         if((int)clients[c].sock > maxSock) maxSock = (int)clients[c].sock;
+      }
+
+      // don't wait while there are commands to run
+      timeout.tv_sec = queue.count > 0 || bDrawing ? 0 : 1;
+      timeout.tv_usec = 0;
+      if(select(maxSock + 1, &readSet, &writeSet, NULL, &timeout) < 0) break;
+
+      if(FD_ISSET(listenSock, &readSet) && (sock = accept(listenSock, NULL, NULL)) != INVALID_SOCKET)
+      {
+         for(c = 0; clients[c].sock != INVALID_SOCKET; c++);  // free slot (there is one, see above)
+#ifdef _WIN32
+         u_long nonBlocking = 1;
+         ioctlsocket(sock, FIONBIO, &nonBlocking);
+#else
+         fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+         clients[c].sock = sock;
+         clients[c].inUsed = clients[c].outUsed = 0;
+         clients[c].bDiscarding = clients[c].bQuit = clients[c].bEndOfStream = clients[c].bBroken = false;
+         clients[c].lineNumber = clients[c].nQueued = 0;
+         nClients++;
+      }
+
+      for(c = 0; c < MAX_SERVER_CLIENTS; c++)
+      {
+         if(clients[c].sock == INVALID_SOCKET) continue;
+         if(FD_ISSET(clients[c].sock, &writeSet))
+         {
+            n = send(clients[c].sock, clients[c].outBuf, (int)clients[c].outUsed, SEND_FLAGS);
+            if(n > 0)
+            {
+               memmove(clients[c].outBuf, clients[c].outBuf + n, clients[c].outUsed - n);
+               clients[c].outUsed -= n;
+            }
+            else
+            {
+               clients[c].bBroken = clients[c].bEndOfStream = true;  // the client went away
+               clients[c].outUsed = 0;
+            }
+         }
+         if(FD_ISSET(clients[c].sock, &readSet))
+         {
+            n = recv(clients[c].sock, clients[c].inBuf + clients[c].inUsed,
+               (int)(SERVER_INPUT_BUFFER - clients[c].inUsed), 0);
+            if(n > 0) clients[c].inUsed += n;
+            else clients[c].bEndOfStream = true;  // complete lines already received are still run
+         }
+      }
+
+      // lines left over while the queue was full are handled first (round robin over the clients)
+      for(c = 0; c < MAX_SERVER_CLIENTS; c++)
+      {
+         if(clients[c].sock != INVALID_SOCKET)
+            serverReadLines(clients, c, state, &queue, &bStop, &bCancel);
+      }
+
+      if(bCancel)  // stop the shape being drawn and drop everything queued
+      {
+         if(bDrawing)
+         {
+            cancelDrawStepper(&stepper, state);
+            flushRobotStream();
+            sprintf_s(strReply, "CANCELLED %d %s\n", drawJob.cmd.lineNumber,
+               SCARA_COMMANDS[drawJob.cmd.index].cmdName);
+            serverQueueReply(&clients[drawJob.client], strReply);
+            clients[drawJob.client].nQueued--;
+            bDrawing = false;
+         }
+         for(; queue.count > 0; queue.count--)
+         {
+            job = queue.jobs[queue.head];
+            queue.head = (queue.head + 1) % SERVER_QUEUE_DEPTH;
+            sprintf_s(strReply, "CANCELLED %d %s\n", job.cmd.lineNumber, SCARA_COMMANDS[job.cmd.index].cmdName);
+            serverQueueReply(&clients[job.client], strReply);
+            clients[job.client].nQueued--;
+         }
+         bCancel = false;
+      }
+
+      // start the next command: shapes are drawn step by step below, anything else runs at once
+      if(!bDrawing && queue.count > 0)
+      {
+         job = queue.jobs[queue.head];
+         queue.head = (queue.head + 1) % SERVER_QUEUE_DEPTH;
+         queue.count--;
+
+         if(isPathCommand(job.cmd.index))
+         {
+            initDrawStepper(&stepper, &job.cmd, transformMatrix, state);
+            drawJob = job;
+            bDrawing = true;
+         }
+         else
+         {
+            pReplyClient = &clients[job.client];
+            executeCommand(&job.cmd, state, transformMatrix);
+            pReplyClient = NULL;
+            sprintf_s(strReply, "OK %d %s\n", job.cmd.lineNumber, SCARA_COMMANDS[job.cmd.index].cmdName);
+            serverQueueReply(&clients[job.client], strReply);
+            clients[job.client].nQueued--;
+         }
+      }
+
+      // the shape being drawn sends up to SERVER_STEP_CREDIT commands, then the connections are served again
+      for(k = 0; bDrawing && k < SERVER_STEP_CREDIT; k++)
+      {
+         if(drawStep(&stepper, transformMatrix, state)) continue;
+         flushRobotStream();
+         sprintf_s(strReply, "OK %d %s\n", drawJob.cmd.lineNumber, SCARA_COMMANDS[drawJob.cmd.index].cmdName);
+         serverQueueReply(&clients[drawJob.client], strReply);
+         clients[drawJob.client].nQueued--;
+         bDrawing = false;
+      }
+
+      // close the connections that are done: quit or closed with every line handled, command run and reply sent
+      for(c = 0; c < MAX_SERVER_CLIENTS; c++)
+      {
+         if(clients[c].sock == INVALID_SOCKET || clients[c].nQueued > 0 || clients[c].outUsed > 0) continue;
+         if(!clients[c].bQuit && !(clients[c].bEndOfStream &&
+            memchr(clients[c].inBuf, '\n', clients[c].inUsed) == NULL)) continue;
+         closeSocket(clients[c].sock);
+         clients[c].sock = INVALID_SOCKET;
+         nClients--;
+      }
+   }
+
+   for(c = 0; c < MAX_SERVER_CLIENTS; c++)
+   {
+      if(clients[c].sock != INVALID_SOCKET) closeSocket(clients[c].sock);
+      clients[c].sock = INVALID_SOCKET;
+   }
+   closeSocket(listenSock);
+#ifdef _WIN32
+   WSACleanup();
+#endif
+   printf("Server stopped\n");
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets a moveTo, drawLine, drawArc or curve ready to be drawn by drawStep.  Checks every point of the shape without
+// storing any and chooses the arm the same way drawStraightLine/drawArc do: the arm of the path being continued if it
+// can, otherwise the one with the smallest sum of joint angles.  In continuous path mode a shape that starts where
+// the pen is continues its path.
+// INPUTS:  stepper: the stepper to set up, cmd: the parsed command, transformMatrix, state: transform and robot state
+// RETURN:  none
+void initDrawStepper(DRAW_STEPPER *stepper, const PARSED_COMMAND *cmd, double transformMatrix[3][3],
+   const SCARA_STATE *state)
+{
+   bool bLeft = true, bRight = true;        // arms that can draw every point
+   double adderLeft = 0, adderRight = 0;    // sum of the joint angles of each arm
+   bool bJoin = state->bJoinPath;           // true if the shape continues the path the pen is on
+   int pathArm = state->pathArm;            // arm of that path
+   double xs, ys, xe, ye;                   // start and end of the shape
+
+   // a shape in the IK cache needs no geometry at all (the guard adds points, so it doesn't use the cache)
+   stepper->ikKey = 0;
+   stepper->ikPoints = NULL;
+   stepper->bIkHit = false;
+   if(ikCache.base != NULL && !state->bSingularityGuard)
+   {
+      stepper->ikKey = getIkKey(cmd, transformMatrix, state);
+      stepper->bIkHit = ikCacheLookup(stepper, cmd);
+   }
+   if(stepper->bIkHit)
+   {
+      bLeft = stepper->bIkLeft;
+      bRight = stepper->bIkRight;
+      adderLeft = stepper->ikAdderLeft;
+      adderRight = stepper->ikAdderRight;
+   }
+   else
+   {
+      initShapePoints(&stepper->shape, cmd);
+      probeShapeArms(&stepper->shape, transformMatrix, state, &bLeft, &bRight, &adderLeft, &adderRight);
+      if(stepper->ikKey != 0 && stepper->shape.nPoints <= IK_CACHE_MAX_POINTS)  // record it while it is drawn
+      {
+         stepper->bIkLeft = bLeft;
+         stepper->bIkRight = bRight;
+         stepper->ikAdderLeft = adderLeft;
+         stepper->ikAdderRight = adderRight;
+         stepper->ikPoints = (double (*)[IK_POINT_VALUES])malloc(
+            (stepper->shape.nPoints > 0 ? stepper->shape.nPoints : 1) * sizeof(stepper->ikPoints[0]));
+      }
+   }
+   stepper->lineNumber = cmd->lineNumber;
+   stepper->subStep = 0;
+   stepper->bSlowed = false;
+   stepper->nNearSingular = stepper->nAdded = 0;
+   stepper->closestDeg = DBL_MAX;
+   stepper->iBlend = stepper->nBlend = 0;
+
+   if(!bJoin && state->bContinuousPath)
+   {
+      getPathEnds(cmd, &xs, &ys, &xe, &ye);
+      if(fabs(xs - state->currentPos.x) <= PATH_JOIN_TOLERANCE && fabs(ys - state->currentPos.y) <= PATH_JOIN_TOLERANCE)
+      {
+         bJoin = true;
+         pathArm = state->currentPos.armPos;
+      }
+   }
+   if(pathArm == LEFT_ARM && bLeft) bRight = false;
+   else if(pathArm == RIGHT_ARM && bRight) bLeft = false;
+   if(bLeft && bRight) stepper->arm = adderLeft < adderRight ? LEFT_ARM : RIGHT_ARM;
+   else stepper->arm = bLeft ? LEFT_ARM : (bRight ? RIGHT_ARM : NO_ARM);
+
+   // continuing a path: the pen is already down on the first point
+   if(bJoin && state->penPos == PEN_DOWN && stepper->arm != NO_ARM &&
+      stepper->arm == state->currentPos.armPos)
+   {
+      stepper->step = DRAW_STEP_POINTS;
+      stepper->i = 1;
+   }
+   else
+   {
+      stepper->step = DRAW_STEP_PEN_UP;
+      stepper->i = 0;
+   }
+   if(stepper->i == 1 && stepper->ikPoints != NULL && !stepper->bIkHit)  // the IK cache needs the first point too
+   {
+      double x, y;   // the first point
+      getShapePoint(&stepper->shape, 0, &x, &y);
+      INVERSE_SOLUTION isol = solveInverseKinematics(x, y, transformMatrix, state);
+      ikCacheRecordPoint(stepper, 0, x, y, &isol);
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sends the next robot command of a shape (PEN_UP, the move to the first point, PEN_DOWN, then one ROTATE_JOINT per
+// point) and keeps the robot state up to date, so a caller can stop after any command and do something else.
+// If no arm can draw the shape the pen is lifted and put down again without moving.
+// INPUTS:  stepper: set up by initDrawStepper, transformMatrix, state: transform and robot state
+// RETURN:  true if a command was sent, false once the shape is finished (nothing sent)
+bool drawStep(DRAW_STEPPER *stepper, double transformMatrix[3][3], SCARA_STATE *state)
+{
+   INVERSE_SOLUTION isol;   // joint angles of the point
+   double x, y;             // point being sent
+   double theta[2];         // its joint angles (DEGREES)
+
+   switch(stepper->step)
+   {
+   case DRAW_STEP_PEN_UP:
+      sendToRobot("PEN_UP\n");
+      state->penPos = PEN_UP;
+      stepper->step = stepper->shape.nPoints > 0 ? DRAW_STEP_FIRST_POINT : DRAW_STEP_DONE;
+      if(stepper->step == DRAW_STEP_DONE) ikCacheFinish(stepper, transformMatrix, state);
+      return true;
+
+   case DRAW_STEP_FIRST_POINT:
+      stepper->step = DRAW_STEP_PEN_DOWN;
+      if(stepper->arm != NO_ARM) break;  // sent below
+      [[fallthrough]];  // nothing to move to
+
+   case DRAW_STEP_PEN_DOWN:
+      sendToRobot("PEN_DOWN\n");
+      state->penPos = PEN_DOWN;
+      if(stepper->arm == NO_ARM) state->currentPos.armPos = NO_ARM;
+      if(stepper->arm == NO_ARM && pCommandOutput != NULL) pCommandOutput->nUnreachable++;
+      stepper->step = stepper->arm == NO_ARM ? DRAW_STEP_DONE : DRAW_STEP_POINTS;
+      if(stepper->arm == NO_ARM) ikCacheFinish(stepper, transformMatrix, state);
+      return true;
+
+   case DRAW_STEP_POINTS:
+      if(stepper->i < stepper->shape.nPoints) break;
+      stepper->step = DRAW_STEP_DONE;
+      if(stepper->bSlowed) restoreMotorSpeed(stepper, state);
+      if(stepper->nNearSingular > 0) reportSingularity(stepper);
+      if(stepper->bIkHit)
+      {
+         state->currentPos.x = stepper->xIkEnd;
+         state->currentPos.y = stepper->yIkEnd;
+      }
+      else if(stepper->shape.index == INDEX_DRAW_ARC)  // finish exactly on the end point
+      {
+         state->currentPos.x = stepper->shape.xc + stepper->shape.radius * cos(stepper->shape.thetaEnd);
+         state->currentPos.y = stepper->shape.yc + stepper->shape.radius * sin(stepper->shape.thetaEnd);
+      }
+      else
+      {
+         state->currentPos.x = stepper->shape.x1;
+         state->currentPos.y = stepper->shape.y1;
+      }
+      ikCacheFinish(stepper, transformMatrix, state);
+      return false;
+
+   default:
+      return false;
+   }
+
+   if(stepper->nBlend > 0)  // the cut of a blended corner, sent instead of the last point
+   {
+      const double *p = stepper->blend[stepper->iBlend];   // x, y, joint angles
+      state->currentPos.x = p[0];
+      state->currentPos.y = p[1];
+      state->currentPos.theta1Deg = p[2];
+      state->currentPos.theta2Deg = p[3];
+      sendJointSetpoint(p[2], p[3]);
+      if(++stepper->iBlend == stepper->nBlend) stepper->i++;
+      return true;
+   }
+
+   if(stepper->bIkHit)  // worked out in an earlier run
+   {
+      const double *p = stepper->ikPoints[stepper->i];   // x, y, left arm angles, right arm angles
+      x = p[0];
+      y = p[1];
+      theta[0] = stepper->arm == RIGHT_ARM ? p[4] : p[2];
+      theta[1] = stepper->arm == RIGHT_ARM ? p[5] : p[3];
+   }
+   else
+   {
+      getShapePoint(&stepper->shape, stepper->i, &x, &y);
+      isol = solveInverseKinematics(x, y, transformMatrix, state);
+      if(state->bSingularityGuard && stepper->step == DRAW_STEP_POINTS &&
+         singularityGuardStep(stepper, x, y, &isol, transformMatrix, state)) return true;  // sent an added point
+      ikCacheRecordPoint(stepper, stepper->i, x, y, &isol);
+      theta[0] = stepper->arm == RIGHT_ARM ? isol.theta1DegRight : isol.theta1DegLeft;
+      theta[1] = stepper->arm == RIGHT_ARM ? isol.theta2DegRight : isol.theta2DegLeft;
+   }
+   if(stepper->step == DRAW_STEP_POINTS && stepper->i == stepper->shape.nPoints - 1 && stepper->i > 0 &&
+      state->bContinuousPath && state->blendToleranceDeg > 0.0 && !state->bSingularityGuard &&
+      blendCorner(stepper, x, y, theta, transformMatrix, state))
+   {
+      if(stepper->nBlend == 0) stepper->i++;   // the corner is left out
+      return drawStep(stepper, transformMatrix, state);   // sends the first point of the cut, or ends the shape
+   }
+   state->currentPos.theta1Deg = theta[0];
+   state->currentPos.theta2Deg = theta[1];
+   state->currentPos.x = x;
+   state->currentPos.y = y;
+   state->currentPos.armPos = stepper->arm;
+   sendJointSetpoint(state->currentPos.theta1Deg, state->currentPos.theta2Deg);
+   stepper->i++;
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Stops a shape part way.  The pen is lifted if it was drawing so the arm is left free to move; the robot state keeps
+// the last point sent.
+// INPUTS:  stepper: the shape being drawn, state: robot state
+// RETURN:  none
+void cancelDrawStepper(DRAW_STEPPER *stepper, SCARA_STATE *state)
+{
+   if(stepper->step == DRAW_STEP_DONE) return;
+   free(stepper->ikPoints);  // a shape cut short isn't stored in the IK cache
+   stepper->ikPoints = NULL;
+   if(stepper->bSlowed) restoreMotorSpeed(stepper, state);
+   if(state->penPos == PEN_DOWN)
+   {
+      sendToRobot("PEN_UP\n");
+      state->penPos = PEN_UP;
+   }
+   stepper->step = DRAW_STEP_DONE;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Singularity guard of drawStep, called before point i of a shape is sent with the pen down.  Near full extension
+// (elbow almost straight) a small move of the pen needs a big turn of the joints, and near the elbow limit the
+// shoulder swings fast, so the robot's joint moves between two points can stray well off the shape.  The first time
+// point i is looked at, the move to it is split if either end is near-singular and a joint would turn more than
+// SINGULARITY_MAX_STEP_DEG, and the motor speed is lowered to LOW while the arm is near a singularity (put back when
+// it leaves).  Each call then sends one of the added points, until it is point i's turn.
+// INPUTS:  stepper: the shape being drawn, x, y: point i, pIsol: its solution, transformMatrix, state: transform and
+//          robot state
+// RETURN:  true if an added point was sent (point i is sent later), false if point i is to be sent now
+bool singularityGuardStep(DRAW_STEPPER *stepper, double x, double y, const INVERSE_SOLUTION *pIsol,
+   double transformMatrix[3][3], SCARA_STATE *state)
+{
+   INVERSE_SOLUTION isol;                   // solution of an added point
+   double theta1, theta2;                   // joint angles of point i
+   double maxTheta1, maxTheta2, zone;       // joint limits, how near the point is to a singularity (deg)
+   double jointStep, xs, ys;                // largest joint turn to point i, added point
+   bool bNear, bNearFrom;                   // point i / the point before it are near a singularity
+
+   theta1 = stepper->arm == RIGHT_ARM ? pIsol->theta1DegRight : pIsol->theta1DegLeft;
+   theta2 = stepper->arm == RIGHT_ARM ? pIsol->theta2DegRight : pIsol->theta2DegLeft;
+
+   if(stepper->subStep == 0)  // first look at point i
+   {
+      getJointLimits(state->robotModel, &maxTheta1, &maxTheta2);
+      zone = fmin(fabs(theta2), maxTheta2 - fabs(theta2));
+      bNear = zone < SINGULARITY_ZONE_DEG;
+      bNearFrom = fmin(fabs(state->currentPos.theta2Deg), maxTheta2 - fabs(state->currentPos.theta2Deg)) <
+         SINGULARITY_ZONE_DEG;
+      if(bNear)
+      {
+         stepper->nNearSingular++;
+         if(zone < stepper->closestDeg)
+         {
+            stepper->closestDeg = zone;
+            stepper->bClosestStraight = fabs(theta2) < maxTheta2 - fabs(theta2);
+            stepper->xClosest = x;
+            stepper->yClosest = y;
+         }
+      }
+
+      if((bNear || bNearFrom) && !stepper->bSlowed && state->motorSpeed != MOTOR_SPEED_LOW &&
+         !(state->robotModel == ROBOT_MODEL_PROFILE && !robotProfile.bSpeedSupported[MOTOR_SPEED_LOW]))
+      {
+         sendToRobot("MOTOR_SPEED LOW\n");
+         stepper->bSlowed = true;
+      }
+      else if(!bNear && !bNearFrom && stepper->bSlowed)
+      {
+         restoreMotorSpeed(stepper, state);
+      }
+
+      jointStep = fmax(fabs(theta1 - state->currentPos.theta1Deg), fabs(theta2 - state->currentPos.theta2Deg));
+      stepper->nSubSteps = 1;
+      if((bNear || bNearFrom) && jointStep > SINGULARITY_MAX_STEP_DEG)
+      {
+         stepper->nSubSteps = (int)ceil(jointStep / SINGULARITY_MAX_STEP_DEG);
+         if(stepper->nSubSteps > SINGULARITY_MAX_SUBSTEPS) stepper->nSubSteps = SINGULARITY_MAX_SUBSTEPS;
+      }
+      stepper->subStep = 1;
+   }
+
+   // added points are on the shape between point i - 1 and point i (any the arm can't reach are left out)
+   for(; stepper->subStep < stepper->nSubSteps; stepper->subStep++)
+   {
+      getShapePoint(&stepper->shape, stepper->i - 1 + (double)stepper->subStep / stepper->nSubSteps, &xs, &ys);
+      isol = solveInverseKinematics(xs, ys, transformMatrix, state);
+      if(!(stepper->arm == RIGHT_ARM ? isol.bRight : isol.bLeft)) continue;
+
+      state->currentPos.theta1Deg = stepper->arm == RIGHT_ARM ? isol.theta1DegRight : isol.theta1DegLeft;
+      state->currentPos.theta2Deg = stepper->arm == RIGHT_ARM ? isol.theta2DegRight : isol.theta2DegLeft;
+      state->currentPos.x = xs;
+      state->currentPos.y = ys;
+      sendJointSetpoint(state->currentPos.theta1Deg, state->currentPos.theta2Deg);
+      stepper->nAdded++;
+      stepper->subStep++;
+      return true;
+   }
+   stepper->subStep = 0;
+   return false;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Corner blending of drawStep (continuousPath ON), called for the last point of a shape drawn with the pen down when
+// the next command is known (pNextSegment) and starts there.  The robot moves its joints in a straight line between
+// setpoints, so a corner point is a stop.  If the joint move from the point sent last straight to the first point of
+// the next shape passes within the tolerance of the corner's joint angles the corner is left out.  Otherwise it is cut
+// between a point on each segment, moved in halfway towards the corner until the move between them passes within the
+// tolerance.  The next shape must be drawable by the same arm (so it doesn't lift the pen at the corner).
+// INPUTS:  stepper: the shape being drawn, x, y: its last point, theta: its joint angles, transformMatrix, state:
+//          transform and robot state
+// RETURN:  true if the corner is blended (stepper->nBlend points are sent instead of it), false to send it
+bool blendCorner(DRAW_STEPPER *stepper, double x, double y, const double theta[2], double transformMatrix[3][3],
+   const SCARA_STATE *state)
+{
+   const PARSED_COMMAND *next = pNextSegment;   // command drawn after the shape
+   const double thetaFrom[2] = {state->currentPos.theta1Deg, state->currentPos.theta2Deg};  // point sent last
+   SHAPE_POINTS shape;                          // points of the next command
+   bool bLeft = true, bRight = true;            // arms that can draw all of it
+   double adderLeft = 0, adderRight = 0;        // (unused) arm costs
+   double xs, ys, xe, ye, xn, yn;               // ends of the next command, its second point
+   double thetaNext[2], f;                      // joint angles of that point, fraction of the segments cut
+   double *a = stepper->blend[0], *b = stepper->blend[1];  // the points of the cut: x, y, joint angles
+   int k;                                       // try
+
+   if(next == NULL || next->index == INDEX_MOVE_TO || state->penPos != PEN_DOWN) return false;
+   getPathEnds(next, &xs, &ys, &xe, &ye);
+   if(fabs(xs - x) > PATH_JOIN_TOLERANCE || fabs(ys - y) > PATH_JOIN_TOLERANCE) return false;
+   initShapePoints(&shape, next);
+   if(shape.nPoints < 2) return false;
+   probeShapeArms(&shape, transformMatrix, state, &bLeft, &bRight, &adderLeft, &adderRight);
+   if(!(stepper->arm == RIGHT_ARM ? bRight : bLeft)) return false;
+   getShapePoint(&shape, 1, &xn, &yn);
+   if(!getArmAngles(xn, yn, stepper->arm, transformMatrix, state, thetaNext)) return false;
+
+   stepper->iBlend = stepper->nBlend = 0;
+   if(jointDistanceToMove(theta, thetaFrom, thetaNext) <= state->blendToleranceDeg) return true;
+
+   for(k = 0, f = 0.5; k < BLEND_MAX_HALVINGS; k++, f /= 2.0)
+   {
+      a[0] = x + f * (state->currentPos.x - x);
+      a[1] = y + f * (state->currentPos.y - y);
+      b[0] = x + f * (xn - x);
+      b[1] = y + f * (yn - y);
+      if(!getArmAngles(a[0], a[1], stepper->arm, transformMatrix, state, a + 2) ||
+         !getArmAngles(b[0], b[1], stepper->arm, transformMatrix, state, b + 2)) return false;
+      if(jointDistanceToMove(theta, a + 2, b + 2) <= state->blendToleranceDeg)
+      {
+         stepper->nBlend = 2;
+         return true;
+      }
+   }
+   return false;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets the joint angles of one arm at a point.
+// INPUTS:  x, y: the point, arm: LEFT_ARM or RIGHT_ARM, transformMatrix, state: transform and robot state,
+//          theta: where to store the joint angles (DEGREES)
+// RETURN:  true if the arm can reach the point
+bool getArmAngles(double x, double y, int arm, double transformMatrix[3][3], const SCARA_STATE *state,
+   double theta[2])
+{
+   INVERSE_SOLUTION isol = solveInverseKinematics(x, y, transformMatrix, state);   // both arms
+
+   theta[0] = arm == RIGHT_ARM ? isol.theta1DegRight : isol.theta1DegLeft;
+   theta[1] = arm == RIGHT_ARM ? isol.theta2DegRight : isol.theta2DegLeft;
+   return arm == RIGHT_ARM ? isol.bRight : isol.bLeft;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Gets how far joint angles are from a straight joint move (in joint space, both joints in degrees).
+// INPUTS:  theta: the joint angles, a, b: the start and end of the move
+// RETURN:  the distance (DEGREES)
+double jointDistanceToMove(const double theta[2], const double a[2], const double b[2])
+{
+   double d[2] = {b[0] - a[0], b[1] - a[1]};   // the move
+   double len2 = d[0] * d[0] + d[1] * d[1];    // its length squared
+   double t = 0.0;                             // closest point of the move (0 to 1)
+
+   if(len2 > 0.0) t = ((theta[0] - a[0]) * d[0] + (theta[1] - a[1]) * d[1]) / len2;
+   if(t < 0.0) t = 0.0;
+   else if(t > 1.0) t = 1.0;
+   return hypot(theta[0] - a[0] - t * d[0], theta[1] - a[1] - t * d[1]);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Puts back the motor speed of the job after the singularity guard lowered it.
+// INPUTS:  stepper: the shape being drawn, state: robot state (motorSpeed is the job's speed)
+// RETURN:  none
+void restoreMotorSpeed(DRAW_STEPPER *stepper, const SCARA_STATE *state)
+{
+   if(state->motorSpeed == MOTOR_SPEED_HIGH) sendToRobot("MOTOR_SPEED HIGH\n");
+   else if(state->motorSpeed == MOTOR_SPEED_MEDIUM) sendToRobot("MOTOR_SPEED MEDIUM\n");
+   else sendToRobot("MOTOR_SPEED LOW\n");
+   stepper->bSlowed = false;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Tells the user where a shape came near a singularity and what the singularity guard did about it.
+// INPUTS:  stepper: the finished shape
+// RETURN:  none
+void reportSingularity(const DRAW_STEPPER *stepper)
+{
+   fprintf(messageFile(), "Singularity guard: %s", SCARA_COMMANDS[stepper->shape.index].cmdName);
+   if(stepper->lineNumber > 0) fprintf(messageFile(), " (line %d)", stepper->lineNumber);
+   fprintf(messageFile(), " came within %.1f deg of %s at (%.1f, %.1f): %d point(s) near it, %d point(s) added\n",
+      stepper->closestDeg, stepper->bClosestStraight ? "full extension" : "the elbow limit", stepper->xClosest,
+      stepper->yClosest, stepper->nNearSingular, stepper->nAdded);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Opens (or creates) the IK cache file and maps it into memory.  The file always has the size IK_CACHE_MAX_BYTES;
+// one of another layout or version, or left open by a run that didn't finish, is emptied.  The file is locked, so
+// a second run at the same time goes without the cache.
+// INPUTS:  fileName: the file
+// RETURN:  false (with a message printed) if the cache can't be used
+bool ikCacheOpen(const char *fileName)
+{
+   IK_CACHE_HEADER *header;   // start of the file
+   size_t tableBytes = sizeof(IK_CACHE_HEADER) + IK_CACHE_SLOTS * sizeof(IK_CACHE_ENTRY);  // before the blocks
+   int nBlocks = (int)((IK_CACHE_MAX_BYTES - tableBytes) / sizeof(IK_CACHE_BLOCK));       // blocks that fit
+
+#ifdef _WIN32
+   ikCache.hFile = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+      NULL);   // not shared: a second run can't open it
+   if(ikCache.hFile == INVALID_HANDLE_VALUE)
+   {
+      printf("Sorry the IK cache %s could not be opened (is another run using it?)\n", fileName);
+      return false;
+   }
+   ikCache.hMapping = CreateFileMappingA(ikCache.hFile, NULL, PAGE_READWRITE, 0, (DWORD)IK_CACHE_MAX_BYTES, NULL);
+   ikCache.base = ikCache.hMapping == NULL ? NULL :
+      MapViewOfFile(ikCache.hMapping, FILE_MAP_ALL_ACCESS, 0, 0, IK_CACHE_MAX_BYTES);
+   if(ikCache.base == NULL)
+   {
+      if(ikCache.hMapping != NULL) CloseHandle(ikCache.hMapping);
+      CloseHandle(ikCache.hFile);
+      printf("Sorry the IK cache %s could not be mapped\n", fileName);
+      return false;
+   }
+#else
+   struct stat st;   // size of the file
+   ikCache.fd = open(fileName, O_RDWR | O_CREAT, 0644);
+   if(ikCache.fd < 0 || flock(ikCache.fd, LOCK_EX | LOCK_NB) != 0)
+   {
+      if(ikCache.fd >= 0) close(ikCache.fd);
+      printf("Sorry the IK cache %s could not be opened (is another run using it?)\n", fileName);
+      return false;
+   }
+   if(fstat(ikCache.fd, &st) != 0 || ((size_t)st.st_size != IK_CACHE_MAX_BYTES &&
+      ftruncate(ikCache.fd, (off_t)IK_CACHE_MAX_BYTES) != 0))
+   {
+      close(ikCache.fd);
+      printf("Sorry the IK cache %s could not be made %d MB\n", fileName, (int)(IK_CACHE_MAX_BYTES / (1024 * 1024)));
+      return false;
+   }
+   ikCache.base = mmap(NULL, IK_CACHE_MAX_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, ikCache.fd, 0);
+   if(ikCache.base == MAP_FAILED)
+   {
+      ikCache.base = NULL;
+      close(ikCache.fd);
+      printf("Sorry the IK cache %s could not be mapped\n", fileName);
+      return false;
+   }
+#endif
+
+   ikCache.size = IK_CACHE_MAX_BYTES;
+   ikCache.header = header = (IK_CACHE_HEADER *)ikCache.base;
+   ikCache.entries = (IK_CACHE_ENTRY *)(header + 1);
+   ikCache.blocks = (IK_CACHE_BLOCK *)((char *)ikCache.base + tableBytes);
+   if(memcmp(header->magic, IK_CACHE_MAGIC, sizeof(IK_CACHE_MAGIC)) != 0 || header->version != IK_CACHE_VERSION ||
+      header->nSlots != IK_CACHE_SLOTS || header->nBlocks != nBlocks || header->blockPoints != IK_CACHE_BLOCK_POINTS ||
+      header->bDirty)
+   {
+      header->nBlocks = nBlocks;
+      ikCacheReset();
+   }
+   header->bDirty = 1;
+   printf("Using the IK cache %s (%d shapes)\n", fileName, header->nEntries);
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Marks the IK cache file as complete and unmaps it.  Does nothing if no cache is open.
+// INPUTS:  none
+// RETURN:  none
+void ikCacheClose()
+{
+   std::lock_guard<std::mutex> lock(ikCache.lock);
+
+   if(ikCache.base == NULL) return;
+   printf("IK cache: %d shape(s) reused, %d stored, %d in the cache\n", ikCache.nHits, ikCache.nStored,
+      ikCache.header->nEntries);
+   ikCache.header->bDirty = 0;
+#ifdef _WIN32
+   FlushViewOfFile(ikCache.base, 0);
+   UnmapViewOfFile(ikCache.base);
+   CloseHandle(ikCache.hMapping);
+   CloseHandle(ikCache.hFile);
+#else
+   munmap(ikCache.base, ikCache.size);
+   close(ikCache.fd);
+#endif
+   ikCache.base = NULL;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Empties the IK cache: every slot empty and every block on the free list
+// INPUTS:  none (header->nBlocks must be set)
+// RETURN:  none
+void ikCacheReset()
+{
+   IK_CACHE_HEADER *header = ikCache.header;
+   int b;   // block counter
+
+   memcpy(header->magic, IK_CACHE_MAGIC, sizeof(IK_CACHE_MAGIC));
+   header->version = IK_CACHE_VERSION;
+   header->nSlots = IK_CACHE_SLOTS;
+   header->blockPoints = IK_CACHE_BLOCK_POINTS;
+   header->nEntries = 0;
+   header->lruHead = header->lruTail = -1;
+   memset(ikCache.entries, 0, IK_CACHE_SLOTS * sizeof(IK_CACHE_ENTRY));
+   for(b = 0; b < header->nBlocks; b++) ikCache.blocks[b].next = b + 1 < header->nBlocks ? b + 1 : -1;
+   header->freeBlock = header->nBlocks > 0 ? 0 : -1;
+   header->nFreeBlocks = header->nBlocks;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Key of a shape in the IK cache: a hash of the command (its type, points and resolution), the transform matrix,
+// the robot model (and profile) and the kinematics precision.  The transform is part of the key as it is, rather than
+// applied to the points first, so a shape from the cache has exactly the joint angles it would be drawn with.
+// INPUTS:  cmd: the shape's command, transformMatrix, state: transform and robot state
+// RETURN:  the key (never 0, which marks an empty slot)
+unsigned long long getIkKey(const PARSED_COMMAND *cmd, double transformMatrix[3][3], const SCARA_STATE *state)
+{
+   int values[] = {state->robotModel, state->kinematicsPrecision};   // what the joint angles depend on
+   unsigned long long h = hashCommand(14695981039346656037ull, cmd);  // the hash
+
+   h = hashBytes(h, transformMatrix[0], 9 * sizeof(double));
+   h = hashBytes(h, values, sizeof(values));
+   h = hashRobotProfile(h);
+   return h == 0 ? 1 : h;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Looks up a shape in the hash table of the IK cache (the lock must be held)
+// INPUTS:  key: key of the shape
+// RETURN:  its entry, or -1 if it isn't there
+int ikCacheFind(unsigned long long key)
+{
+   int e;   // slot counter
+
+   for(e = (int)(key & (IK_CACHE_SLOTS - 1)); ikCache.entries[e].key != 0; e = (e + 1) & (IK_CACHE_SLOTS - 1))
+   {
+      if(ikCache.entries[e].key == key) return e;
+   }
+   return -1;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Takes an entry out of the LRU list of the IK cache (the lock must be held)
+// INPUTS:  e: the entry
+// RETURN:  none
+void ikCacheUnlink(int e)
+{
+   IK_CACHE_ENTRY *entry = &ikCache.entries[e];
+
+   if(entry->lruPrev >= 0) ikCache.entries[entry->lruPrev].lruNext = entry->lruNext;
+   else ikCache.header->lruHead = entry->lruNext;
+   if(entry->lruNext >= 0) ikCache.entries[entry->lruNext].lruPrev = entry->lruPrev;
+   else ikCache.header->lruTail = entry->lruPrev;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Puts an entry at the front of the LRU list of the IK cache (the lock must be held)
+// INPUTS:  e: the entry (not in the list)
+// RETURN:  none
+void ikCachePushFront(int e)
+{
+   IK_CACHE_HEADER *header = ikCache.header;
+
+   ikCache.entries[e].lruPrev = -1;
+   ikCache.entries[e].lruNext = header->lruHead;
+   if(header->lruHead >= 0) ikCache.entries[header->lruHead].lruPrev = e;
+   header->lruHead = e;
+   if(header->lruTail < 0) header->lruTail = e;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Moves an entry of the IK cache to an empty slot, keeping its place in the LRU list (the lock must be held)
+// INPUTS:  from: the entry, to: the empty slot
+// RETURN:  none
+void ikCacheMoveEntry(int from, int to)
+{
+   IK_CACHE_ENTRY *entry = &ikCache.entries[to];
+
+   *entry = ikCache.entries[from];
+   ikCache.entries[from].key = 0;
+   if(entry->lruPrev >= 0) ikCache.entries[entry->lruPrev].lruNext = to;
+   else ikCache.header->lruHead = to;
+   if(entry->lruNext >= 0) ikCache.entries[entry->lruNext].lruPrev = to;
+   else ikCache.header->lruTail = to;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Removes a shape from the IK cache: its blocks go back on the free list, and the entries after it in its probe run
+// are moved back so no lookup stops early (the lock must be held)
+// INPUTS:  e: the entry
+// RETURN:  none
+void ikCacheEvict(int e)
+{
+   IK_CACHE_HEADER *header = ikCache.header;
+   int b, next, j, home;   // block, next block, slot after the hole, home slot of the entry there
+
+   ikCacheUnlink(e);
+   for(b = ikCache.entries[e].firstBlock; b >= 0; b = next)
+   {
+      next = ikCache.blocks[b].next;
+      ikCache.blocks[b].next = header->freeBlock;
+      header->freeBlock = b;
+      header->nFreeBlocks++;
+   }
+   ikCache.entries[e].key = 0;
+   header->nEntries--;
+
+   for(j = (e + 1) & (IK_CACHE_SLOTS - 1); ikCache.entries[j].key != 0; j = (j + 1) & (IK_CACHE_SLOTS - 1))
+   {
+      home = (int)(ikCache.entries[j].key & (IK_CACHE_SLOTS - 1));
+      if(((j - home) & (IK_CACHE_SLOTS - 1)) >= ((j - e) & (IK_CACHE_SLOTS - 1)))  // the hole is on its probe run
+      {
+         ikCacheMoveEntry(j, e);
+         e = j;
+      }
+   }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Looks up a shape being set up by initDrawStepper in the IK cache.  If it is there its points, joint angles, arm
+// feasibility and costs are copied into the stepper (which frees them when the shape is finished) and it becomes
+// the most recently used shape.
+// INPUTS:  stepper: the stepper (ikKey set), cmd: the shape's command
+// RETURN:  true if the shape was found
+bool ikCacheLookup(DRAW_STEPPER *stepper, const PARSED_COMMAND *cmd)
+{
+   std::lock_guard<std::mutex> lock(ikCache.lock);
+   IK_CACHE_ENTRY *entry;     // the shape
+   int e, b, i, n;            // entry, block, point, points copied from the block
+
+   e = ikCacheFind(stepper->ikKey);
+   if(e < 0)
+   {
+      ikCache.nMisses++;
+      return false;
+   }
+   entry = &ikCache.entries[e];
+   stepper->ikPoints = (double (*)[IK_POINT_VALUES])malloc(
+      (entry->nPoints > 0 ? entry->nPoints : 1) * sizeof(stepper->ikPoints[0]));
+   if(stepper->ikPoints == NULL) return false;
+   for(i = 0, b = entry->firstBlock; i < entry->nPoints; i += n, b = ikCache.blocks[b].next)
+   {
+      n = entry->nPoints - i < IK_CACHE_BLOCK_POINTS ? entry->nPoints - i : IK_CACHE_BLOCK_POINTS;
+      memcpy(stepper->ikPoints[i], ikCache.blocks[b].points, n * sizeof(stepper->ikPoints[0]));
+   }
+
+   stepper->shape.index = cmd->index;
+   stepper->shape.nPoints = entry->nPoints;
+   stepper->bIkLeft = entry->bLeft != 0;
+   stepper->bIkRight = entry->bRight != 0;
+   stepper->ikAdderLeft = entry->adderLeft;
+   stepper->ikAdderRight = entry->adderRight;
+   stepper->xIkEnd = entry->xEnd;
+   stepper->yIkEnd = entry->yEnd;
+   ikCacheUnlink(e);
+   ikCachePushFront(e);
+   ikCache.nHits++;
+   return true;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Records a point of a shape being drawn, for the IK cache
+// INPUTS:  stepper: the shape, i: the point, x, y: where it is, pIsol: its joint angles
+// RETURN:  none
+void ikCacheRecordPoint(DRAW_STEPPER *stepper, int i, double x, double y, const INVERSE_SOLUTION *pIsol)
+{
+   double *p;   // the point's values
+
+   if(stepper->ikPoints == NULL || stepper->bIkHit) return;
+   p = stepper->ikPoints[i];
+   p[0] = x;
+   p[1] = y;
+   p[2] = pIsol->theta1DegLeft;
+   p[3] = pIsol->theta2DegLeft;
+   p[4] = pIsol->theta1DegRight;
+   p[5] = pIsol->theta2DegRight;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Called by drawStep when a shape is finished: a shape recorded while it was drawn is stored in the IK cache (if no
+// arm could draw it, its points are worked out first), making room by evicting the least recently used shapes.  The
+// points are freed either way.
+// INPUTS:  stepper: the shape, transformMatrix, state: transform and robot state (where the pen ended)
+// RETURN:  none
+void ikCacheFinish(DRAW_STEPPER *stepper, double transformMatrix[3][3], const SCARA_STATE *state)
+{
+   INVERSE_SOLUTION isol;     // joint angles of a point that wasn't sent
+   IK_CACHE_HEADER *header = ikCache.header;
+   IK_CACHE_ENTRY *entry;     // the shape
+   double x, y;               // a point
+   int nPoints = stepper->shape.nPoints, nBlocks, e, b, i, n;  // points, blocks needed, entry, block, point, count
+
+   if(stepper->ikPoints == NULL || stepper->bIkHit)
+   {
+      free(stepper->ikPoints);
+      stepper->ikPoints = NULL;
+      return;
+   }
+
+   // no arm could draw the shape: none of its points were sent
+   n = stepper->arm == NO_ARM ? nPoints : 0;
+   for(i = 0; i < n; i++)
+   {
+      getShapePoint(&stepper->shape, i, &x, &y);
+      isol = solveInverseKinematics(x, y, transformMatrix, state);
+      ikCacheRecordPoint(stepper, i, x, y, &isol);
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(ikCache.lock);
+
+      nBlocks = (nPoints + IK_CACHE_BLOCK_POINTS - 1) / IK_CACHE_BLOCK_POINTS;
+      if(ikCacheFind(stepper->ikKey) < 0 && nBlocks <= header->nBlocks)
+      {
+         while(header->lruTail >= 0 && (header->nFreeBlocks < nBlocks || 2 * (header->nEntries + 1) > IK_CACHE_SLOTS))
+         {
+            ikCacheEvict(header->lruTail);
+         }
+         for(e = (int)(stepper->ikKey & (IK_CACHE_SLOTS - 1)); ikCache.entries[e].key != 0;
+            e = (e + 1) & (IK_CACHE_SLOTS - 1));
+         entry = &ikCache.entries[e];
+         entry->key = stepper->ikKey;
+         entry->nPoints = nPoints;
+         entry->bLeft = stepper->bIkLeft;
+         entry->bRight = stepper->bIkRight;
+         entry->adderLeft = stepper->ikAdderLeft;
+         entry->adderRight = stepper->ikAdderRight;
+         entry->xEnd = state->currentPos.x;
+         entry->yEnd = state->currentPos.y;
+         entry->firstBlock = -1;
+         for(i = (nBlocks - 1) * IK_CACHE_BLOCK_POINTS; i >= 0; i -= IK_CACHE_BLOCK_POINTS)  // last block first
+         {
+            b = header->freeBlock;
+            header->freeBlock = ikCache.blocks[b].next;
+            header->nFreeBlocks--;
+            n = nPoints - i < IK_CACHE_BLOCK_POINTS ? nPoints - i : IK_CACHE_BLOCK_POINTS;
+            memcpy(ikCache.blocks[b].points, stepper->ikPoints[i], n * sizeof(stepper->ikPoints[0]));
+            ikCache.blocks[b].next = entry->firstBlock;
+            entry->firstBlock = b;
+         }
+         header->nEntries++;
+         ikCachePushFront(e);
+         ikCache.nStored++;
+      }
+   }
+   free(stepper->ikPoints);
+   stepper->ikPoints = NULL;
+}